@@ -2,15 +2,16 @@
 
 uniform mat4 projection;
 uniform mat4 view;
-uniform mat4 world;
-uniform vec3 offset;
 
 layout(location = 0) in vec3 aPos;
 layout(location = 1) in vec2 aTexCoord;
+layout(location = 2) in vec4 aColor;
 
 out vec2 TexCoord;
+out vec4 Color;
 
 void main() {
-  gl_Position = projection * view * world * vec4(aPos + offset, 1.0);
-  TexCoord = vec2(aTexCoord.x, aTexCoord.y);
+  gl_Position = projection * view * vec4(aPos, 1.0);
+  TexCoord = aTexCoord;
+  Color = aColor;
 }
\ No newline at end of file
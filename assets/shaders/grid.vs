@@ -1,7 +1,10 @@
 #version 330 core 
 
-uniform mat4 projection;
-uniform mat4 view;
+layout (std140) uniform Camera {
+  mat4 projection;
+  mat4 view;
+  mat4 view_projection;
+};
 uniform mat4 world;
 
 layout(location = 0) in vec3 v_position;
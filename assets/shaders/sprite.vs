@@ -1,15 +1,27 @@
 #version 330 core
 
-uniform mat4 view_projection;
-uniform mat4 world;
+layout (std140) uniform Camera {
+  mat4 projection;
+  mat4 view;
+  mat4 view_projection;
+};
 
 layout (location = 0) in vec3 pos;
 layout (location = 1) in vec3 normal;
 layout (location = 2) in vec2 coords;
 
+// per instance, a mat4 takes locations 3 to 6
+layout (location = 3) in mat4 world;
+layout (location = 7) in vec4 uv;
+layout (location = 8) in float threshold;
+layout (location = 9) in float layer;
+
 out vec4 FragPosition;
 out vec3 Normal;
 out vec2 TexCoord;
+flat out vec4 Area;
+flat out float Threshold;
+flat out float Layer;
 
 const int MAX_BONES = 100;
 const int MAX_BONE_INFLUENCE = 4;
@@ -34,6 +46,9 @@ vec4 calculateBone(vec3 vertexPos, ivec4 boneIds, vec4 weights) {
 
 void main() {
   TexCoord = coords;
+  Area = uv;
+  Threshold = threshold;
+  Layer = layer;
 
   FragPosition = world * vec4(pos, 1.0);
 
@@ -0,0 +1,194 @@
+#include "atom.h"
+
+#include <stdio.h>
+#include <pthread.h>
+#include "hash.h"
+#include "mem/mem.h"
+
+// entries sit in fixed pages so atom_str and atom_hash can read them without taking the lock
+#define ATOM_PAGE_BITS 12
+#define ATOM_PAGE_SIZE (1 << ATOM_PAGE_BITS)
+#define ATOM_MAX_PAGES 1024
+// string bytes are packed into blocks of this size, longer strings get a block of their own
+#define ATOM_BLOCK_SIZE (64 * 1024)
+#define ATOM_SEED 0x9747b28cu
+
+typedef struct
+{
+    const char *string;
+    uint64_t hash;
+    uint32_t length;
+} AtomEntry;
+
+typedef struct AtomBlock
+{
+    struct AtomBlock *next;
+    size_t size;
+    size_t usage;
+} AtomBlock;
+
+static pthread_mutex_t atom_mutex = PTHREAD_MUTEX_INITIALIZER;
+static AtomEntry *atom_pages[ATOM_MAX_PAGES];
+// slot 0 is ATOM_NONE
+static uint32_t atom_length = 1;
+// open addressing over atoms, ATOM_NONE marks a free slot
+static Atom *atom_table = NULL;
+static uint32_t atom_capacity = 0;
+static AtomBlock *atom_blocks = NULL;
+
+static inline AtomEntry *atom_entry(Atom atom)
+{
+    return &atom_pages[atom >> ATOM_PAGE_BITS][atom & (ATOM_PAGE_SIZE - 1)];
+}
+
+static Atom atom_lookup(const StrView str, uint64_t hash, uint32_t *slot)
+{
+    if (atom_capacity == 0)
+        return ATOM_NONE;
+    uint32_t i = hash & (atom_capacity - 1);
+    while (atom_table[i] != ATOM_NONE)
+    {
+        AtomEntry *entry = atom_entry(atom_table[i]);
+        if (entry->hash == hash && entry->length == str.length && memcmp(entry->string, str.string, str.length) == 0)
+            return atom_table[i];
+        i = (i + 1) & (atom_capacity - 1);
+    }
+    if (slot)
+        *slot = i;
+    return ATOM_NONE;
+}
+
+static void atom_grow()
+{
+    uint32_t capacity = atom_capacity ? atom_capacity << 1 : 1024;
+    Atom *table = (Atom *)xxmalloc(capacity * sizeof(Atom));
+    memset(table, 0, capacity * sizeof(Atom));
+    for (Atom atom = 1; atom < atom_length; atom++)
+    {
+        uint32_t i = atom_entry(atom)->hash & (capacity - 1);
+        while (table[i] != ATOM_NONE)
+            i = (i + 1) & (capacity - 1);
+        table[i] = atom;
+    }
+    if (atom_table)
+        xxfree(atom_table, atom_capacity * sizeof(Atom));
+    atom_table = table;
+    atom_capacity = capacity;
+}
+
+static const char *atom_copy(const StrView str)
+{
+    size_t need = str.length + 1;
+    AtomBlock *block = atom_blocks;
+    if (block == NULL || block->usage + need > block->size)
+    {
+        size_t size = need > ATOM_BLOCK_SIZE ? need : ATOM_BLOCK_SIZE;
+        block = (AtomBlock *)xxmalloc(sizeof(AtomBlock) + size);
+        block->size = size;
+        block->usage = 0;
+        block->next = atom_blocks;
+        atom_blocks = block;
+    }
+    char *out = (char *)(block + 1) + block->usage;
+    block->usage += need;
+    memcpy(out, str.string, str.length);
+    out[str.length] = 0;
+    return out;
+}
+
+Atom atom_intern(const StrView str)
+{
+    uint64_t hash = hash64(str.string, str.length, ATOM_SEED);
+    pthread_mutex_lock(&atom_mutex);
+    uint32_t slot;
+    Atom atom = atom_lookup(str, hash, &slot);
+    if (atom == ATOM_NONE)
+    {
+        if (atom_length == ATOM_PAGE_SIZE * ATOM_MAX_PAGES)
+        {
+            pthread_mutex_unlock(&atom_mutex);
+            printf("atom: table is full, could not intern %.*s\n", (int)str.length, str.string);
+            return ATOM_NONE;
+        }
+        // keep the table at most half full
+        if ((atom_length + 1) * 2 > atom_capacity)
+        {
+            atom_grow();
+            atom_lookup(str, hash, &slot);
+        }
+        atom = atom_length;
+        AtomEntry **page = &atom_pages[atom >> ATOM_PAGE_BITS];
+        if (*page == NULL)
+            *page = (AtomEntry *)xxmalloc(ATOM_PAGE_SIZE * sizeof(AtomEntry));
+        AtomEntry *entry = atom_entry(atom);
+        entry->string = atom_copy(str);
+        entry->length = str.length;
+        entry->hash = hash;
+        atom_table[slot] = atom;
+        atom_length++;
+    }
+    pthread_mutex_unlock(&atom_mutex);
+    return atom;
+}
+
+Atom atom_intern_cstr(const char *str)
+{
+    return atom_intern(strv((char *)str, (uint32_t)strlen(str)));
+}
+
+Atom atom_find(const StrView str)
+{
+    uint64_t hash = hash64(str.string, str.length, ATOM_SEED);
+    pthread_mutex_lock(&atom_mutex);
+    Atom atom = atom_lookup(str, hash, NULL);
+    pthread_mutex_unlock(&atom_mutex);
+    return atom;
+}
+
+Atom atom_find_cstr(const char *str)
+{
+    return atom_find(strv((char *)str, (uint32_t)strlen(str)));
+}
+
+StrView atom_str(Atom atom)
+{
+    if (atom == ATOM_NONE)
+        return str_null;
+    AtomEntry *entry = atom_entry(atom);
+    return strv((char *)entry->string, entry->length);
+}
+
+uint64_t atom_hash(Atom atom)
+{
+    if (atom == ATOM_NONE)
+        return 0;
+    return atom_entry(atom)->hash;
+}
+
+uint32_t atom_count()
+{
+    return atom_length - 1;
+}
+
+void atom_destroy()
+{
+    pthread_mutex_lock(&atom_mutex);
+    for (uint32_t i = 0; i < ATOM_MAX_PAGES; i++)
+    {
+        if (atom_pages[i])
+            xxfree(atom_pages[i], ATOM_PAGE_SIZE * sizeof(AtomEntry));
+        atom_pages[i] = NULL;
+    }
+    while (atom_blocks)
+    {
+        AtomBlock *next = atom_blocks->next;
+        xxfree(atom_blocks, sizeof(AtomBlock) + atom_blocks->size);
+        atom_blocks = next;
+    }
+    if (atom_table)
+        xxfree(atom_table, atom_capacity * sizeof(Atom));
+    atom_table = NULL;
+    atom_capacity = 0;
+    atom_length = 1;
+    pthread_mutex_unlock(&atom_mutex);
+}
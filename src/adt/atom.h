@@ -0,0 +1,32 @@
+#ifndef cgame_ATOM_H
+#define cgame_ATOM_H
+
+#include <stdint.h>
+#include "str.h"
+
+// interned string id, equal strings always map to the same atom for the lifetime of the process
+typedef uint32_t Atom;
+
+// never handed out, lookups of unknown strings return it
+#define ATOM_NONE 0
+
+Atom atom_intern(const StrView str);
+
+Atom atom_intern_cstr(const char *str);
+
+// like atom_intern but never adds, ATOM_NONE when the string was not interned yet
+Atom atom_find(const StrView str);
+
+Atom atom_find_cstr(const char *str);
+
+// interned bytes, nul terminated and stable until atom_destroy
+StrView atom_str(Atom atom);
+
+// hash of the string computed once when it was interned
+uint64_t atom_hash(Atom atom);
+
+uint32_t atom_count();
+
+void atom_destroy();
+
+#endif
@@ -0,0 +1,188 @@
+// hashing and fastmap benchmarks, built and run with make bench, not part of the game
+#include <stdio.h>
+#include <time.h>
+
+#include "mem/alloc.h"
+#include "adt/common.h"
+#include "adt/murmur.h"
+#include "adt/fastmap.h"
+
+#define BENCH_HASHES 20000000
+#define BENCH_BUCKETS (1 << 16)
+#define BENCH_KEYS 1000000
+#define BENCH_LOOKUPS 4000000
+
+#define bench_hashof_murmur(key, seed) (murmurhash((const char *)(&(key)), sizeof(key), (seed)))
+
+make_fastmap_directives(Hash64, uint32_t, uint32_t, adt_compare_primitive, adt_hashof_primitive);
+make_fastmap_directives(Murmur, uint32_t, uint32_t, adt_compare_primitive, bench_hashof_murmur);
+
+// keeps the optimizer from dropping the measured loops
+static volatile uint64_t sink = 0;
+
+static double bench_now()
+{
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec + t.tv_nsec * 1e-9;
+}
+
+static void bench_hash_speed()
+{
+    int n = BENCH_HASHES;
+    uint64_t acc = 0;
+    char name[] = "some_bone_name_number_0000";
+    uint32_t nameLength = sizeof(name) - 1;
+
+    double t0 = bench_now();
+    for (int i = 0; i < n; i++)
+    {
+        Vec3 v = {i, i * 2, i * 3};
+        acc += murmurhash((const char *)&v, sizeof(v), 0);
+    }
+    double t1 = bench_now();
+    for (int i = 0; i < n; i++)
+    {
+        Vec3 v = {i, i * 2, i * 3};
+        acc += hash64_12(&v, 0);
+    }
+    double t2 = bench_now();
+    for (int i = 0; i < n; i++)
+    {
+        name[nameLength - 1] = (char)i;
+        acc += murmurhash(name, nameLength, 0);
+    }
+    double t3 = bench_now();
+    for (int i = 0; i < n; i++)
+    {
+        name[nameLength - 1] = (char)i;
+        acc += hash64(name, nameLength, 0);
+    }
+    double t4 = bench_now();
+    sink += acc;
+
+    printf("hash vec3:      murmur %6.2f ns  hash64_12 %6.2f ns\n", (t1 - t0) / n * 1e9, (t2 - t1) / n * 1e9);
+    printf("hash %u bytes:  murmur %6.2f ns  hash64    %6.2f ns\n", nameLength, (t3 - t2) / n * 1e9, (t4 - t3) / n * 1e9);
+}
+
+// chi-square per bucket of sequential int keys, taken from the low and the high bits, 1.0 is ideal
+static double bench_chi_square(bool high, bool murmur)
+{
+    static uint32_t counts[BENCH_BUCKETS];
+    const int perBucket = 16;
+    memset(counts, 0, sizeof(counts));
+    for (uint32_t i = 0; i < BENCH_BUCKETS * perBucket; i++)
+    {
+        uint64_t h = murmur ? murmurhash((const char *)&i, sizeof(i), 0) : hash64_4(&i, 0);
+        // murmur only gives 32 bits
+        int shift = murmur ? 16 : 48;
+        counts[high ? (h >> shift) & (BENCH_BUCKETS - 1) : h & (BENCH_BUCKETS - 1)]++;
+    }
+    double chi = 0;
+    for (int i = 0; i < BENCH_BUCKETS; i++)
+    {
+        double d = counts[i] - (double)perBucket;
+        chi += d * d / perBucket;
+    }
+    return chi / BENCH_BUCKETS;
+}
+
+static void bench_hash_quality()
+{
+    printf("chi2/bucket:    murmur low %.3f high %.3f  hash64 low %.3f high %.3f\n",
+           bench_chi_square(false, true), bench_chi_square(true, true),
+           bench_chi_square(false, false), bench_chi_square(true, false));
+}
+
+// strided keys, the pattern that used to pile up in a few groups. probes counts the groups a lookup
+// visits, from the home group of the key to the one holding it
+#define bench_fastmap(t_name, t_hash, keys, n)                                                                             \
+    do                                                                                                                     \
+    {                                                                                                                      \
+        Fastmap_##t_name *map = fastmap_##t_name##_init();                                                                 \
+        uint64_t acc = 0;                                                                                                  \
+        double t0 = bench_now();                                                                                           \
+        for (uint32_t i = 0; i < (n); i++)                                                                                 \
+            fastmap_##t_name##_put(map, (keys)[i])->value = i;                                                             \
+        double t1 = bench_now();                                                                                           \
+        for (uint32_t i = 0; i < (n); i++)                                                                                 \
+            acc += fastmap_##t_name##_get(map, (keys)[i])->value;                                                          \
+        double t2 = bench_now();                                                                                           \
+        sink += acc;                                                                                                       \
+        uint64_t mask = map->groupSize - 1;                                                                                \
+        uint64_t probes = 0, worst = 0;                                                                                    \
+        for (uint32_t i = 0; i < (n); i++)                                                                                 \
+        {                                                                                                                  \
+            uint64_t home = __fast_h1(t_hash((keys)[i], map->seed)) & mask;                                                \
+            uint64_t at = ((char *)fastmap_##t_name##_get(map, (keys)[i]) - (char *)map->groups) / sizeof(map->groups[0]); \
+            uint64_t visited = ((at - home) & mask) + 1;                                                                   \
+            probes += visited;                                                                                             \
+            worst = visited > worst ? visited : worst;                                                                     \
+        }                                                                                                                  \
+        uint32_t overflowed = 0;                                                                                           \
+        for (uint64_t g = 0; g < map->groupSize; g++)                                                                      \
+            overflowed += map->groups[g].overflow;                                                                         \
+        printf("fastmap %-7s put %6.1f ms  get %6.1f ms  groups %lu overflowed %u  probes mean %.3f max %lu\n", #t_name,   \
+               (t1 - t0) * 1e3, (t2 - t1) * 1e3, (unsigned long)map->groupSize, overflowed, (double)probes / (n),          \
+               (unsigned long)worst);                                                                                      \
+        fastmap_##t_name##_destroy(map);                                                                                   \
+    } while (0)
+
+static void bench_fastmap_probes()
+{
+    uint32_t n = BENCH_KEYS;
+    uint32_t *keys = (uint32_t *)xxmalloc(n * sizeof(uint32_t));
+    for (uint32_t i = 0; i < n; i++)
+        keys[i] = i * 4096u;
+    bench_fastmap(Murmur, bench_hashof_murmur, keys, n);
+    bench_fastmap(Hash64, adt_hashof_primitive, keys, n);
+    xxfree(keys, n * sizeof(uint32_t));
+}
+
+// random lookups into a map much larger than the cache, one in eight keys is missing
+static void bench_fastmap_batch()
+{
+    uint32_t n = 2 * BENCH_KEYS;
+    uint32_t q = BENCH_LOOKUPS;
+    Fastmap_Hash64 *map = fastmap_Hash64_init();
+    for (uint32_t i = 0; i < n; i++)
+        fastmap_Hash64_put(map, i * 7)->value = i;
+
+    uint32_t *keys = (uint32_t *)xxmalloc(q * sizeof(uint32_t));
+    FastmapNode_Hash64 **nodes = (FastmapNode_Hash64 **)xxmalloc(q * sizeof(FastmapNode_Hash64 *));
+    uint32_t state = 1;
+    for (uint32_t i = 0; i < q; i++)
+    {
+        state = state * 1103515245u + 12345u;
+        keys[i] = (state >> 4) % n * 7 + ((i & 7) == 0);
+    }
+
+    uint64_t single = 0, batch = 0;
+    double t0 = bench_now();
+    for (uint32_t i = 0; i < q; i++)
+    {
+        FastmapNode_Hash64 *node = fastmap_Hash64_get(map, keys[i]);
+        single += node ? node->value : 0;
+    }
+    double t1 = bench_now();
+    fastmap_Hash64_get_batch(map, keys, q, nodes);
+    for (uint32_t i = 0; i < q; i++)
+        batch += nodes[i] ? nodes[i]->value : 0;
+    double t2 = bench_now();
+    sink += single + batch;
+
+    printf("fastmap lookup: get %6.2f ns  get_batch %6.2f ns%s\n", (t1 - t0) / q * 1e9, (t2 - t1) / q * 1e9,
+           single == batch ? "" : "  MISMATCH");
+    xxfree(keys, q * sizeof(uint32_t));
+    xxfree(nodes, q * sizeof(FastmapNode_Hash64 *));
+    fastmap_Hash64_destroy(map);
+}
+
+int main()
+{
+    bench_hash_speed();
+    bench_hash_quality();
+    bench_fastmap_probes();
+    bench_fastmap_batch();
+    return 0;
+}
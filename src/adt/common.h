@@ -3,10 +3,11 @@
 #include <memory.h>
 #include "math/edge.h"
 #include "math/vec3.h"
-#include "adt/murmur.h"
+#include "adt/hash.h"
 #include <string.h>
 
 #include "adt/str.h"
+#include "adt/atom.h"
 
 inline static int adt_compare_vec3(Vec3 a, Vec3 b)
 {
@@ -17,7 +18,7 @@ inline static int adt_compare_vec3(Vec3 a, Vec3 b)
 
 inline static uint64_t adt_hashof_vec3(Vec3 key, uint64_t seed)
 {
-    return murmurhash((char *)(&key), 12, seed);
+    return hash64_12(&key, seed);
 }
 
 inline static int adt_compare_edge(Edge a, Edge b)
@@ -39,7 +40,7 @@ inline static int adt_compare_cstr(const char *a, const char *b)
 
 inline static uint64_t adt_hashof_cstr(const char *key, uint64_t seed)
 {
-    return murmurhash(key, strlen(key), seed);
+    return hash64(key, strlen(key), seed);
 }
 
 inline static int adt_compare_string(const StrView a, const StrView b)
@@ -49,8 +50,14 @@ inline static int adt_compare_string(const StrView a, const StrView b)
 
 inline static uint64_t adt_hashof_string(const StrView key, uint64_t seed)
 {
-    return murmurhash(key.string, key.length, seed);
+    return hash64(key.string, key.length, seed);
+}
+
+// atoms carry their string hash, so maps keyed on them never touch the bytes
+inline static uint64_t adt_hashof_atom(Atom key, uint64_t seed)
+{
+    return atom_hash(key) ^ seed;
 }
 
 #define adt_compare_primitive(a, b) ((a) - (b))
-#define adt_hashof_primitive(key, seed) (murmurhash((char *)(&(key)), sizeof(key), (seed)))
\ No newline at end of file
+#define adt_hashof_primitive(key, seed) (hash64(&(key), sizeof(key), (seed)))
\ No newline at end of file
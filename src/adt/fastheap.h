@@ -3,6 +3,8 @@
 #include "fast.h"
 
 #define __fastheap_type(t_name) Fastheap_##t_name
+#define __fastiheap_node_type(t_name) FastiheapNode_##t_name
+#define __fastiheap_type(t_name) Fastiheap_##t_name
 
 #define make_fastheap_directives(t_name, t_key, t_compare)                                       \
     typedef struct                                                                               \
@@ -14,10 +16,10 @@
                                                                                                  \
     inline static __fastheap_type(t_name) * fastheap_##t_name##_init(int cap)                    \
     {                                                                                            \
-        __fastheap_type(t_name) *self = xxmalloc(sizeof(__fastheap_type(t_name)));               \
+        __fastheap_type(t_name) *self = adt_malloc(sizeof(__fastheap_type(t_name)));             \
         self->capacity = cap;                                                                    \
         self->length = 0;                                                                        \
-        self->vector = xxmalloc(self->capacity * sizeof(t_key));                                 \
+        self->vector = adt_malloc(self->capacity * sizeof(t_key));                               \
         return self;                                                                             \
     }                                                                                            \
     inline static void fastheap_##t_name##_destroy(__fastheap_type(t_name) * self)               \
@@ -64,7 +66,7 @@
         {                                                                                        \
             int nOldCap = self->capacity;                                                        \
             self->capacity = self->capacity << 1;                                                \
-            t_key *vector = xxmalloc(self->capacity * sizeof(t_key));                            \
+            t_key *vector = adt_malloc(self->capacity * sizeof(t_key));                          \
             memcpy(vector, self->vector, nOldCap * sizeof(t_key));                               \
             xxfree(self->vector, nOldCap * sizeof(t_key));                                       \
             self->vector = vector;                                                               \
@@ -91,3 +93,213 @@
     {                                                                                            \
         self->length = 0;                                                                        \
     }
+
+// indexed 4-ary heap. entries are addressed by a caller chosen handle in [0, n) so priorities can be
+// changed in place instead of pushing duplicates. same ordering as fastheap, the entry t_compare ranks
+// highest sits on top
+#define make_fastiheap_directives(t_name, t_key, t_compare)                                                                          \
+    typedef struct                                                                                                                   \
+    {                                                                                                                                \
+        t_key key;                                                                                                                   \
+        int handle;                                                                                                                  \
+    } __fastiheap_node_type(t_name);                                                                                                 \
+                                                                                                                                     \
+    typedef struct                                                                                                                   \
+    {                                                                                                                                \
+        int length;                                                                                                                  \
+        int capacity;                                                                                                                \
+        int handles;                                                                                                                 \
+        __fastiheap_node_type(t_name) * vector;                                                                                      \
+        int *slots;                                                                                                                  \
+    } __fastiheap_type(t_name);                                                                                                      \
+                                                                                                                                     \
+    inline static __fastiheap_type(t_name) * fastiheap_##t_name##_init(int cap)                                                      \
+    {                                                                                                                                \
+        __fastiheap_type(t_name) *self = adt_malloc(sizeof(__fastiheap_type(t_name)));                                               \
+        self->capacity = cap > 0 ? cap : 1;                                                                                          \
+        self->handles = self->capacity;                                                                                              \
+        self->length = 0;                                                                                                            \
+        self->vector = adt_malloc(self->capacity * sizeof(__fastiheap_node_type(t_name)));                                           \
+        self->slots = adt_malloc(self->handles * sizeof(int));                                                                       \
+        memset(self->slots, 0xff, self->handles * sizeof(int));                                                                      \
+        return self;                                                                                                                 \
+    }                                                                                                                                \
+    inline static void fastiheap_##t_name##_destroy(__fastiheap_type(t_name) * self)                                                 \
+    {                                                                                                                                \
+        xxfree(self->vector, self->capacity * sizeof(__fastiheap_node_type(t_name)));                                                \
+        xxfree(self->slots, self->handles * sizeof(int));                                                                            \
+        xxfree(self, sizeof(__fastiheap_type(t_name)));                                                                              \
+    }                                                                                                                                \
+    inline static void __fastiheap_##t_name##_reserve(__fastiheap_type(t_name) * self, int length, int handle)                       \
+    {                                                                                                                                \
+        if (length > self->capacity)                                                                                                 \
+        {                                                                                                                            \
+            int nOldCap = self->capacity;                                                                                            \
+            while (self->capacity < length)                                                                                          \
+                self->capacity = self->capacity << 1;                                                                                \
+            __fastiheap_node_type(t_name) *vector = adt_malloc(self->capacity * sizeof(__fastiheap_node_type(t_name)));              \
+            memcpy(vector, self->vector, nOldCap * sizeof(__fastiheap_node_type(t_name)));                                           \
+            xxfree(self->vector, nOldCap * sizeof(__fastiheap_node_type(t_name)));                                                   \
+            self->vector = vector;                                                                                                   \
+        }                                                                                                                            \
+        if (handle >= self->handles)                                                                                                 \
+        {                                                                                                                            \
+            int nOldHandles = self->handles;                                                                                         \
+            while (self->handles <= handle)                                                                                          \
+                self->handles = self->handles << 1;                                                                                  \
+            int *slots = adt_malloc(self->handles * sizeof(int));                                                                    \
+            memcpy(slots, self->slots, nOldHandles * sizeof(int));                                                                   \
+            memset(slots + nOldHandles, 0xff, (self->handles - nOldHandles) * sizeof(int));                                          \
+            xxfree(self->slots, nOldHandles * sizeof(int));                                                                          \
+            self->slots = slots;                                                                                                     \
+        }                                                                                                                            \
+    }                                                                                                                                \
+    /* moves the entry at index towards the top, shifting parents down into the hole */                                              \
+    inline static void __fastiheap_##t_name##_sortup(__fastiheap_type(t_name) * self, int index)                                     \
+    {                                                                                                                                \
+        __fastiheap_node_type(t_name) node = self->vector[index];                                                                    \
+        while (index > 0)                                                                                                            \
+        {                                                                                                                            \
+            int parent = (index - 1) >> 2;                                                                                           \
+            if (t_compare(self->vector[parent].key, node.key) >= 0)                                                                  \
+                break;                                                                                                               \
+            self->vector[index] = self->vector[parent];                                                                              \
+            self->slots[self->vector[index].handle] = index;                                                                         \
+            index = parent;                                                                                                          \
+        }                                                                                                                            \
+        self->vector[index] = node;                                                                                                  \
+        self->slots[node.handle] = index;                                                                                            \
+    }                                                                                                                                \
+    inline static void __fastiheap_##t_name##_sortdown(__fastiheap_type(t_name) * self, int index)                                   \
+    {                                                                                                                                \
+        __fastiheap_node_type(t_name) node = self->vector[index];                                                                    \
+        while (1)                                                                                                                    \
+        {                                                                                                                            \
+            int first = (index << 2) + 1;                                                                                            \
+            if (first >= self->length)                                                                                               \
+                break;                                                                                                               \
+            int last = first + 4 < self->length ? first + 4 : self->length;                                                          \
+            int next = first;                                                                                                        \
+            for (int i = first + 1; i < last; i++)                                                                                   \
+                if (t_compare(self->vector[i].key, self->vector[next].key) > 0)                                                      \
+                    next = i;                                                                                                        \
+            if (t_compare(node.key, self->vector[next].key) >= 0)                                                                    \
+                break;                                                                                                               \
+            self->vector[index] = self->vector[next];                                                                                \
+            self->slots[self->vector[index].handle] = index;                                                                         \
+            index = next;                                                                                                            \
+        }                                                                                                                            \
+        self->vector[index] = node;                                                                                                  \
+        self->slots[node.handle] = index;                                                                                            \
+    }                                                                                                                                \
+    inline static bool fastiheap_##t_name##_contains(__fastiheap_type(t_name) * self, int handle)                                    \
+    {                                                                                                                                \
+        return handle >= 0 && handle < self->handles && self->slots[handle] >= 0;                                                    \
+    }                                                                                                                                \
+    inline static t_key *fastiheap_##t_name##_get(__fastiheap_type(t_name) * self, int handle)                                       \
+    {                                                                                                                                \
+        if (!fastiheap_##t_name##_contains(self, handle))                                                                            \
+            return NULL;                                                                                                             \
+        return &self->vector[self->slots[handle]].key;                                                                               \
+    }                                                                                                                                \
+    /* moves the entry to wherever value belongs */                                                                                  \
+    inline static void fastiheap_##t_name##_update(__fastiheap_type(t_name) * self, int handle, t_key value)                         \
+    {                                                                                                                                \
+        int index = self->slots[handle];                                                                                             \
+        int cmp = t_compare(value, self->vector[index].key);                                                                         \
+        self->vector[index].key = value;                                                                                             \
+        if (cmp > 0)                                                                                                                 \
+            __fastiheap_##t_name##_sortup(self, index);                                                                              \
+        else if (cmp < 0)                                                                                                            \
+            __fastiheap_##t_name##_sortdown(self, index);                                                                            \
+    }                                                                                                                                \
+    /* value must rank at least as high as the current one, e.g. a shorter distance in dijkstra */                                   \
+    inline static void fastiheap_##t_name##_decrease_key(__fastiheap_type(t_name) * self, int handle, t_key value)                   \
+    {                                                                                                                                \
+        int index = self->slots[handle];                                                                                             \
+        self->vector[index].key = value;                                                                                             \
+        __fastiheap_##t_name##_sortup(self, index);                                                                                  \
+    }                                                                                                                                \
+    /* inserts the handle, or updates it when it is already queued */                                                                \
+    inline static void fastiheap_##t_name##_push(__fastiheap_type(t_name) * self, int handle, t_key value)                           \
+    {                                                                                                                                \
+        if (fastiheap_##t_name##_contains(self, handle))                                                                             \
+        {                                                                                                                            \
+            fastiheap_##t_name##_update(self, handle, value);                                                                        \
+            return;                                                                                                                  \
+        }                                                                                                                            \
+        __fastiheap_##t_name##_reserve(self, self->length + 1, handle);                                                              \
+        int index = self->length++;                                                                                                  \
+        self->vector[index].key = value;                                                                                             \
+        self->vector[index].handle = handle;                                                                                         \
+        __fastiheap_##t_name##_sortup(self, index);                                                                                  \
+    }                                                                                                                                \
+    inline static bool fastiheap_##t_name##_remove(__fastiheap_type(t_name) * self, int handle)                                      \
+    {                                                                                                                                \
+        if (!fastiheap_##t_name##_contains(self, handle))                                                                            \
+            return false;                                                                                                            \
+        int index = self->slots[handle];                                                                                             \
+        self->slots[handle] = -1;                                                                                                    \
+        if (index == --self->length)                                                                                                 \
+            return true;                                                                                                             \
+        __fastiheap_node_type(t_name) last = self->vector[self->length];                                                             \
+        int cmp = t_compare(last.key, self->vector[index].key);                                                                      \
+        self->vector[index] = last;                                                                                                  \
+        self->slots[last.handle] = index;                                                                                            \
+        if (cmp > 0)                                                                                                                 \
+            __fastiheap_##t_name##_sortup(self, index);                                                                              \
+        else                                                                                                                         \
+            __fastiheap_##t_name##_sortdown(self, index);                                                                            \
+        return true;                                                                                                                 \
+    }                                                                                                                                \
+    /* pops the top entry, handle may be NULL */                                                                                     \
+    inline static t_key fastiheap_##t_name##_pop(__fastiheap_type(t_name) * self, int *handle)                                       \
+    {                                                                                                                                \
+        __fastiheap_node_type(t_name) root = self->vector[0];                                                                        \
+        self->slots[root.handle] = -1;                                                                                               \
+        if (--self->length > 0)                                                                                                      \
+        {                                                                                                                            \
+            self->vector[0] = self->vector[self->length];                                                                            \
+            __fastiheap_##t_name##_sortdown(self, 0);                                                                                \
+        }                                                                                                                            \
+        if (handle)                                                                                                                  \
+            *handle = root.handle;                                                                                                   \
+        return root.key;                                                                                                             \
+    }                                                                                                                                \
+    inline static t_key *fastiheap_##t_name##_top(__fastiheap_type(t_name) * self)                                                   \
+    {                                                                                                                                \
+        return &self->vector[0].key;                                                                                                 \
+    }                                                                                                                                \
+    inline static int fastiheap_##t_name##_top_handle(__fastiheap_type(t_name) * self)                                               \
+    {                                                                                                                                \
+        return self->vector[0].handle;                                                                                               \
+    }                                                                                                                                \
+    inline static bool fastiheap_##t_name##_empty(__fastiheap_type(t_name) * self)                                                   \
+    {                                                                                                                                \
+        return self->length == 0;                                                                                                    \
+    }                                                                                                                                \
+    inline static void fastiheap_##t_name##_clear(__fastiheap_type(t_name) * self)                                                   \
+    {                                                                                                                                \
+        for (int i = 0; i < self->length; i++)                                                                                       \
+            self->slots[self->vector[i].handle] = -1;                                                                                \
+        self->length = 0;                                                                                                            \
+    }                                                                                                                                \
+    /* replaces the contents in O(n), handles may be NULL to use 0..n-1, and must be unique */                                       \
+    inline static void fastiheap_##t_name##_heapify(__fastiheap_type(t_name) * self, const t_key *values, const int *handles, int n) \
+    {                                                                                                                                \
+        fastiheap_##t_name##_clear(self);                                                                                            \
+        int top = n - 1;                                                                                                             \
+        if (handles)                                                                                                                 \
+            for (int i = 0; i < n; i++)                                                                                              \
+                top = handles[i] > top ? handles[i] : top;                                                                           \
+        __fastiheap_##t_name##_reserve(self, n, top);                                                                                \
+        for (int i = 0; i < n; i++)                                                                                                  \
+        {                                                                                                                            \
+            self->vector[i].key = values[i];                                                                                         \
+            self->vector[i].handle = handles ? handles[i] : i;                                                                       \
+            self->slots[self->vector[i].handle] = i;                                                                                 \
+        }                                                                                                                            \
+        self->length = n;                                                                                                            \
+        for (int i = (n - 2) >> 2; i >= 0; i--)                                                                                      \
+            __fastiheap_##t_name##_sortdown(self, i);                                                                                \
+    }
@@ -27,7 +27,6 @@
         __fastmap_group_type(t_name) * groups;                                                                                                           \
         uint32_t length;                                                                                                                                 \
         uint64_t groupSize;                                                                                                                              \
-        uint32_t primeIndex;                                                                                                                             \
         uint32_t seed;                                                                                                                                   \
         double loadFactor;                                                                                                                               \
     } __fastmap_map_type(t_name);                                                                                                                        \
@@ -60,6 +59,7 @@
     }                                                                                                                                                    \
                                                                                                                                                          \
     inline static __fastmap_node_type(t_name) * fastmap_##t_name##_put(__fastmap_map_type(t_name) * self, t_key key);                                    \
+    inline static __fastmap_node_type(t_name) * fastmap_##t_name##_get(__fastmap_map_type(t_name) * self, t_key key);                                    \
                                                                                                                                                          \
     inline static __fastmap_itter_type(t_name) __fastmap_##t_name##_itter_init(__fastmap_group_type(t_name) * begin, __fastmap_group_type(t_name) * end) \
     {                                                                                                                                                    \
@@ -85,7 +85,7 @@
     inline static void __fastmap_##t_name##_reserve(__fastmap_map_type(t_name) * self, uint32_t newSize)                                                 \
     {                                                                                                                                                    \
         uint32_t size = newSize * sizeof(__fastmap_group_type(t_name));                                                                                  \
-        self->groups = (__fastmap_group_type(t_name) *)xxmalloc(size);                                                                                   \
+        self->groups = (__fastmap_group_type(t_name) *)adt_malloc(size);                                                                                 \
         memset(self->groups, 0, size);                                                                                                                   \
         for (uint32_t i = 0; i < newSize; i++)                                                                                                           \
             self->groups[i].control = __fast_set1_epi8(__fast_enum_empty);                                                                               \
@@ -121,29 +121,24 @@
         self->loadFactor = ((double)self->length / (self->groupSize << 4));                                                                              \
         if (force || self->loadFactor >= 0.5f)                                                                                                           \
         {                                                                                                                                                \
-            __fastmap__##t_name##_rehash(self, __fast_primes[self->primeIndex++]);                                                                       \
+            __fastmap__##t_name##_rehash(self, self->groupSize << 1);                                                                                    \
         }                                                                                                                                                \
     }                                                                                                                                                    \
                                                                                                                                                          \
     inline static void __fastmap__##t_name##_rehash_fit(__fastmap_map_type(t_name) * self)                                                               \
     {                                                                                                                                                    \
-        for (int i = 0; i < 90; i++)                                                                                                                     \
-        {                                                                                                                                                \
-            if (__fast_primes[i] > (self->length >> 4))                                                                                                  \
-            {                                                                                                                                            \
-                self->primeIndex = i;                                                                                                                    \
-                __fastmap__##t_name##_rehash(self, __fast_primes[self->primeIndex]);                                                                     \
-                return;                                                                                                                                  \
-            }                                                                                                                                            \
-        }                                                                                                                                                \
+        /* smallest power of two keeping the load under 0.5 */                                                                                           \
+        uint32_t groups = 1;                                                                                                                             \
+        while ((groups << 3) <= self->length)                                                                                                            \
+            groups <<= 1;                                                                                                                                \
+        __fastmap__##t_name##_rehash(self, groups);                                                                                                      \
     }                                                                                                                                                    \
                                                                                                                                                          \
     inline static __fastmap_map_type(t_name) * fastmap_##t_name##_init()                                                                                 \
     {                                                                                                                                                    \
-        __fastmap_map_type(t_name) *self = (__fastmap_map_type(t_name) *)xxmalloc(sizeof(__fastmap_map_type(t_name)));                                   \
+        __fastmap_map_type(t_name) *self = (__fastmap_map_type(t_name) *)adt_malloc(sizeof(__fastmap_map_type(t_name)));                                 \
         self->length = 0;                                                                                                                                \
         self->groupSize = 0;                                                                                                                             \
-        self->primeIndex = 0;                                                                                                                            \
         self->seed = 0;                                                                                                                                  \
         self->loadFactor = 0;                                                                                                                            \
         __fastmap_##t_name##_reserve(self, 1);                                                                                                           \
@@ -153,8 +148,11 @@
     inline static __fastmap_node_type(t_name) * fastmap_##t_name##_put(__fastmap_map_type(t_name) * self, t_key key)                                     \
     {                                                                                                                                                    \
         __fastmap__##t_name##_rehash_grow(self, 0);                                                                                                      \
+        __fastmap_node_type(t_name) *node = fastmap_##t_name##_get(self, key);                                                                           \
+        if (node)                                                                                                                                        \
+            return node;                                                                                                                                 \
         uint64_t hash = t_hash(key, self->seed);                                                                                                         \
-        uint64_t groupIndex = __fast_h1(hash) % self->groupSize;                                                                                         \
+        uint64_t groupIndex = __fast_h1(hash) & (self->groupSize - 1);                                                                                   \
         uint8_t h2 = __fast_h2(hash);                                                                                                                    \
         __fastmap_group_type(t_name) * g;                                                                                                                \
         uint16_t matches;                                                                                                                                \
@@ -162,20 +160,11 @@
         while (1)                                                                                                                                        \
         {                                                                                                                                                \
             g = &self->groups[groupIndex];                                                                                                               \
-            matches = __fast_match(g->control, h2);                                                                                                      \
-            int8_t i = 0;                                                                                                                                \
-            while (matches)                                                                                                                              \
-            {                                                                                                                                            \
-                if ((matches & 1) && t_compare(g->nodes[i].key, key) == 0)                                                                                    \
-                    return &g->nodes[i];                                                                                                                 \
-                matches >>= 1;                                                                                                                           \
-                i++;                                                                                                                                     \
-            }                                                                                                                                            \
             matches = __fast_match_empty(g->control);                                                                                                    \
             if (matches)                                                                                                                                 \
                 break;                                                                                                                                   \
             g->overflow = 1;                                                                                                                             \
-            groupIndex = (groupIndex + 1) % self->groupSize;                                                                                             \
+            groupIndex = (groupIndex + 1) & (self->groupSize - 1);                                                                                       \
             ovf++;                                                                                                                                       \
         }                                                                                                                                                \
         if (ovf > 1)                                                                                                                                     \
@@ -183,18 +172,7 @@
             __fastmap__##t_name##_rehash_grow(self, 1);                                                                                                  \
             return fastmap_##t_name##_put(self, key);                                                                                                    \
         }                                                                                                                                                \
-        int8_t freeIndex = 0;                                                                                                                            \
-        int8_t i = 0;                                                                                                                                    \
-        while (matches)                                                                                                                                  \
-        {                                                                                                                                                \
-            if (matches & 1)                                                                                                                             \
-            {                                                                                                                                            \
-                freeIndex = i;                                                                                                                           \
-                break;                                                                                                                                   \
-            }                                                                                                                                            \
-            matches >>= 1;                                                                                                                               \
-            i++;                                                                                                                                         \
-        }                                                                                                                                                \
+        int8_t freeIndex = (int8_t)__builtin_ctz(matches);                                                                                               \
         uint8_t *simdArray = (uint8_t *)(&g->control);                                                                                                   \
         simdArray[freeIndex] = h2;                                                                                                                       \
         g->nodes[freeIndex].key = key;                                                                                                                   \
@@ -202,34 +180,52 @@
         return &g->nodes[freeIndex];                                                                                                                     \
     }                                                                                                                                                    \
                                                                                                                                                          \
-    inline static __fastmap_node_type(t_name) * fastmap_##t_name##_get(__fastmap_map_type(t_name) * self, t_key key)                                     \
+    inline static __fastmap_node_type(t_name) * __fastmap_##t_name##_find(__fastmap_map_type(t_name) * self, t_key key, uint64_t hash)                   \
     {                                                                                                                                                    \
-        uint64_t hash = t_hash(key, self->seed);                                                                                                         \
-        uint64_t groupIndex = __fast_h1(hash) % self->groupSize;                                                                                         \
+        uint64_t groupIndex = __fast_h1(hash) & (self->groupSize - 1);                                                                                   \
         uint8_t h2 = __fast_h2(hash);                                                                                                                    \
         __fastmap_group_type(t_name) * g;                                                                                                                \
         uint16_t matches;                                                                                                                                \
-        while (1)                                                                                                                                        \
+        for (uint64_t probe = 0; probe < self->groupSize; probe++)                                                                                       \
         {                                                                                                                                                \
             g = &self->groups[groupIndex];                                                                                                               \
             matches = __fast_match(g->control, h2);                                                                                                      \
-            int8_t i = 0;                                                                                                                                \
             while (matches)                                                                                                                              \
             {                                                                                                                                            \
-                if ((matches & 1) && t_compare(g->nodes[i].key, key) == 0)                                                                                    \
+                int i = __builtin_ctz(matches);                                                                                                          \
+                if (t_compare(g->nodes[i].key, key) == 0)                                                                                                \
                     return &g->nodes[i];                                                                                                                 \
-                matches >>= 1;                                                                                                                           \
-                i++;                                                                                                                                     \
+                matches &= matches - 1;                                                                                                                  \
             }                                                                                                                                            \
-            if (__fast_match_empty(g->control))                                                                                                          \
-                break;                                                                                                                                   \
             if (!g->overflow)                                                                                                                            \
                 break;                                                                                                                                   \
-            groupIndex = (groupIndex + 1) % self->groupSize;                                                                                             \
+            groupIndex = (groupIndex + 1) & (self->groupSize - 1);                                                                                       \
         }                                                                                                                                                \
         return NULL;                                                                                                                                     \
     }                                                                                                                                                    \
                                                                                                                                                          \
+    inline static __fastmap_node_type(t_name) * fastmap_##t_name##_get(__fastmap_map_type(t_name) * self, t_key key)                                     \
+    {                                                                                                                                                    \
+        return __fastmap_##t_name##_find(self, key, t_hash(key, self->seed));                                                                            \
+    }                                                                                                                                                    \
+                                                                                                                                                         \
+    /* hashes a run of keys and prefetches their groups before probing any of them */                                                                    \
+    inline static void fastmap_##t_name##_get_batch(__fastmap_map_type(t_name) * self, const t_key *keys, uint32_t n, __fastmap_node_type(t_name) **out) \
+    {                                                                                                                                                    \
+        uint64_t hashes[__fast_batch];                                                                                                                   \
+        for (uint32_t base = 0; base < n; base += __fast_batch)                                                                                          \
+        {                                                                                                                                                \
+            uint32_t count = n - base < __fast_batch ? n - base : __fast_batch;                                                                          \
+            for (uint32_t i = 0; i < count; i++)                                                                                                         \
+            {                                                                                                                                            \
+                hashes[i] = t_hash(keys[base + i], self->seed);                                                                                          \
+                __builtin_prefetch(&self->groups[__fast_h1(hashes[i]) & (self->groupSize - 1)].control);                                                 \
+            }                                                                                                                                            \
+            for (uint32_t i = 0; i < count; i++)                                                                                                         \
+                out[base + i] = __fastmap_##t_name##_find(self, keys[base + i], hashes[i]);                                                              \
+        }                                                                                                                                                \
+    }                                                                                                                                                    \
+                                                                                                                                                         \
     inline static void fastmap_##t_name##_clear(__fastmap_map_type(t_name) * self)                                                                       \
     {                                                                                                                                                    \
         __fastmap_group_type(t_name) *oldGroups = self->groups;                                                                                          \
@@ -248,30 +244,29 @@
     inline static bool fastmap_##t_name##_remove(__fastmap_map_type(t_name) * self, t_key key)                                                           \
     {                                                                                                                                                    \
         uint64_t hash = t_hash(key, self->seed);                                                                                                         \
-        uint64_t groupIndex = __fast_h1(hash) % self->groupSize;                                                                                         \
+        uint64_t groupIndex = __fast_h1(hash) & (self->groupSize - 1);                                                                                   \
         uint8_t h2 = __fast_h2(hash);                                                                                                                    \
         __fastmap_group_type(t_name) * g;                                                                                                                \
         uint16_t matches;                                                                                                                                \
-        while (1)                                                                                                                                        \
+        for (uint64_t probe = 0; probe < self->groupSize; probe++)                                                                                       \
         {                                                                                                                                                \
             g = &self->groups[groupIndex];                                                                                                               \
             matches = __fast_match(g->control, h2);                                                                                                      \
-            int8_t i = 0;                                                                                                                                \
             while (matches)                                                                                                                              \
             {                                                                                                                                            \
-                if ((matches & 1) && t_compare(g->nodes[i].key, key) == 0)                                                                                    \
+                int i = __builtin_ctz(matches);                                                                                                          \
+                if (t_compare(g->nodes[i].key, key) == 0)                                                                                                \
                 {                                                                                                                                        \
                     uint8_t *simdArray = (uint8_t *)(&g->control);                                                                                       \
                     simdArray[i] = __fast_enum_deleted;                                                                                                  \
                     self->length--;                                                                                                                      \
                     return true;                                                                                                                         \
                 }                                                                                                                                        \
-                matches >>= 1;                                                                                                                           \
-                i++;                                                                                                                                     \
+                matches &= matches - 1;                                                                                                                  \
             }                                                                                                                                            \
             if (!g->overflow)                                                                                                                            \
                 break;                                                                                                                                   \
-            groupIndex = (groupIndex + 1) % self->groupSize;                                                                                             \
+            groupIndex = (groupIndex + 1) & (self->groupSize - 1);                                                                                       \
         }                                                                                                                                                \
         return false;                                                                                                                                    \
     }                                                                                                                                                    \
@@ -1,8 +1,13 @@
 #pragma once
 
+#include <stdatomic.h>
+
 #include "fast.h"
 
 #define __fastqu_type(t_name) Fastqu_##t_name
+#define __fastspsc_type(t_name) Fastspsc_##t_name
+#define __fastmpmc_cell_type(t_name) __fastmpmccell_##t_name##_t
+#define __fastmpmc_type(t_name) Fastmpmc_##t_name
 
 #define make_fastqu_directives(t_name, t_key)                                            \
     typedef struct                                                                       \
@@ -15,11 +20,11 @@
                                                                                          \
     inline static __fastqu_type(t_name) * fastqu_##t_name##_init(int cap)                \
     {                                                                                    \
-        __fastqu_type(t_name) *self = xxmalloc(sizeof(__fastqu_type(t_name)));           \
+        __fastqu_type(t_name) *self = adt_malloc(sizeof(__fastqu_type(t_name)));         \
         self->capacity = cap;                                                            \
         self->head = 0;                                                                  \
         self->tail = 0;                                                                  \
-        self->vector = xxmalloc(self->capacity * sizeof(t_key));                         \
+        self->vector = adt_malloc(self->capacity * sizeof(t_key));                       \
         return self;                                                                     \
     }                                                                                    \
     inline static void fastqu_##t_name##_destroy(__fastqu_type(t_name) * self)           \
@@ -37,7 +42,7 @@
     inline static t_key fastqu_##t_name##_pop(__fastqu_type(t_name) * self)              \
     {                                                                                    \
         t_key value = self->vector[self->head];                                          \
-        self->head = (self->head + 1) % mCapacity;                                       \
+        self->head = (self->head + 1) % self->capacity;                                  \
         return value;                                                                    \
     }                                                                                    \
     inline static bool fastqu_##t_name##_empty(__fastqu_type(t_name) * self)             \
@@ -61,4 +66,227 @@
     {                                                                                    \
         self->head = 0;                                                                  \
         self->tail = 0;                                                                  \
-    }
\ No newline at end of file
+    }
+
+// lock-free single producer, single consumer ring. capacity is rounded up to a power of two,
+// head and tail are free running counters kept on separate cache lines, and each side keeps
+// a cached copy of the other side's counter so it only touches the shared line when it has to
+#define make_fastspsc_directives(t_name, t_key)                                                                        \
+    typedef struct                                                                                                     \
+    {                                                                                                                  \
+        t_key *vector;                                                                                                 \
+        uint32_t mask;                                                                                                 \
+        char __pad0[__fast_cacheline];                                                                                 \
+        _Atomic uint32_t head;                                                                                         \
+        uint32_t tailCache;                                                                                            \
+        char __pad1[__fast_cacheline];                                                                                 \
+        _Atomic uint32_t tail;                                                                                         \
+        uint32_t headCache;                                                                                            \
+        char __pad2[__fast_cacheline];                                                                                 \
+    } __fastspsc_type(t_name);                                                                                         \
+                                                                                                                       \
+    inline static __fastspsc_type(t_name) * fastspsc_##t_name##_init(uint32_t cap)                                     \
+    {                                                                                                                  \
+        __fastspsc_type(t_name) *self = adt_malloc(sizeof(__fastspsc_type(t_name)));                                   \
+        cap = __fast_next_pow2(cap);                                                                                   \
+        self->mask = cap - 1;                                                                                          \
+        self->vector = adt_malloc(cap * sizeof(t_key));                                                                \
+        atomic_init(&self->head, 0);                                                                                   \
+        atomic_init(&self->tail, 0);                                                                                   \
+        self->tailCache = 0;                                                                                           \
+        self->headCache = 0;                                                                                           \
+        return self;                                                                                                   \
+    }                                                                                                                  \
+    inline static void fastspsc_##t_name##_destroy(__fastspsc_type(t_name) * self)                                     \
+    {                                                                                                                  \
+        xxfree(self->vector, (self->mask + 1) * sizeof(t_key));                                                        \
+        xxfree(self, sizeof(__fastspsc_type(t_name)));                                                                 \
+    }                                                                                                                  \
+    /* producer side, returns how many of the n values fit */                                                          \
+    inline static uint32_t fastspsc_##t_name##_push_n(__fastspsc_type(t_name) * self, const t_key *values, uint32_t n) \
+    {                                                                                                                  \
+        if (n == 0)                                                                                                    \
+            return 0;                                                                                                  \
+        uint32_t tail = atomic_load_explicit(&self->tail, memory_order_relaxed);                                       \
+        uint32_t space = self->mask + 1 - (tail - self->headCache);                                                    \
+        if (space < n)                                                                                                 \
+        {                                                                                                              \
+            self->headCache = atomic_load_explicit(&self->head, memory_order_acquire);                                 \
+            space = self->mask + 1 - (tail - self->headCache);                                                         \
+        }                                                                                                              \
+        if (n > space)                                                                                                 \
+            n = space;                                                                                                 \
+        for (uint32_t i = 0; i < n; i++)                                                                               \
+            self->vector[(tail + i) & self->mask] = values[i];                                                         \
+        atomic_store_explicit(&self->tail, tail + n, memory_order_release);                                            \
+        return n;                                                                                                      \
+    }                                                                                                                  \
+    inline static bool fastspsc_##t_name##_push(__fastspsc_type(t_name) * self, t_key value)                           \
+    {                                                                                                                  \
+        return fastspsc_##t_name##_push_n(self, &value, 1) == 1;                                                       \
+    }                                                                                                                  \
+    /* consumer side, returns how many values were written to out */                                                   \
+    inline static uint32_t fastspsc_##t_name##_pop_n(__fastspsc_type(t_name) * self, t_key *out, uint32_t n)           \
+    {                                                                                                                  \
+        if (n == 0)                                                                                                    \
+            return 0;                                                                                                  \
+        uint32_t head = atomic_load_explicit(&self->head, memory_order_relaxed);                                       \
+        uint32_t ready = self->tailCache - head;                                                                       \
+        if (ready < n)                                                                                                 \
+        {                                                                                                              \
+            self->tailCache = atomic_load_explicit(&self->tail, memory_order_acquire);                                 \
+            ready = self->tailCache - head;                                                                            \
+        }                                                                                                              \
+        if (n > ready)                                                                                                 \
+            n = ready;                                                                                                 \
+        for (uint32_t i = 0; i < n; i++)                                                                               \
+            out[i] = self->vector[(head + i) & self->mask];                                                            \
+        atomic_store_explicit(&self->head, head + n, memory_order_release);                                            \
+        return n;                                                                                                      \
+    }                                                                                                                  \
+    inline static bool fastspsc_##t_name##_pop(__fastspsc_type(t_name) * self, t_key *out)                             \
+    {                                                                                                                  \
+        return fastspsc_##t_name##_pop_n(self, out, 1) == 1;                                                           \
+    }                                                                                                                  \
+    /* exact only from the producer or consumer thread, a snapshot from anywhere else */                               \
+    inline static uint32_t fastspsc_##t_name##_length(__fastspsc_type(t_name) * self)                                  \
+    {                                                                                                                  \
+        uint32_t head = atomic_load_explicit(&self->head, memory_order_acquire);                                       \
+        return atomic_load_explicit(&self->tail, memory_order_acquire) - head;                                         \
+    }                                                                                                                  \
+    inline static bool fastspsc_##t_name##_empty(__fastspsc_type(t_name) * self)                                       \
+    {                                                                                                                  \
+        return fastspsc_##t_name##_length(self) == 0;                                                                  \
+    }
+
+// bounded lock-free multi producer, multi consumer ring. every cell carries a sequence number
+// telling whether it is free for the current lap or holds a value, so producers and consumers
+// only contend on their own counter. batches claim a run of ready cells with a single cas
+#define make_fastmpmc_directives(t_name, t_key)                                                                                       \
+    typedef struct                                                                                                                    \
+    {                                                                                                                                 \
+        _Atomic uint32_t sequence;                                                                                                    \
+        t_key value;                                                                                                                  \
+    } __fastmpmc_cell_type(t_name);                                                                                                   \
+                                                                                                                                      \
+    typedef struct                                                                                                                    \
+    {                                                                                                                                 \
+        __fastmpmc_cell_type(t_name) * cells;                                                                                         \
+        uint32_t mask;                                                                                                                \
+        char __pad0[__fast_cacheline];                                                                                                \
+        _Atomic uint32_t enqueue;                                                                                                     \
+        char __pad1[__fast_cacheline];                                                                                                \
+        _Atomic uint32_t dequeue;                                                                                                     \
+        char __pad2[__fast_cacheline];                                                                                                \
+    } __fastmpmc_type(t_name);                                                                                                        \
+                                                                                                                                      \
+    inline static __fastmpmc_type(t_name) * fastmpmc_##t_name##_init(uint32_t cap)                                                    \
+    {                                                                                                                                 \
+        __fastmpmc_type(t_name) *self = adt_malloc(sizeof(__fastmpmc_type(t_name)));                                                  \
+        cap = __fast_next_pow2(cap);                                                                                                  \
+        self->mask = cap - 1;                                                                                                         \
+        self->cells = adt_malloc(cap * sizeof(__fastmpmc_cell_type(t_name)));                                                         \
+        for (uint32_t i = 0; i < cap; i++)                                                                                            \
+            atomic_init(&self->cells[i].sequence, i);                                                                                 \
+        atomic_init(&self->enqueue, 0);                                                                                               \
+        atomic_init(&self->dequeue, 0);                                                                                               \
+        return self;                                                                                                                  \
+    }                                                                                                                                 \
+    inline static void fastmpmc_##t_name##_destroy(__fastmpmc_type(t_name) * self)                                                    \
+    {                                                                                                                                 \
+        xxfree(self->cells, (self->mask + 1) * sizeof(__fastmpmc_cell_type(t_name)));                                                 \
+        xxfree(self, sizeof(__fastmpmc_type(t_name)));                                                                                \
+    }                                                                                                                                 \
+    /* returns how many of the n values were pushed, always a prefix of values */                                                     \
+    inline static uint32_t fastmpmc_##t_name##_push_n(__fastmpmc_type(t_name) * self, const t_key *values, uint32_t n)                \
+    {                                                                                                                                 \
+        if (n == 0)                                                                                                                   \
+            return 0;                                                                                                                 \
+        uint32_t pos = atomic_load_explicit(&self->enqueue, memory_order_relaxed);                                                    \
+        uint32_t count;                                                                                                               \
+        while (1)                                                                                                                     \
+        {                                                                                                                             \
+            count = 0;                                                                                                                \
+            while (count < n)                                                                                                         \
+            {                                                                                                                         \
+                __fastmpmc_cell_type(t_name) *cell = &self->cells[(pos + count) & self->mask];                                        \
+                uint32_t seq = atomic_load_explicit(&cell->sequence, memory_order_acquire);                                           \
+                if (seq != pos + count)                                                                                               \
+                    break;                                                                                                            \
+                count++;                                                                                                              \
+            }                                                                                                                         \
+            if (count == 0)                                                                                                           \
+            {                                                                                                                         \
+                uint32_t seq = atomic_load_explicit(&self->cells[pos & self->mask].sequence, memory_order_acquire);                   \
+                if ((int32_t)(seq - pos) < 0)                                                                                         \
+                    return 0;                                                                                                         \
+                pos = atomic_load_explicit(&self->enqueue, memory_order_relaxed);                                                     \
+                continue;                                                                                                             \
+            }                                                                                                                         \
+            if (atomic_compare_exchange_weak_explicit(&self->enqueue, &pos, pos + count, memory_order_relaxed, memory_order_relaxed)) \
+                break;                                                                                                                \
+        }                                                                                                                             \
+        for (uint32_t i = 0; i < count; i++)                                                                                          \
+        {                                                                                                                             \
+            __fastmpmc_cell_type(t_name) *cell = &self->cells[(pos + i) & self->mask];                                                \
+            cell->value = values[i];                                                                                                  \
+            atomic_store_explicit(&cell->sequence, pos + i + 1, memory_order_release);                                                \
+        }                                                                                                                             \
+        return count;                                                                                                                 \
+    }                                                                                                                                 \
+    inline static bool fastmpmc_##t_name##_push(__fastmpmc_type(t_name) * self, t_key value)                                          \
+    {                                                                                                                                 \
+        return fastmpmc_##t_name##_push_n(self, &value, 1) == 1;                                                                      \
+    }                                                                                                                                 \
+    /* returns how many values were written to out */                                                                                 \
+    inline static uint32_t fastmpmc_##t_name##_pop_n(__fastmpmc_type(t_name) * self, t_key *out, uint32_t n)                          \
+    {                                                                                                                                 \
+        if (n == 0)                                                                                                                   \
+            return 0;                                                                                                                 \
+        uint32_t pos = atomic_load_explicit(&self->dequeue, memory_order_relaxed);                                                    \
+        uint32_t count;                                                                                                               \
+        while (1)                                                                                                                     \
+        {                                                                                                                             \
+            count = 0;                                                                                                                \
+            while (count < n)                                                                                                         \
+            {                                                                                                                         \
+                __fastmpmc_cell_type(t_name) *cell = &self->cells[(pos + count) & self->mask];                                        \
+                uint32_t seq = atomic_load_explicit(&cell->sequence, memory_order_acquire);                                           \
+                if (seq != pos + count + 1)                                                                                           \
+                    break;                                                                                                            \
+                count++;                                                                                                              \
+            }                                                                                                                         \
+            if (count == 0)                                                                                                           \
+            {                                                                                                                         \
+                uint32_t seq = atomic_load_explicit(&self->cells[pos & self->mask].sequence, memory_order_acquire);                   \
+                if ((int32_t)(seq - (pos + 1)) < 0)                                                                                   \
+                    return 0;                                                                                                         \
+                pos = atomic_load_explicit(&self->dequeue, memory_order_relaxed);                                                     \
+                continue;                                                                                                             \
+            }                                                                                                                         \
+            if (atomic_compare_exchange_weak_explicit(&self->dequeue, &pos, pos + count, memory_order_relaxed, memory_order_relaxed)) \
+                break;                                                                                                                \
+        }                                                                                                                             \
+        for (uint32_t i = 0; i < count; i++)                                                                                          \
+        {                                                                                                                             \
+            __fastmpmc_cell_type(t_name) *cell = &self->cells[(pos + i) & self->mask];                                                \
+            out[i] = cell->value;                                                                                                     \
+            atomic_store_explicit(&cell->sequence, pos + i + self->mask + 1, memory_order_release);                                   \
+        }                                                                                                                             \
+        return count;                                                                                                                 \
+    }                                                                                                                                 \
+    inline static bool fastmpmc_##t_name##_pop(__fastmpmc_type(t_name) * self, t_key *out)                                            \
+    {                                                                                                                                 \
+        return fastmpmc_##t_name##_pop_n(self, out, 1) == 1;                                                                          \
+    }                                                                                                                                 \
+    /* a snapshot, other threads may change it right after */                                                                         \
+    inline static uint32_t fastmpmc_##t_name##_length(__fastmpmc_type(t_name) * self)                                                 \
+    {                                                                                                                                 \
+        uint32_t head = atomic_load_explicit(&self->dequeue, memory_order_acquire);                                                   \
+        int32_t d = (int32_t)(atomic_load_explicit(&self->enqueue, memory_order_acquire) - head);                                     \
+        return d > 0 ? (uint32_t)d : 0;                                                                                               \
+    }                                                                                                                                 \
+    inline static bool fastmpmc_##t_name##_empty(__fastmpmc_type(t_name) * self)                                                      \
+    {                                                                                                                                 \
+        return fastmpmc_##t_name##_length(self) == 0;                                                                                 \
+    }
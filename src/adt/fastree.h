@@ -1,301 +1,420 @@
+#ifndef cgame_FASTREE_H
+#define cgame_FASTREE_H
+
 #include "fast.h"
 
+// keys per node, a node never drops below half of this except the root
+#ifndef FASTREE_ORDER
+#define FASTREE_ORDER 32
+#endif
+#define __fastree_min ((FASTREE_ORDER >> 1) - 1)
+// nodes are carved out of chunks owned by the tree and recycled through a free list
+#define __fastree_chunk 16
+
 #define __fastree_type(t_name) Fastree_##t_name
 #define __fastree_node(t_name) FastreeNode_##t_name
+#define __fastree_chunk_type(t_name) __fastreechunk_##t_name##_t
+#define __fastree_itter_type(t_name) FastreeItter_##t_name
 
-#define make_fastree_directives(t_name, t_key, t_compare)                                                                                      \
-    typedef struct __fastree_node(t_name)                                                                                                      \
-    {                                                                                                                                          \
-        t_key value;                                                                                                                           \
-        struct __fastree_node(t_name) * left;                                                                                                  \
-        struct __fastree_node(t_name) * right;                                                                                                 \
-        int height;                                                                                                                            \
-    }                                                                                                                                          \
-    __fastree_node(t_name);                                                                                                                    \
-                                                                                                                                               \
-    typedef struct                                                                                                                             \
-    {                                                                                                                                          \
-        int length;                                                                                                                            \
-        __fastree_node(t_name) * head;                                                                                                         \
-    } __fastree_type(t_name);                                                                                                                  \
-                                                                                                                                               \
-    inline static int __fastree_##t_name##_balance_factor(__fastree_node(t_name) * node)                                                       \
-    {                                                                                                                                          \
-        if (node == NULL)                                                                                                                      \
-            return 0;                                                                                                                          \
-        int a = node->left ? node->left->height : 0;                                                                                           \
-        int b = node->right ? node->right->height : 0;                                                                                         \
-        return a - b;                                                                                                                          \
-    }                                                                                                                                          \
-                                                                                                                                               \
-    inline static int __fastree_##t_name##_height(__fastree_node(t_name) * node)                                                               \
-    {                                                                                                                                          \
-        if (node == NULL)                                                                                                                      \
-            return 0;                                                                                                                          \
-        int a = node->left ? node->left->height : 0;                                                                                           \
-        int b = node->right ? node->right->height : 0;                                                                                         \
-        return 1 + (a > b ? a : b);                                                                                                            \
-    }                                                                                                                                          \
-                                                                                                                                               \
-    inline static __fastree_node(t_name) * __fastree_##t_name##_rr(__fastree_node(t_name) * A)                                                 \
-    {                                                                                                                                          \
-        __fastree_node(t_name) *B = A->left;                                                                                                   \
-                                                                                                                                               \
-        __fastree_node(t_name) *Br = B->right;                                                                                                 \
-        B->right = A;                                                                                                                          \
-        A->left = Br;                                                                                                                          \
-                                                                                                                                               \
-        A->height = __fastree_##t_name##_height(A);                                                                                            \
-        B->height = __fastree_##t_name##_height(B);                                                                                            \
-                                                                                                                                               \
-        return B;                                                                                                                              \
-    }                                                                                                                                          \
-                                                                                                                                               \
-    inline static __fastree_node(t_name) * __fastree_##t_name##_rl(__fastree_node(t_name) * A)                                                 \
-    {                                                                                                                                          \
-        __fastree_node(t_name) *B = A->right;                                                                                                  \
-                                                                                                                                               \
-        __fastree_node(t_name) *Bl = B->left;                                                                                                  \
-        B->left = A;                                                                                                                           \
-        A->right = Bl;                                                                                                                         \
-                                                                                                                                               \
-        A->height = __fastree_##t_name##_height(A);                                                                                            \
-        B->height = __fastree_##t_name##_height(B);                                                                                            \
-                                                                                                                                               \
-        return B;                                                                                                                              \
-    }                                                                                                                                          \
-                                                                                                                                               \
-    inline static __fastree_node(t_name) * __fastree_##t_name##_rlr(__fastree_node(t_name) * A)                                                \
-    {                                                                                                                                          \
-        __fastree_node(t_name) *B = A->left;                                                                                                   \
-        __fastree_node(t_name) *C = B->right;                                                                                                  \
-                                                                                                                                               \
-        A->left = C->right;                                                                                                                    \
-        B->right = C->left;                                                                                                                    \
-        C->left = B;                                                                                                                           \
-        C->right = A;                                                                                                                          \
-                                                                                                                                               \
-        B->height = __fastree_##t_name##_height(B);                                                                                            \
-        A->height = __fastree_##t_name##_height(A);                                                                                            \
-        C->height = __fastree_##t_name##_height(C);                                                                                            \
-                                                                                                                                               \
-        return C;                                                                                                                              \
-    }                                                                                                                                          \
-                                                                                                                                               \
-    inline static __fastree_node(t_name) * __fastree_##t_name##_rrl(__fastree_node(t_name) * A)                                                \
-    {                                                                                                                                          \
-        __fastree_node(t_name) *B = A->right;                                                                                                  \
-        __fastree_node(t_name) *C = B->left;                                                                                                   \
-                                                                                                                                               \
-        A->right = C->left;                                                                                                                    \
-        B->left = C->right;                                                                                                                    \
-        C->left = A;                                                                                                                           \
-        C->right = B;                                                                                                                          \
-                                                                                                                                               \
-        B->height = __fastree_##t_name##_height(B);                                                                                            \
-        A->height = __fastree_##t_name##_height(A);                                                                                            \
-        C->height = __fastree_##t_name##_height(C);                                                                                            \
-                                                                                                                                               \
-        return C;                                                                                                                              \
-    }                                                                                                                                          \
-                                                                                                                                               \
-    inline static __fastree_node(t_name) * __fastree_##t_name##_balance(__fastree_node(t_name) * A)                                            \
-    {                                                                                                                                          \
-        int balance = __fastree_##t_name##_balance_factor(A);                                                                                  \
-        if (balance == 2 && __fastree_##t_name##_balance_factor(A->left) == 1)                                                                 \
-        {                                                                                                                                      \
-            return __fastree_##t_name##_rr(A);                                                                                                 \
-        }                                                                                                                                      \
-        else if (balance == 2 && __fastree_##t_name##_balance_factor(A->left) == -1)                                                           \
-        {                                                                                                                                      \
-            return __fastree_##t_name##_rlr(A);                                                                                                \
-        }                                                                                                                                      \
-        else if (balance == -2 && __fastree_##t_name##_balance_factor(A->right) == 1)                                                          \
-        {                                                                                                                                      \
-            return __fastree_##t_name##_rrl(A);                                                                                                \
-        }                                                                                                                                      \
-        else if (balance == -2 && __fastree_##t_name##_balance_factor(A->right) == -1)                                                         \
-        {                                                                                                                                      \
-            return __fastree_##t_name##_rl(A);                                                                                                 \
-        }                                                                                                                                      \
-        return A;                                                                                                                              \
-    }                                                                                                                                          \
-                                                                                                                                               \
-    inline static __fastree_node(t_name) * __fastree_##t_name##_add(__fastree_type(t_name) * self, __fastree_node(t_name) * A, t_key newValue) \
-    {                                                                                                                                          \
-        if (A == NULL)                                                                                                                         \
-        {                                                                                                                                      \
-            self->length++;                                                                                                                    \
-            __fastree_node(t_name) *new = xxmalloc(sizeof(__fastree_node(t_name)));                                                            \
-            new->left = NULL;                                                                                                                  \
-            new->right = NULL;                                                                                                                 \
-            new->height = 0;                                                                                                                   \
-            new->value = newValue;                                                                                                             \
-            return new;                                                                                                                        \
-        }                                                                                                                                      \
-        int cmp = t_compare(newValue, A->value);                                                                                               \
-        if (cmp > 0)                                                                                                                           \
-        {                                                                                                                                      \
-            A->right = __fastree_##t_name##_add(self, A->right, newValue);                                                                     \
-        }                                                                                                                                      \
-        else if (cmp < 0)                                                                                                                      \
-        {                                                                                                                                      \
-            A->left = __fastree_##t_name##_add(self, A->left, newValue);                                                                       \
-        }                                                                                                                                      \
-        A->height = __fastree_##t_name##_height(A);                                                                                            \
-        return __fastree_##t_name##_balance(A);                                                                                                \
-    }                                                                                                                                          \
-    inline static void fastree_##t_name##_add(__fastree_type(t_name) * self, t_key value)                                                      \
-    {                                                                                                                                          \
-        self->head = __fastree_##t_name##_add(self, self->head, value);                                                                        \
-    }                                                                                                                                          \
-                                                                                                                                               \
-    inline __fastree_node(t_name) * __fastree_##t_name##_remove(__fastree_type(t_name) * self, __fastree_node(t_name) * A, t_key *value) \
-    {                                                                                                                                          \
-        if (A == NULL)                                                                                                                         \
-            return A;                                                                                                                          \
-        int cmp = t_compare(value, A->value);                                                                                                  \
-        if (cmp > 0)                                                                                                                           \
-        {                                                                                                                                      \
-            A->right = __fastree_##t_name##_remove(self, A->right, value);                                                                     \
-            A->height = __fastree_##t_name##_height(A);                                                                                        \
-        }                                                                                                                                      \
-        else if (cmp < 0)                                                                                                                      \
-        {                                                                                                                                      \
-            A->left = __fastree_##t_name##_remove(self, A->left, value);                                                                       \
-            A->height = __fastree_##t_name##_height(A);                                                                                        \
-        }                                                                                                                                      \
-        else if (A->left == NULL)                                                                                                              \
-        {                                                                                                                                      \
-            __fastree_node(t_name) *right = A->right;                                                                                          \
-            if (right != NULL)                                                                                                                 \
-                right->height = __fastree_##t_name##_height(right);                                                                            \
-            xxfree(A, sizeof(__fastree_node(t_name)));                                                                                         \
-            self->length--;                                                                                                                    \
-            A = right;                                                                                                                         \
-        }                                                                                                                                      \
-        else if (A->right == NULL)                                                                                                             \
-        {                                                                                                                                      \
-            __fastree_node(t_name) *left = A->left;                                                                                            \
-            if (left != NULL)                                                                                                                  \
-                left->height = __fastree_##t_name##_height(left);                                                                              \
-            xxfree(A, sizeof(__fastree_node(t_name)));                                                                                         \
-            self->length--;                                                                                                                    \
-            A = left;                                                                                                                          \
-        }                                                                                                                                      \
-        else                                                                                                                                   \
-        {                                                                                                                                      \
-            __fastree_node(t_name) *successor = A->right, *parent = A;                                                                         \
-            while (successor->left != NULL)                                                                                                    \
-            {                                                                                                                                  \
-                parent = successor;                                                                                                            \
-                successor = successor->left;                                                                                                   \
-            }                                                                                                                                  \
-            if (parent == A)                                                                                                                   \
-            {                                                                                                                                  \
-                parent->right = successor->right;                                                                                              \
-            }                                                                                                                                  \
-            else                                                                                                                               \
-            {                                                                                                                                  \
-                parent->left = successor->right;                                                                                               \
-            }                                                                                                                                  \
-            parent->height = __fastree_##t_name##_height(parent);                                                                              \
-            A->height = __fastree_##t_name##_height(A);                                                                                        \
-            A->value = successor->value;                                                                                                       \
-            xxfree(successor, sizeof(__fastree_node(t_name)));                                                                                 \
-            self->length--;                                                                                                                    \
-        }                                                                                                                                      \
-        return __fastree_##t_name##_balance(A);                                                                                                \
-    }                                                                                                                                          \
-                                                                                                                                               \
-    inline static void fastree_##t_name##_remove(__fastree_type(t_name) * self, t_key value)                                                   \
-    {                                                                                                                                          \
-        self->head = __fastree_##t_name##_remove(self, self->head, &value);                                                                     \
-    }                                                                                                                                          \
-                                                                                                                                               \
-    inline static bool fastree_##t_name##_has(__fastree_type(t_name) * self, t_key value)                                                      \
-    {                                                                                                                                          \
-    }                                                                                                                                          \
-                                                                                                                                               \
-    inline static __fastree_type(t_name) * fastree_##t_name##_init()                                                                           \
-    {                                                                                                                                          \
-        __fastree_type(t_name) *self = (__fastree_type(t_name) *)xxmalloc(sizeof(__fastree_type(t_name)));                                     \
-        self->length = 0;                                                                                                                      \
-        self->head = NULL;                                                                                                                     \
-        return self;                                                                                                                           \
-    }                                                                                                                                          \
-                                                                                                                                               \
-    inline static void __fastree_##t_name##_destroy(__fastree_node(t_name) * node)                                                             \
-    {                                                                                                                                          \
-        if (node == NULL)                                                                                                                      \
-            return;                                                                                                                            \
-        __fastree_node(t_name) *left = node->left;                                                                                             \
-        __fastree_node(t_name) *right = node->right;                                                                                           \
-        xxfree(node, sizeof(__fastree_node(t_name)));                                                                                          \
-        __fastree_##t_name##_destroy(left);                                                                                                    \
-        __fastree_##t_name##_destroy(right);                                                                                                   \
-    }                                                                                                                                          \
-                                                                                                                                               \
-    inline static void fastree_##t_name##_clear(__fastree_type(t_name) * self)                                                                 \
-    {                                                                                                                                          \
-        __fastree_##t_name##_destroy(self->head);                                                                                              \
-        self->length = 0;                                                                                                                      \
-    }                                                                                                                                          \
-                                                                                                                                               \
-    inline static void fastree_##t_name##_destroy(__fastree_type(t_name) * self)                                                               \
-    {                                                                                                                                          \
-        __fastree_##t_name##_destroy(self->head);                                                                                              \
-        xxfree(self, sizeof(__fastree_type(t_name)));                                                                                          \
+// b+ tree, keys live in the leaves and the leaves are chained for in order walks
+#define make_fastree_directives(t_name, t_key, t_compare)                                                                    \
+    typedef struct __fastree_node(t_name)                                                                                    \
+    {                                                                                                                        \
+        t_key keys[FASTREE_ORDER];                                                                                           \
+        int length;                                                                                                          \
+        bool leaf;                                                                                                           \
+        struct __fastree_node(t_name) * next;                                                                                \
+        struct __fastree_node(t_name) * children[FASTREE_ORDER + 1];                                                         \
+    }                                                                                                                        \
+    __fastree_node(t_name);                                                                                                  \
+                                                                                                                             \
+    typedef struct __fastree_chunk_type(t_name)                                                                              \
+    {                                                                                                                        \
+        struct __fastree_chunk_type(t_name) * next;                                                                          \
+        __fastree_node(t_name) nodes[__fastree_chunk];                                                                       \
+    }                                                                                                                        \
+    __fastree_chunk_type(t_name);                                                                                            \
+                                                                                                                             \
+    typedef struct                                                                                                           \
+    {                                                                                                                        \
+        int length;                                                                                                          \
+        __fastree_node(t_name) * head;                                                                                       \
+        __fastree_node(t_name) * free;                                                                                       \
+        __fastree_chunk_type(t_name) * chunks;                                                                               \
+    } __fastree_type(t_name);                                                                                                \
+                                                                                                                             \
+    typedef struct                                                                                                           \
+    {                                                                                                                        \
+        __fastree_node(t_name) * node;                                                                                       \
+        int index;                                                                                                           \
+        bool bounded;                                                                                                        \
+        t_key last;                                                                                                          \
+        t_key *value;                                                                                                        \
+    } __fastree_itter_type(t_name);                                                                                          \
+                                                                                                                             \
+    inline static __fastree_node(t_name) * __fastree_##t_name##_node(__fastree_type(t_name) * self, bool leaf)               \
+    {                                                                                                                        \
+        if (self->free == NULL)                                                                                              \
+        {                                                                                                                    \
+            __fastree_chunk_type(t_name) *chunk = adt_malloc(sizeof(__fastree_chunk_type(t_name)));                          \
+            chunk->next = self->chunks;                                                                                      \
+            self->chunks = chunk;                                                                                            \
+            for (int i = 0; i < __fastree_chunk; i++)                                                                        \
+            {                                                                                                                \
+                chunk->nodes[i].next = self->free;                                                                           \
+                self->free = &chunk->nodes[i];                                                                               \
+            }                                                                                                                \
+        }                                                                                                                    \
+        __fastree_node(t_name) *node = self->free;                                                                           \
+        self->free = node->next;                                                                                             \
+        node->length = 0;                                                                                                    \
+        node->leaf = leaf;                                                                                                   \
+        node->next = NULL;                                                                                                   \
+        return node;                                                                                                         \
+    }                                                                                                                        \
+                                                                                                                             \
+    inline static void __fastree_##t_name##_release(__fastree_type(t_name) * self, __fastree_node(t_name) * node)            \
+    {                                                                                                                        \
+        node->next = self->free;                                                                                             \
+        self->free = node;                                                                                                   \
+    }                                                                                                                        \
+                                                                                                                             \
+    /* first slot whose key is >= key, or > key when upper is set */                                                         \
+    inline static int __fastree_##t_name##_bound(__fastree_node(t_name) * node, t_key key, bool upper)                       \
+    {                                                                                                                        \
+        int lo = 0, hi = node->length;                                                                                       \
+        while (lo < hi)                                                                                                      \
+        {                                                                                                                    \
+            int mid = (lo + hi) >> 1;                                                                                        \
+            int cmp = t_compare(node->keys[mid], key);                                                                       \
+            if (cmp < 0 || (upper && cmp == 0))                                                                              \
+                lo = mid + 1;                                                                                                \
+            else                                                                                                             \
+                hi = mid;                                                                                                    \
+        }                                                                                                                    \
+        return lo;                                                                                                           \
+    }                                                                                                                        \
+                                                                                                                             \
+    inline static void __fastree_##t_name##_split(__fastree_type(t_name) * self, __fastree_node(t_name) * parent, int i)     \
+    {                                                                                                                        \
+        __fastree_node(t_name) *left = parent->children[i];                                                                  \
+        __fastree_node(t_name) *right = __fastree_##t_name##_node(self, left->leaf);                                         \
+        int half = FASTREE_ORDER >> 1;                                                                                       \
+        t_key separator;                                                                                                     \
+        if (left->leaf)                                                                                                      \
+        {                                                                                                                    \
+            right->length = left->length - half;                                                                             \
+            memcpy(right->keys, left->keys + half, right->length * sizeof(t_key));                                           \
+            right->next = left->next;                                                                                        \
+            left->next = right;                                                                                              \
+            separator = right->keys[0];                                                                                      \
+        }                                                                                                                    \
+        else                                                                                                                 \
+        {                                                                                                                    \
+            separator = left->keys[half];                                                                                    \
+            right->length = left->length - half - 1;                                                                         \
+            memcpy(right->keys, left->keys + half + 1, right->length * sizeof(t_key));                                       \
+            memcpy(right->children, left->children + half + 1, (right->length + 1) * sizeof(right));                         \
+        }                                                                                                                    \
+        left->length = half;                                                                                                 \
+        memmove(parent->keys + i + 1, parent->keys + i, (parent->length - i) * sizeof(t_key));                               \
+        memmove(parent->children + i + 2, parent->children + i + 1, (parent->length - i) * sizeof(right));                   \
+        parent->keys[i] = separator;                                                                                         \
+        parent->children[i + 1] = right;                                                                                     \
+        parent->length++;                                                                                                    \
+    }                                                                                                                        \
+                                                                                                                             \
+    /* inserts value unless an equal key exists, returns the stored key either way */                                        \
+    inline static t_key *fastree_##t_name##_add(__fastree_type(t_name) * self, t_key value)                                  \
+    {                                                                                                                        \
+        if (self->head == NULL)                                                                                              \
+            self->head = __fastree_##t_name##_node(self, true);                                                              \
+        if (self->head->length == FASTREE_ORDER)                                                                             \
+        {                                                                                                                    \
+            __fastree_node(t_name) *root = __fastree_##t_name##_node(self, false);                                           \
+            root->children[0] = self->head;                                                                                  \
+            self->head = root;                                                                                               \
+            __fastree_##t_name##_split(self, root, 0);                                                                       \
+        }                                                                                                                    \
+        __fastree_node(t_name) *node = self->head;                                                                           \
+        while (!node->leaf)                                                                                                  \
+        {                                                                                                                    \
+            int i = __fastree_##t_name##_bound(node, value, true);                                                           \
+            if (node->children[i]->length == FASTREE_ORDER)                                                                  \
+            {                                                                                                                \
+                __fastree_##t_name##_split(self, node, i);                                                                   \
+                if (t_compare(value, node->keys[i]) >= 0)                                                                    \
+                    i++;                                                                                                     \
+            }                                                                                                                \
+            node = node->children[i];                                                                                        \
+        }                                                                                                                    \
+        int i = __fastree_##t_name##_bound(node, value, false);                                                              \
+        if (i < node->length && t_compare(node->keys[i], value) == 0)                                                        \
+            return &node->keys[i];                                                                                           \
+        memmove(node->keys + i + 1, node->keys + i, (node->length - i) * sizeof(t_key));                                     \
+        node->keys[i] = value;                                                                                               \
+        node->length++;                                                                                                      \
+        self->length++;                                                                                                      \
+        return &node->keys[i];                                                                                               \
+    }                                                                                                                        \
+                                                                                                                             \
+    /* tops up children[i] so a key can be taken out of it, returns where that range now lives */                            \
+    inline static int __fastree_##t_name##_fill(__fastree_type(t_name) * self, __fastree_node(t_name) * parent, int i)       \
+    {                                                                                                                        \
+        __fastree_node(t_name) *child = parent->children[i];                                                                 \
+        __fastree_node(t_name) *left = i > 0 ? parent->children[i - 1] : NULL;                                               \
+        __fastree_node(t_name) *right = i < parent->length ? parent->children[i + 1] : NULL;                                 \
+        if (left && left->length > __fastree_min)                                                                            \
+        {                                                                                                                    \
+            memmove(child->keys + 1, child->keys, child->length * sizeof(t_key));                                            \
+            if (child->leaf)                                                                                                 \
+            {                                                                                                                \
+                child->keys[0] = left->keys[left->length - 1];                                                               \
+                parent->keys[i - 1] = child->keys[0];                                                                        \
+            }                                                                                                                \
+            else                                                                                                             \
+            {                                                                                                                \
+                memmove(child->children + 1, child->children, (child->length + 1) * sizeof(child));                          \
+                child->keys[0] = parent->keys[i - 1];                                                                        \
+                child->children[0] = left->children[left->length];                                                           \
+                parent->keys[i - 1] = left->keys[left->length - 1];                                                          \
+            }                                                                                                                \
+            left->length--;                                                                                                  \
+            child->length++;                                                                                                 \
+            return i;                                                                                                        \
+        }                                                                                                                    \
+        if (right && right->length > __fastree_min)                                                                          \
+        {                                                                                                                    \
+            if (child->leaf)                                                                                                 \
+            {                                                                                                                \
+                child->keys[child->length] = right->keys[0];                                                                 \
+                parent->keys[i] = right->keys[1];                                                                            \
+            }                                                                                                                \
+            else                                                                                                             \
+            {                                                                                                                \
+                child->keys[child->length] = parent->keys[i];                                                                \
+                child->children[child->length + 1] = right->children[0];                                                     \
+                parent->keys[i] = right->keys[0];                                                                            \
+                memmove(right->children, right->children + 1, right->length * sizeof(right));                                \
+            }                                                                                                                \
+            memmove(right->keys, right->keys + 1, (right->length - 1) * sizeof(t_key));                                      \
+            right->length--;                                                                                                 \
+            child->length++;                                                                                                 \
+            return i;                                                                                                        \
+        }                                                                                                                    \
+        if (right == NULL)                                                                                                   \
+        {                                                                                                                    \
+            right = child;                                                                                                   \
+            child = left;                                                                                                    \
+            i--;                                                                                                             \
+        }                                                                                                                    \
+        if (child->leaf)                                                                                                     \
+        {                                                                                                                    \
+            child->next = right->next;                                                                                       \
+        }                                                                                                                    \
+        else                                                                                                                 \
+        {                                                                                                                    \
+            child->keys[child->length++] = parent->keys[i];                                                                  \
+            memcpy(child->children + child->length, right->children, (right->length + 1) * sizeof(right));                   \
+        }                                                                                                                    \
+        memcpy(child->keys + child->length, right->keys, right->length * sizeof(t_key));                                     \
+        child->length += right->length;                                                                                      \
+        memmove(parent->keys + i, parent->keys + i + 1, (parent->length - i - 1) * sizeof(t_key));                           \
+        memmove(parent->children + i + 1, parent->children + i + 2, (parent->length - i - 1) * sizeof(right));               \
+        parent->length--;                                                                                                    \
+        __fastree_##t_name##_release(self, right);                                                                           \
+        return i;                                                                                                            \
+    }                                                                                                                        \
+                                                                                                                             \
+    inline static bool fastree_##t_name##_remove(__fastree_type(t_name) * self, t_key value)                                 \
+    {                                                                                                                        \
+        __fastree_node(t_name) *node = self->head;                                                                           \
+        if (node == NULL)                                                                                                    \
+            return false;                                                                                                    \
+        while (!node->leaf)                                                                                                  \
+        {                                                                                                                    \
+            int i = __fastree_##t_name##_bound(node, value, true);                                                           \
+            if (node->children[i]->length <= __fastree_min)                                                                  \
+                i = __fastree_##t_name##_fill(self, node, i);                                                                \
+            node = node->children[i];                                                                                        \
+        }                                                                                                                    \
+        bool found = false;                                                                                                  \
+        int i = __fastree_##t_name##_bound(node, value, false);                                                              \
+        if (i < node->length && t_compare(node->keys[i], value) == 0)                                                        \
+        {                                                                                                                    \
+            memmove(node->keys + i, node->keys + i + 1, (node->length - i - 1) * sizeof(t_key));                             \
+            node->length--;                                                                                                  \
+            self->length--;                                                                                                  \
+            found = true;                                                                                                    \
+        }                                                                                                                    \
+        node = self->head;                                                                                                   \
+        if (node->length == 0)                                                                                               \
+        {                                                                                                                    \
+            self->head = node->leaf ? NULL : node->children[0];                                                              \
+            __fastree_##t_name##_release(self, node);                                                                        \
+        }                                                                                                                    \
+        return found;                                                                                                        \
+    }                                                                                                                        \
+                                                                                                                             \
+    inline static t_key *fastree_##t_name##_find(__fastree_type(t_name) * self, t_key value)                                 \
+    {                                                                                                                        \
+        __fastree_node(t_name) *node = self->head;                                                                           \
+        if (node == NULL)                                                                                                    \
+            return NULL;                                                                                                     \
+        while (!node->leaf)                                                                                                  \
+            node = node->children[__fastree_##t_name##_bound(node, value, true)];                                            \
+        int i = __fastree_##t_name##_bound(node, value, false);                                                              \
+        if (i < node->length && t_compare(node->keys[i], value) == 0)                                                        \
+            return &node->keys[i];                                                                                           \
+        return NULL;                                                                                                         \
+    }                                                                                                                        \
+                                                                                                                             \
+    inline static bool fastree_##t_name##_has(__fastree_type(t_name) * self, t_key value)                                    \
+    {                                                                                                                        \
+        return fastree_##t_name##_find(self, value) != NULL;                                                                 \
+    }                                                                                                                        \
+                                                                                                                             \
+    inline static void fastree_##t_name##_next(__fastree_itter_type(t_name) * it)                                            \
+    {                                                                                                                        \
+        it->index++;                                                                                                         \
+        while (it->node && it->index >= it->node->length)                                                                    \
+        {                                                                                                                    \
+            it->node = it->node->next;                                                                                       \
+            it->index = 0;                                                                                                   \
+        }                                                                                                                    \
+        it->value = it->node ? &it->node->keys[it->index] : NULL;                                                            \
+        if (it->value && it->bounded && t_compare(*it->value, it->last) > 0)                                                 \
+        {                                                                                                                    \
+            it->node = NULL;                                                                                                 \
+            it->value = NULL;                                                                                                \
+        }                                                                                                                    \
+    }                                                                                                                        \
+                                                                                                                             \
+    inline static bool fastree_##t_name##_eof(__fastree_itter_type(t_name) * it)                                             \
+    {                                                                                                                        \
+        return it->node == NULL;                                                                                             \
+    }                                                                                                                        \
+                                                                                                                             \
+    /* walks keys >= from in order */                                                                                        \
+    inline static __fastree_itter_type(t_name) fastree_##t_name##_lower_bound(__fastree_type(t_name) * self, t_key from)     \
+    {                                                                                                                        \
+        __fastree_itter_type(t_name) it = {0};                                                                               \
+        it.node = self->head;                                                                                                \
+        if (it.node == NULL)                                                                                                 \
+            return it;                                                                                                       \
+        while (!it.node->leaf)                                                                                               \
+            it.node = it.node->children[__fastree_##t_name##_bound(it.node, from, true)];                                    \
+        it.index = __fastree_##t_name##_bound(it.node, from, false) - 1;                                                     \
+        fastree_##t_name##_next(&it);                                                                                        \
+        return it;                                                                                                           \
+    }                                                                                                                        \
+                                                                                                                             \
+    inline static __fastree_itter_type(t_name) fastree_##t_name##_begin(__fastree_type(t_name) * self)                       \
+    {                                                                                                                        \
+        __fastree_itter_type(t_name) it = {0};                                                                               \
+        it.node = self->head;                                                                                                \
+        if (it.node == NULL)                                                                                                 \
+            return it;                                                                                                       \
+        while (!it.node->leaf)                                                                                               \
+            it.node = it.node->children[0];                                                                                  \
+        it.index = -1;                                                                                                       \
+        fastree_##t_name##_next(&it);                                                                                        \
+        return it;                                                                                                           \
+    }                                                                                                                        \
+                                                                                                                             \
+    /* walks keys in [from, to] in order */                                                                                  \
+    inline static __fastree_itter_type(t_name) fastree_##t_name##_range(__fastree_type(t_name) * self, t_key from, t_key to) \
+    {                                                                                                                        \
+        __fastree_itter_type(t_name) it = fastree_##t_name##_lower_bound(self, from);                                        \
+        it.bounded = true;                                                                                                   \
+        it.last = to;                                                                                                        \
+        if (it.value && t_compare(*it.value, to) > 0)                                                                        \
+        {                                                                                                                    \
+            it.node = NULL;                                                                                                  \
+            it.value = NULL;                                                                                                 \
+        }                                                                                                                    \
+        return it;                                                                                                           \
+    }                                                                                                                        \
+                                                                                                                             \
+    inline static __fastree_type(t_name) * fastree_##t_name##_init()                                                         \
+    {                                                                                                                        \
+        __fastree_type(t_name) *self = (__fastree_type(t_name) *)adt_malloc(sizeof(__fastree_type(t_name)));                 \
+        self->length = 0;                                                                                                    \
+        self->head = NULL;                                                                                                   \
+        self->free = NULL;                                                                                                   \
+        self->chunks = NULL;                                                                                                 \
+        return self;                                                                                                         \
+    }                                                                                                                        \
+                                                                                                                             \
+    inline static void fastree_##t_name##_clear(__fastree_type(t_name) * self)                                               \
+    {                                                                                                                        \
+        __fastree_chunk_type(t_name) *chunk = self->chunks;                                                                  \
+        while (chunk)                                                                                                        \
+        {                                                                                                                    \
+            __fastree_chunk_type(t_name) *next = chunk->next;                                                                \
+            xxfree(chunk, sizeof(__fastree_chunk_type(t_name)));                                                             \
+            chunk = next;                                                                                                    \
+        }                                                                                                                    \
+        self->chunks = NULL;                                                                                                 \
+        self->free = NULL;                                                                                                   \
+        self->head = NULL;                                                                                                   \
+        self->length = 0;                                                                                                    \
+    }                                                                                                                        \
+                                                                                                                             \
+    /* replaces the contents with n keys that must be sorted ascending and unique */                                         \
+    inline static void fastree_##t_name##_load(__fastree_type(t_name) * self, const t_key *keys, int n)                      \
+    {                                                                                                                        \
+        fastree_##t_name##_clear(self);                                                                                      \
+        if (n <= 0)                                                                                                          \
+            return;                                                                                                          \
+        int count = (n + FASTREE_ORDER - 1) / FASTREE_ORDER;                                                                 \
+        __fastree_node(t_name) **level = adt_malloc(count * sizeof(__fastree_node(t_name) *));                               \
+        t_key *lows = adt_malloc(count * sizeof(t_key));                                                                     \
+        __fastree_node(t_name) *prev = NULL;                                                                                 \
+        for (int i = 0, offset = 0; i < count; i++)                                                                          \
+        {                                                                                                                    \
+            __fastree_node(t_name) *leaf = __fastree_##t_name##_node(self, true);                                            \
+            leaf->length = n / count + (i < n % count);                                                                      \
+            memcpy(leaf->keys, keys + offset, leaf->length * sizeof(t_key));                                                 \
+            offset += leaf->length;                                                                                          \
+            if (prev)                                                                                                        \
+                prev->next = leaf;                                                                                           \
+            prev = leaf;                                                                                                     \
+            level[i] = leaf;                                                                                                 \
+            lows[i] = leaf->keys[0];                                                                                         \
+        }                                                                                                                    \
+        while (count > 1)                                                                                                    \
+        {                                                                                                                    \
+            int parents = (count + FASTREE_ORDER) / (FASTREE_ORDER + 1);                                                     \
+            for (int i = 0, offset = 0; i < parents; i++)                                                                    \
+            {                                                                                                                \
+                __fastree_node(t_name) *node = __fastree_##t_name##_node(self, false);                                       \
+                int children = count / parents + (i < count % parents);                                                      \
+                for (int j = 0; j < children; j++)                                                                           \
+                {                                                                                                            \
+                    node->children[j] = level[offset + j];                                                                   \
+                    if (j > 0)                                                                                               \
+                        node->keys[j - 1] = lows[offset + j];                                                                \
+                }                                                                                                            \
+                node->length = children - 1;                                                                                 \
+                level[i] = node;                                                                                             \
+                lows[i] = lows[offset];                                                                                      \
+                offset += children;                                                                                          \
+            }                                                                                                                \
+            count = parents;                                                                                                 \
+        }                                                                                                                    \
+        self->head = level[0];                                                                                               \
+        self->length = n;                                                                                                    \
+        xxfree(lows, ((n + FASTREE_ORDER - 1) / FASTREE_ORDER) * sizeof(t_key));                                             \
+        xxfree(level, ((n + FASTREE_ORDER - 1) / FASTREE_ORDER) * sizeof(__fastree_node(t_name) *));                         \
+    }                                                                                                                        \
+                                                                                                                             \
+    inline static void fastree_##t_name##_destroy(__fastree_type(t_name) * self)                                             \
+    {                                                                                                                        \
+        fastree_##t_name##_clear(self);                                                                                      \
+        xxfree(self, sizeof(__fastree_type(t_name)));                                                                        \
     }
 
-/*
-
-
-
-// Definition for an iterator
-typedef struct InorderIterator {
-    const TreeNode *current;
-    const TreeNode *stack[100];  // Adjust the size as needed
-    int top;
-} InorderIterator;
-
-// Initialize an inorder iterator
-void initInorderIterator(InorderIterator *iterator, const TreeNode *root) {
-    iterator->current = root;
-    iterator->top = 0;
-}
-
-// Helper function to push nodes onto the stack
-void push(InorderIterator *iterator, const TreeNode *node) {
-    if (iterator->top < 100) {
-        iterator->stack[iterator->top++] = node;
-    } else {
-        // Handle stack overflow
-        fprintf(stderr, "Stack overflow\n");
-    }
-}
-
-// Move the iterator to the next inorder node
-const TreeNode *next(InorderIterator *iterator) {
-    while (iterator->current || iterator->top > 0) {
-        // Push left child and move to the leftmost node
-        while (iterator->current) {
-            push(iterator, iterator->current);
-            iterator->current = iterator->current->left;
-        }
-
-        // Pop a node from the stack and process it
-        if (iterator->top > 0) {
-            iterator->current = iterator->stack[--iterator->top];
-            // Process the current node (e.g., print its value)
-            printf("%d ", iterator->current->data);
-            // Move to the right child
-            iterator->current = iterator->current->right;
-        }
-    }
-
-    return NULL; // End of traversal
-}
-
+#define fastree_for(t_name, self, it) for (__fastree_itter_type(t_name) it = fastree_##t_name##_begin(self); !fastree_##t_name##_eof(&it); fastree_##t_name##_next(&it))
 
-*/
\ No newline at end of file
+#endif
@@ -26,7 +26,6 @@
         __fastset_group_type(t_name) * groups;                                                                                                           \
         uint32_t length;                                                                                                                                 \
         uint64_t groupSize;                                                                                                                              \
-        uint32_t state;                                                                                                                                  \
         uint32_t seed;                                                                                                                                   \
         double loadFactor;                                                                                                                               \
     } __fastset_map_type(t_name);                                                                                                                        \
@@ -59,6 +58,7 @@
     }                                                                                                                                                    \
                                                                                                                                                          \
     inline static __fastset_node_type(t_name) * fastset_##t_name##_put(__fastset_map_type(t_name) * self, t_key key);                                    \
+    inline static __fastset_node_type(t_name) * fastset_##t_name##_get(__fastset_map_type(t_name) * self, t_key key);                                    \
                                                                                                                                                          \
     inline static __fastset_itter_type(t_name) __fastset_##t_name##_itter_init(__fastset_group_type(t_name) * begin, __fastset_group_type(t_name) * end) \
     {                                                                                                                                                    \
@@ -84,7 +84,7 @@
     inline static void __fastset_##t_name##_reserve(__fastset_map_type(t_name) * self, uint32_t newSize)                                                 \
     {                                                                                                                                                    \
         uint32_t size = newSize * sizeof(__fastset_group_type(t_name));                                                                                  \
-        self->groups = (__fastset_group_type(t_name) *)xxmalloc(size);                                                                                   \
+        self->groups = (__fastset_group_type(t_name) *)adt_malloc(size);                                                                                 \
         memset(self->groups, 0, size);                                                                                                                   \
         for (uint32_t i = 0; i < newSize; i++)                                                                                                           \
             (self->groups[i]).control = __fast_set1_epi8(__fast_enum_empty);                                                                             \
@@ -116,29 +116,24 @@
         self->loadFactor = ((double)self->length / (self->groupSize << 4));                                                                              \
         if (force || self->loadFactor >= 0.5f)                                                                                                           \
         {                                                                                                                                                \
-            __fastset__##t_name##_rehash(self, __fast_primes[self->state++]);                                                                            \
+            __fastset__##t_name##_rehash(self, self->groupSize << 1);                                                                                    \
         }                                                                                                                                                \
     }                                                                                                                                                    \
                                                                                                                                                          \
     inline static void __fastset__##t_name##_rehash_fit(__fastset_map_type(t_name) * self)                                                               \
     {                                                                                                                                                    \
-        for (int i = 0; i < 90; i++)                                                                                                                     \
-        {                                                                                                                                                \
-            if (__fast_primes[i] > (self->length >> 4))                                                                                                  \
-            {                                                                                                                                            \
-                self->state = i;                                                                                                                         \
-                __fastset__##t_name##_rehash(self, __fast_primes[self->state]);                                                                          \
-                return;                                                                                                                                  \
-            }                                                                                                                                            \
-        }                                                                                                                                                \
+        /* smallest power of two keeping the load under 0.5 */                                                                                           \
+        uint32_t groups = 1;                                                                                                                             \
+        while ((groups << 3) <= self->length)                                                                                                            \
+            groups <<= 1;                                                                                                                                \
+        __fastset__##t_name##_rehash(self, groups);                                                                                                      \
     }                                                                                                                                                    \
                                                                                                                                                          \
     inline static __fastset_map_type(t_name) * fastset_##t_name##_init()                                                                                 \
     {                                                                                                                                                    \
-        __fastset_map_type(t_name) *self = (__fastset_map_type(t_name) *)xxmalloc(sizeof(__fastset_map_type(t_name)));                                   \
+        __fastset_map_type(t_name) *self = (__fastset_map_type(t_name) *)adt_malloc(sizeof(__fastset_map_type(t_name)));                                 \
         self->length = 0;                                                                                                                                \
         self->groupSize = 0;                                                                                                                             \
-        self->state = 0;                                                                                                                                 \
         self->seed = 0;                                                                                                                                  \
         self->loadFactor = 0;                                                                                                                            \
         __fastset_##t_name##_reserve(self, 1);                                                                                                           \
@@ -148,8 +143,11 @@
     inline static __fastset_node_type(t_name) * fastset_##t_name##_put(__fastset_map_type(t_name) * self, t_key key)                                     \
     {                                                                                                                                                    \
         __fastset__##t_name##_rehash_grow(self, 0);                                                                                                      \
+        __fastset_node_type(t_name) *node = fastset_##t_name##_get(self, key);                                                                           \
+        if (node)                                                                                                                                        \
+            return node;                                                                                                                                 \
         uint64_t hash = t_hash(key, self->seed);                                                                                                         \
-        uint64_t groupIndex = __fast_h1(hash) % self->groupSize;                                                                                         \
+        uint64_t groupIndex = __fast_h1(hash) & (self->groupSize - 1);                                                                                   \
         uint8_t h2 = __fast_h2(hash);                                                                                                                    \
         __fastset_group_type(t_name) *g = NULL;                                                                                                          \
         uint16_t matches;                                                                                                                                \
@@ -157,20 +155,11 @@
         while (1)                                                                                                                                        \
         {                                                                                                                                                \
             g = &self->groups[groupIndex];                                                                                                               \
-            matches = __fast_match(g->control, h2);                                                                                                      \
-            int8_t i = 0;                                                                                                                                \
-            while (matches)                                                                                                                              \
-            {                                                                                                                                            \
-                if ((matches & 1) && t_compare(g->nodes[i].key, key) == 0)                                                                                    \
-                    return &(g->nodes[i]);                                                                                                               \
-                matches >>= 1;                                                                                                                           \
-                i++;                                                                                                                                     \
-            }                                                                                                                                            \
             matches = __fast_match_empty(g->control);                                                                                                    \
             if (matches)                                                                                                                                 \
                 break;                                                                                                                                   \
             g->overflow = 1;                                                                                                                             \
-            groupIndex = (groupIndex + 1) % self->groupSize;                                                                                             \
+            groupIndex = (groupIndex + 1) & (self->groupSize - 1);                                                                                       \
             ovf++;                                                                                                                                       \
         }                                                                                                                                                \
         if (ovf > 1)                                                                                                                                     \
@@ -178,18 +167,7 @@
             __fastset__##t_name##_rehash_grow(self, 1);                                                                                                  \
             return fastset_##t_name##_put(self, key);                                                                                                    \
         }                                                                                                                                                \
-        int8_t freeIndex = 0;                                                                                                                            \
-        int8_t i = 0;                                                                                                                                    \
-        while (matches)                                                                                                                                  \
-        {                                                                                                                                                \
-            if (matches & 0b1)                                                                                                                           \
-            {                                                                                                                                            \
-                freeIndex = i;                                                                                                                           \
-                break;                                                                                                                                   \
-            }                                                                                                                                            \
-            matches >>= 1;                                                                                                                               \
-            i++;                                                                                                                                         \
-        }                                                                                                                                                \
+        int8_t freeIndex = (int8_t)__builtin_ctz(matches);                                                                                               \
         __fast_set_byte(&g->control, h2, freeIndex);                                                                                                     \
         g->nodes[freeIndex].key = key;                                                                                                                   \
         self->length++;                                                                                                                                  \
@@ -199,27 +177,24 @@
     inline static __fastset_node_type(t_name) * fastset_##t_name##_get(__fastset_map_type(t_name) * self, t_key key)                                     \
     {                                                                                                                                                    \
         uint64_t hash = t_hash(key, self->seed);                                                                                                         \
-        uint64_t groupIndex = __fast_h1(hash) % self->groupSize;                                                                                         \
+        uint64_t groupIndex = __fast_h1(hash) & (self->groupSize - 1);                                                                                   \
         uint8_t h2 = __fast_h2(hash);                                                                                                                    \
         __fastset_group_type(t_name) * g;                                                                                                                \
         uint16_t matches;                                                                                                                                \
-        while (1)                                                                                                                                        \
+        for (uint64_t probe = 0; probe < self->groupSize; probe++)                                                                                       \
         {                                                                                                                                                \
             g = &self->groups[groupIndex];                                                                                                               \
             matches = __fast_match(g->control, h2);                                                                                                      \
-            int8_t i = 0;                                                                                                                                \
             while (matches)                                                                                                                              \
             {                                                                                                                                            \
-                if ((matches & 1) && t_compare(g->nodes[i].key, key) == 0)                                                                                    \
-                    return &(g->nodes[i]);                                                                                                               \
-                matches >>= 1;                                                                                                                           \
-                i++;                                                                                                                                     \
+                int i = __builtin_ctz(matches);                                                                                                          \
+                if (t_compare(g->nodes[i].key, key) == 0)                                                                                                \
+                    return &g->nodes[i];                                                                                                                 \
+                matches &= matches - 1;                                                                                                                  \
             }                                                                                                                                            \
-            if (__fast_match_empty(g->control))                                                                                                          \
-                break;                                                                                                                                   \
             if (!g->overflow)                                                                                                                            \
                 break;                                                                                                                                   \
-            groupIndex = (groupIndex + 1) % self->groupSize;                                                                                             \
+            groupIndex = (groupIndex + 1) & (self->groupSize - 1);                                                                                       \
         }                                                                                                                                                \
         return NULL;                                                                                                                                     \
     }                                                                                                                                                    \
@@ -242,29 +217,28 @@
     inline static bool fastset_##t_name##_remove(__fastset_map_type(t_name) * self, t_key key)                                                           \
     {                                                                                                                                                    \
         uint64_t hash = t_hash(key, self->seed);                                                                                                         \
-        uint64_t groupIndex = __fast_h1(hash) % self->groupSize;                                                                                         \
+        uint64_t groupIndex = __fast_h1(hash) & (self->groupSize - 1);                                                                                   \
         uint8_t h2 = __fast_h2(hash);                                                                                                                    \
         __fastset_group_type(t_name) * g;                                                                                                                \
         uint16_t matches;                                                                                                                                \
-        while (1)                                                                                                                                        \
+        for (uint64_t probe = 0; probe < self->groupSize; probe++)                                                                                       \
         {                                                                                                                                                \
             g = &self->groups[groupIndex];                                                                                                               \
             matches = __fast_match(g->control, h2);                                                                                                      \
-            int8_t i = 0;                                                                                                                                \
             while (matches)                                                                                                                              \
             {                                                                                                                                            \
-                if ((matches & 1) && t_compare(g->nodes[i].key, key) == 0)                                                                                    \
+                int i = __builtin_ctz(matches);                                                                                                          \
+                if (t_compare(g->nodes[i].key, key) == 0)                                                                                                \
                 {                                                                                                                                        \
                     __fast_set_byte(&g->control, __fast_enum_deleted, i);                                                                                \
                     self->length--;                                                                                                                      \
                     return true;                                                                                                                         \
                 }                                                                                                                                        \
-                matches >>= 1;                                                                                                                           \
-                i++;                                                                                                                                     \
+                matches &= matches - 1;                                                                                                                  \
             }                                                                                                                                            \
             if (!g->overflow)                                                                                                                            \
                 break;                                                                                                                                   \
-            groupIndex = (groupIndex + 1) % self->groupSize;                                                                                             \
+            groupIndex = (groupIndex + 1) & (self->groupSize - 1);                                                                                       \
         }                                                                                                                                                \
         return false;                                                                                                                                    \
     }                                                                                                                                                    \
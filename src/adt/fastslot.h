@@ -0,0 +1,173 @@
+#ifndef cgame_FASTSLOT_H
+#define cgame_FASTSLOT_H
+
+#include "fast.h"
+
+// a handle packs the slot index in the low bits and the slot generation above it,
+// erasing bumps the generation so stale handles stop resolving instead of aliasing a new element.
+// freed slots are reused oldest first and a slot whose generation runs out is never reused,
+// so a stale handle can not come back to life however often its slot is recycled
+#define FASTSLOT_INDEX_BITS 20
+#define FASTSLOT_INDEX_MASK ((1u << FASTSLOT_INDEX_BITS) - 1)
+#define FASTSLOT_GEN_MASK ((1u << (32 - FASTSLOT_INDEX_BITS)) - 1)
+// generations start at 1, so the zero handle never resolves
+#define FASTSLOT_NONE 0
+
+typedef uint32_t FastslotId;
+
+#define __fastslot_id(index, gen) (((gen) << FASTSLOT_INDEX_BITS) | (index))
+#define __fastslot_index(id) ((id) & FASTSLOT_INDEX_MASK)
+#define __fastslot_gen(id) ((id) >> FASTSLOT_INDEX_BITS)
+#define __fastslot_nil UINT32_MAX
+// above every generation a handle can carry
+#define __fastslot_retired (FASTSLOT_GEN_MASK + 1)
+
+typedef struct
+{
+    // position in the dense array while live, next free slot otherwise
+    uint32_t index;
+    uint32_t generation;
+} __FastslotSlot;
+
+#define __fastslot_type(t_name) Fastslot_##t_name
+
+#define make_fastslot_directives(t_name, t_key)                                                                        \
+    typedef struct                                                                                                     \
+    {                                                                                                                  \
+        int length;                                                                                                    \
+        int capacity;                                                                                                  \
+        uint32_t slotCount;                                                                                            \
+        uint32_t freeHead;                                                                                             \
+        uint32_t freeTail;                                                                                             \
+        t_key *dense;                                                                                                  \
+        uint32_t *owner;                                                                                               \
+        __FastslotSlot *slots;                                                                                         \
+    } __fastslot_type(t_name);                                                                                         \
+                                                                                                                       \
+    inline static __fastslot_type(t_name) * fastslot_##t_name##_init(int cap)                                          \
+    {                                                                                                                  \
+        __fastslot_type(t_name) *self = adt_malloc(sizeof(__fastslot_type(t_name)));                                   \
+        self->length = 0;                                                                                              \
+        self->capacity = cap > 8 ? cap : 8;                                                                            \
+        self->slotCount = 0;                                                                                           \
+        self->freeHead = __fastslot_nil;                                                                               \
+        self->freeTail = __fastslot_nil;                                                                               \
+        self->dense = adt_malloc(self->capacity * sizeof(t_key));                                                      \
+        self->owner = adt_malloc(self->capacity * sizeof(uint32_t));                                                   \
+        self->slots = adt_malloc(self->capacity * sizeof(__FastslotSlot));                                             \
+        return self;                                                                                                   \
+    }                                                                                                                  \
+    inline static void fastslot_##t_name##_destroy(__fastslot_type(t_name) * self)                                     \
+    {                                                                                                                  \
+        xxfree(self->dense, self->capacity * sizeof(t_key));                                                           \
+        xxfree(self->owner, self->capacity * sizeof(uint32_t));                                                        \
+        xxfree(self->slots, self->capacity * sizeof(__FastslotSlot));                                                  \
+        xxfree(self, sizeof(__fastslot_type(t_name)));                                                                 \
+    }                                                                                                                  \
+    inline static void fastslot_##t_name##_reserve(__fastslot_type(t_name) * self, int cap)                            \
+    {                                                                                                                  \
+        if (cap <= self->capacity)                                                                                     \
+            return;                                                                                                    \
+        self->dense = adt_realloc(self->dense, self->capacity * sizeof(t_key), cap * sizeof(t_key));                   \
+        self->owner = adt_realloc(self->owner, self->capacity * sizeof(uint32_t), cap * sizeof(uint32_t));             \
+        self->slots = adt_realloc(self->slots, self->capacity * sizeof(__FastslotSlot), cap * sizeof(__FastslotSlot)); \
+        self->capacity = cap;                                                                                          \
+    }                                                                                                                  \
+    inline static void __fastslot_##t_name##_release(__fastslot_type(t_name) * self, uint32_t slot)                    \
+    {                                                                                                                  \
+        __FastslotSlot *it = &self->slots[slot];                                                                       \
+        if (it->generation == FASTSLOT_GEN_MASK)                                                                       \
+        {                                                                                                              \
+            it->generation = __fastslot_retired;                                                                       \
+            return;                                                                                                    \
+        }                                                                                                              \
+        it->generation++;                                                                                              \
+        it->index = __fastslot_nil;                                                                                    \
+        if (self->freeTail != __fastslot_nil)                                                                          \
+            self->slots[self->freeTail].index = slot;                                                                  \
+        else                                                                                                           \
+            self->freeHead = slot;                                                                                     \
+        self->freeTail = slot;                                                                                         \
+    }                                                                                                                  \
+    /* appends an element and writes its handle, the element is left uninitialized */                                  \
+    /* returns NULL once every index bit is in use */                                                                  \
+    inline static t_key *fastslot_##t_name##_emplace(__fastslot_type(t_name) * self, FastslotId *id)                   \
+    {                                                                                                                  \
+        uint32_t slot = self->freeHead;                                                                                \
+        if (slot != __fastslot_nil)                                                                                    \
+        {                                                                                                              \
+            self->freeHead = self->slots[slot].index;                                                                  \
+            if (self->freeHead == __fastslot_nil)                                                                      \
+                self->freeTail = __fastslot_nil;                                                                       \
+        }                                                                                                              \
+        else                                                                                                           \
+        {                                                                                                              \
+            if (self->slotCount > FASTSLOT_INDEX_MASK)                                                                 \
+                return NULL;                                                                                           \
+            if ((int)self->slotCount == self->capacity)                                                                \
+                fastslot_##t_name##_reserve(self, self->capacity << 1);                                                \
+            slot = self->slotCount++;                                                                                  \
+            self->slots[slot].generation = 1;                                                                          \
+        }                                                                                                              \
+        uint32_t index = self->length++;                                                                               \
+        self->slots[slot].index = index;                                                                               \
+        self->owner[index] = slot;                                                                                     \
+        *id = __fastslot_id(slot, self->slots[slot].generation);                                                       \
+        return &self->dense[index];                                                                                    \
+    }                                                                                                                  \
+    inline static FastslotId fastslot_##t_name##_add(__fastslot_type(t_name) * self, t_key value)                      \
+    {                                                                                                                  \
+        FastslotId id = FASTSLOT_NONE;                                                                                 \
+        t_key *it = fastslot_##t_name##_emplace(self, &id);                                                            \
+        if (it)                                                                                                        \
+            *it = value;                                                                                               \
+        return id;                                                                                                     \
+    }                                                                                                                  \
+    inline static bool fastslot_##t_name##_has(__fastslot_type(t_name) * self, FastslotId id)                          \
+    {                                                                                                                  \
+        uint32_t slot = __fastslot_index(id);                                                                          \
+        return slot < self->slotCount && self->slots[slot].generation == __fastslot_gen(id);                           \
+    }                                                                                                                  \
+    inline static t_key *fastslot_##t_name##_get(__fastslot_type(t_name) * self, FastslotId id)                        \
+    {                                                                                                                  \
+        if (!fastslot_##t_name##_has(self, id))                                                                        \
+            return NULL;                                                                                               \
+        return &self->dense[self->slots[__fastslot_index(id)].index];                                                  \
+    }                                                                                                                  \
+    /* handle of the element at a dense position, for use while iterating */                                           \
+    inline static FastslotId fastslot_##t_name##_id_at(__fastslot_type(t_name) * self, int index)                      \
+    {                                                                                                                  \
+        uint32_t slot = self->owner[index];                                                                            \
+        return __fastslot_id(slot, self->slots[slot].generation);                                                      \
+    }                                                                                                                  \
+    /* the last element moves into the hole, so walking the dense array backwards */                                   \
+    /* stays valid when the current element is removed */                                                              \
+    inline static bool fastslot_##t_name##_remove(__fastslot_type(t_name) * self, FastslotId id)                       \
+    {                                                                                                                  \
+        if (!fastslot_##t_name##_has(self, id))                                                                        \
+            return false;                                                                                              \
+        uint32_t slot = __fastslot_index(id);                                                                          \
+        uint32_t index = self->slots[slot].index;                                                                      \
+        uint32_t last = --self->length;                                                                                \
+        if (index != last)                                                                                             \
+        {                                                                                                              \
+            self->dense[index] = self->dense[last];                                                                    \
+            self->owner[index] = self->owner[last];                                                                    \
+            self->slots[self->owner[index]].index = index;                                                             \
+        }                                                                                                              \
+        __fastslot_##t_name##_release(self, slot);                                                                     \
+        return true;                                                                                                   \
+    }                                                                                                                  \
+    inline static bool fastslot_##t_name##_empty(__fastslot_type(t_name) * self)                                       \
+    {                                                                                                                  \
+        return self->length == 0;                                                                                      \
+    }                                                                                                                  \
+    /* every outstanding handle is invalidated */                                                                      \
+    inline static void fastslot_##t_name##_clear(__fastslot_type(t_name) * self)                                       \
+    {                                                                                                                  \
+        for (int i = 0; i < self->length; i++)                                                                         \
+            __fastslot_##t_name##_release(self, self->owner[i]);                                                       \
+        self->length = 0;                                                                                              \
+    }
+
+#endif
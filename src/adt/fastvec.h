@@ -3,64 +3,131 @@
 
 #include "fast.h"
 
+// bytes of storage kept inside the vector itself, short vectors never allocate a separate buffer
+#ifndef FASTVEC_INLINE_BYTES
+#define FASTVEC_INLINE_BYTES 64
+#endif
+#define __fastvec_inline(t_key) ((int)(FASTVEC_INLINE_BYTES / sizeof(t_key)))
+
 #define __fastvec_type(t_name) Fastvec_##t_name
 
-#define make_fastvec_directives(t_name, t_key)                                             \
-    typedef struct                                                                         \
-    {                                                                                      \
-        int length;                                                                        \
-        int capacity;                                                                      \
-        t_key *vector;                                                                     \
-    } __fastvec_type(t_name);                                                              \
-                                                                                           \
-    inline static __fastvec_type(t_name) * fastvec_##t_name##_init(int cap)                \
-    {                                                                                      \
-        __fastvec_type(t_name) *self = xxmalloc(sizeof(__fastvec_type(t_name)));           \
-        self->capacity = cap;                                                              \
-        self->length = 0;                                                                  \
-        self->vector = xxmalloc(self->capacity * sizeof(t_key));                           \
-        return self;                                                                       \
-    }                                                                                      \
-    inline static void fastvec_##t_name##_destroy(__fastvec_type(t_name) * self)           \
-    {                                                                                      \
-        xxfree(self->vector, self->capacity * sizeof(t_key));                              \
-        xxfree(self, sizeof(__fastvec_type(t_name)));                                      \
-    }                                                                                      \
-    inline static void fastvec_##t_name##_push(__fastvec_type(t_name) * self, t_key value) \
-    {                                                                                      \
-        if (self->length == self->capacity)                                                \
-        {                                                                                  \
-            int nOldCap = self->capacity;                                                  \
-            self->capacity = self->capacity << 1;                                          \
-            t_key *vector = xxmalloc(self->capacity * sizeof(t_key));                      \
-            memcpy(vector, self->vector, nOldCap * sizeof(t_key));                         \
-            xxfree(self->vector, nOldCap * sizeof(t_key));                                 \
-            self->vector = vector;                                                         \
-        }                                                                                  \
-        self->vector[self->length++] = value;                                              \
-    }                                                                                      \
-    inline static t_key fastvec_##t_name##_pop(__fastvec_type(t_name) * self)              \
-    {                                                                                      \
-        return self->vector[--self->length];                                               \
-    }                                                                                      \
-    inline static bool fastvec_##t_name##_empty(__fastvec_type(t_name) * self)            \
-    {                                                                                      \
-        return self->length == 0;                                                          \
-    }                                                                                      \
-    inline static void fastvec_##t_name##_remove(__fastvec_type(t_name) * self, int index) \
-    {                                                                                      \
-        self->length--;                                                                    \
-        t_key *tmp = &self->vector[index];                                                 \
-        self->vector[index] = self->vector[self->length];                                  \
-        self->vector[self->length] = *tmp;                                                 \
-    }                                                                                      \
-    inline static t_key *fastvec_##t_name##_top(__fastvec_type(t_name) * self)              \
-    {                                                                                      \
-        return &self->vector[self->length - 1];                                             \
-    }                                                                                      \
-    inline static void fastvec_##t_name##_clear(__fastvec_type(t_name) * self)             \
-    {                                                                                      \
-        self->length = 0;                                                                  \
+#define make_fastvec_directives(t_name, t_key)                                                              \
+    typedef struct                                                                                          \
+    {                                                                                                       \
+        int length;                                                                                         \
+        int capacity;                                                                                       \
+        t_key *vector;                                                                                      \
+        t_key small[FASTVEC_INLINE_BYTES / sizeof(t_key)];                                                  \
+    } __fastvec_type(t_name);                                                                               \
+                                                                                                            \
+    inline static __fastvec_type(t_name) * fastvec_##t_name##_init(int cap)                                 \
+    {                                                                                                       \
+        __fastvec_type(t_name) *self = adt_malloc(sizeof(__fastvec_type(t_name)));                          \
+        self->length = 0;                                                                                   \
+        if (cap <= __fastvec_inline(t_key))                                                                 \
+        {                                                                                                   \
+            self->capacity = __fastvec_inline(t_key);                                                       \
+            self->vector = self->small;                                                                     \
+        }                                                                                                   \
+        else                                                                                                \
+        {                                                                                                   \
+            self->capacity = cap;                                                                           \
+            self->vector = adt_malloc(self->capacity * sizeof(t_key));                                      \
+        }                                                                                                   \
+        return self;                                                                                        \
+    }                                                                                                       \
+    inline static void fastvec_##t_name##_destroy(__fastvec_type(t_name) * self)                            \
+    {                                                                                                       \
+        if (self->vector != self->small)                                                                    \
+            xxfree(self->vector, self->capacity * sizeof(t_key));                                           \
+        xxfree(self, sizeof(__fastvec_type(t_name)));                                                       \
+    }                                                                                                       \
+    /* moves the elements into a buffer of exactly cap slots, or back inline when they fit */               \
+    inline static void __fastvec_##t_name##_storage(__fastvec_type(t_name) * self, int cap)                 \
+    {                                                                                                       \
+        if (cap <= __fastvec_inline(t_key))                                                                 \
+        {                                                                                                   \
+            if (self->vector != self->small)                                                                \
+            {                                                                                               \
+                memcpy(self->small, self->vector, self->length * sizeof(t_key));                            \
+                xxfree(self->vector, self->capacity * sizeof(t_key));                                       \
+                self->vector = self->small;                                                                 \
+            }                                                                                               \
+            self->capacity = __fastvec_inline(t_key);                                                       \
+            return;                                                                                         \
+        }                                                                                                   \
+        if (self->vector == self->small)                                                                    \
+        {                                                                                                   \
+            self->vector = adt_malloc(cap * sizeof(t_key));                                                 \
+            memcpy(self->vector, self->small, self->length * sizeof(t_key));                                \
+        }                                                                                                   \
+        else                                                                                                \
+        {                                                                                                   \
+            self->vector = adt_realloc(self->vector, self->capacity * sizeof(t_key), cap * sizeof(t_key));  \
+        }                                                                                                   \
+        self->capacity = cap;                                                                               \
+    }                                                                                                       \
+    inline static void __fastvec_##t_name##_grow(__fastvec_type(t_name) * self, int length)                 \
+    {                                                                                                       \
+        int cap = self->capacity > 4 ? self->capacity : 4;                                                  \
+        while (cap < length)                                                                                \
+            cap = cap << 1;                                                                                 \
+        __fastvec_##t_name##_storage(self, cap);                                                            \
+    }                                                                                                       \
+    inline static void fastvec_##t_name##_reserve(__fastvec_type(t_name) * self, int cap)                   \
+    {                                                                                                       \
+        if (cap > self->capacity)                                                                           \
+            __fastvec_##t_name##_storage(self, cap);                                                        \
+    }                                                                                                       \
+    inline static void fastvec_##t_name##_shrink_to_fit(__fastvec_type(t_name) * self)                      \
+    {                                                                                                       \
+        if (self->length < self->capacity)                                                                  \
+            __fastvec_##t_name##_storage(self, self->length);                                               \
+    }                                                                                                       \
+    inline static void fastvec_##t_name##_push(__fastvec_type(t_name) * self, t_key value)                  \
+    {                                                                                                       \
+        if (self->length == self->capacity)                                                                 \
+            __fastvec_##t_name##_grow(self, self->length + 1);                                              \
+        self->vector[self->length++] = value;                                                               \
+    }                                                                                                       \
+    inline static void fastvec_##t_name##_push_n(__fastvec_type(t_name) * self, const t_key *values, int n) \
+    {                                                                                                       \
+        if (self->length + n > self->capacity)                                                              \
+            __fastvec_##t_name##_grow(self, self->length + n);                                              \
+        memcpy(self->vector + self->length, values, n * sizeof(t_key));                                     \
+        self->length += n;                                                                                  \
+    }                                                                                                       \
+    /* new elements are zeroed */                                                                           \
+    inline static void fastvec_##t_name##_resize(__fastvec_type(t_name) * self, int length)                 \
+    {                                                                                                       \
+        if (length > self->capacity)                                                                        \
+            __fastvec_##t_name##_grow(self, length);                                                        \
+        if (length > self->length)                                                                          \
+            memset(self->vector + self->length, 0, (length - self->length) * sizeof(t_key));                \
+        self->length = length;                                                                              \
+    }                                                                                                       \
+    inline static t_key fastvec_##t_name##_pop(__fastvec_type(t_name) * self)                               \
+    {                                                                                                       \
+        return self->vector[--self->length];                                                                \
+    }                                                                                                       \
+    inline static bool fastvec_##t_name##_empty(__fastvec_type(t_name) * self)                              \
+    {                                                                                                       \
+        return self->length == 0;                                                                           \
+    }                                                                                                       \
+    inline static void fastvec_##t_name##_remove(__fastvec_type(t_name) * self, int index)                  \
+    {                                                                                                       \
+        self->length--;                                                                                     \
+        t_key *tmp = &self->vector[index];                                                                  \
+        self->vector[index] = self->vector[self->length];                                                   \
+        self->vector[self->length] = *tmp;                                                                  \
+    }                                                                                                       \
+    inline static t_key *fastvec_##t_name##_top(__fastvec_type(t_name) * self)                              \
+    {                                                                                                       \
+        return &self->vector[self->length - 1];                                                             \
+    }                                                                                                       \
+    inline static void fastvec_##t_name##_clear(__fastvec_type(t_name) * self)                              \
+    {                                                                                                       \
+        self->length = 0;                                                                                   \
     }
 
 #endif
\ No newline at end of file
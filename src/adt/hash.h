@@ -0,0 +1,125 @@
+#ifndef cgame_HASH_H
+#define cgame_HASH_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+// 64 bit hash after wyhash final4 by Wang Yi (public domain). keys up to 16 bytes take two
+// overlapping reads and a single 128 bit multiply, longer keys mix 48 bytes per round
+static const uint64_t __hash_secret[4] = {
+    0x2d358dccaa6c78a5ull, 0x8bb84b93962eacc9ull, 0x4b33a62ed433d4a3ull, 0x4d5a2da51de1aa47ull};
+
+static inline void __hash_mum(uint64_t *a, uint64_t *b)
+{
+    __uint128_t r = (__uint128_t)*a * *b;
+    *a = (uint64_t)r;
+    *b = (uint64_t)(r >> 64);
+}
+
+static inline uint64_t __hash_mix(uint64_t a, uint64_t b)
+{
+    __hash_mum(&a, &b);
+    return a ^ b;
+}
+
+static inline uint64_t __hash_r8(const uint8_t *p)
+{
+    uint64_t v;
+    memcpy(&v, p, 8);
+    return v;
+}
+
+static inline uint64_t __hash_r4(const uint8_t *p)
+{
+    uint32_t v;
+    memcpy(&v, p, 4);
+    return v;
+}
+
+static inline uint64_t __hash_r3(const uint8_t *p, size_t k)
+{
+    return (((uint64_t)p[0]) << 16) | (((uint64_t)p[k >> 1]) << 8) | p[k - 1];
+}
+
+static inline __attribute__((always_inline)) uint64_t hash64(const void *key, size_t len, uint64_t seed)
+{
+    const uint8_t *p = (const uint8_t *)key;
+    seed ^= __hash_mix(seed ^ __hash_secret[0], __hash_secret[1]);
+    uint64_t a, b;
+    if (__builtin_expect(len <= 16, 1))
+    {
+        if (__builtin_expect(len >= 4, 1))
+        {
+            a = (__hash_r4(p) << 32) | __hash_r4(p + ((len >> 3) << 2));
+            b = (__hash_r4(p + len - 4) << 32) | __hash_r4(p + len - 4 - ((len >> 3) << 2));
+        }
+        else if (__builtin_expect(len > 0, 1))
+        {
+            a = __hash_r3(p, len);
+            b = 0;
+        }
+        else
+        {
+            a = b = 0;
+        }
+    }
+    else
+    {
+        size_t i = len;
+        if (__builtin_expect(i >= 48, 0))
+        {
+            uint64_t see1 = seed, see2 = seed;
+            do
+            {
+                seed = __hash_mix(__hash_r8(p) ^ __hash_secret[1], __hash_r8(p + 8) ^ seed);
+                see1 = __hash_mix(__hash_r8(p + 16) ^ __hash_secret[2], __hash_r8(p + 24) ^ see1);
+                see2 = __hash_mix(__hash_r8(p + 32) ^ __hash_secret[3], __hash_r8(p + 40) ^ see2);
+                p += 48;
+                i -= 48;
+            } while (__builtin_expect(i >= 48, 1));
+            seed ^= see1 ^ see2;
+        }
+        while (__builtin_expect(i > 16, 0))
+        {
+            seed = __hash_mix(__hash_r8(p) ^ __hash_secret[1], __hash_r8(p + 8) ^ seed);
+            i -= 16;
+            p += 16;
+        }
+        a = __hash_r8(p + i - 16);
+        b = __hash_r8(p + i - 8);
+    }
+    a ^= __hash_secret[1];
+    b ^= seed;
+    __hash_mum(&a, &b);
+    return __hash_mix(a ^ __hash_secret[0] ^ len, b ^ __hash_secret[1]);
+}
+
+// fixed size keys, the constant length folds every branch above away
+static inline uint64_t hash64_4(const void *key, uint64_t seed)
+{
+    return hash64(key, 4, seed);
+}
+
+static inline uint64_t hash64_8(const void *key, uint64_t seed)
+{
+    return hash64(key, 8, seed);
+}
+
+static inline uint64_t hash64_12(const void *key, uint64_t seed)
+{
+    return hash64(key, 12, seed);
+}
+
+static inline uint64_t hash64_16(const void *key, uint64_t seed)
+{
+    return hash64(key, 16, seed);
+}
+
+// integer keys that are already in a register
+static inline uint64_t hash64_u64(uint64_t key, uint64_t seed)
+{
+    return __hash_mix(key ^ __hash_secret[0], seed ^ __hash_secret[1]);
+}
+
+#endif
@@ -6,6 +6,7 @@
 #include <stdlib.h>
 #include <stdbool.h>
 #include <string.h>
+#include <immintrin.h>
 #include "mem/alloc.h"
 
 typedef struct
@@ -23,6 +24,32 @@ static const StrView str_null = {NULL, 0};
 #define len(s) (s.length)
 #define fstr(text, ...) ()
 
+// byte scans work a vector at a time, 32 bytes when built with avx2 and 16 with the sse2 baseline
+#ifdef __AVX2__
+typedef __m256i __StrChunk;
+# define __STR_CHUNK 32
+# define __STR_FULL 0xFFFFFFFFu
+# define __str_load(p) _mm256_loadu_si256((const __m256i *)(p))
+# define __str_splat(c) _mm256_set1_epi8(c)
+# define __str_eq(a, b) _mm256_cmpeq_epi8(a, b)
+# define __str_and(a, b) _mm256_and_si256(a, b)
+# define __str_le(a, b) _mm256_cmpeq_epi8(_mm256_max_epu8(a, b), b)
+# define __str_mask(v) ((uint32_t)_mm256_movemask_epi8(v))
+#else
+typedef __m128i __StrChunk;
+# define __STR_CHUNK 16
+# define __STR_FULL 0xFFFFu
+# define __str_load(p) _mm_loadu_si128((const __m128i *)(p))
+# define __str_splat(c) _mm_set1_epi8(c)
+# define __str_eq(a, b) _mm_cmpeq_epi8(a, b)
+# define __str_and(a, b) _mm_and_si128(a, b)
+# define __str_le(a, b) _mm_cmpeq_epi8(_mm_max_epu8(a, b), b)
+# define __str_mask(v) ((uint32_t)_mm_movemask_epi8(v))
+#endif
+
+// tokens are separated by any run of bytes up to and including space, so tabs and line ends too
+#define __str_is_space(c) ((unsigned char)(c) <= ' ')
+
 #define __string_repeat_index(i, n) ((i) < 0 ? ((n) - ((-(i)-1) % (n) + 1)) : ((i) % (n)))
 
 #define reverse(arr, n) ({     \
@@ -44,20 +71,56 @@ static inline bool str_empty(const StrView a)
     return a.string == NULL || a.length == 0;
 }
 
-static inline void str_lps(const StrView needle, int32_t *lps)
+/* first index from start whose byte is (match) or is not (!match) c, -1 if none */
+static inline int32_t __str_scan(const StrView str, char c, int32_t start, bool match)
+{
+    if (start < 0 || start >= str.length)
+        return -1;
+    const char *s = str.string;
+    uint32_t i = start;
+    __StrChunk splat = __str_splat(c);
+    for (; i + __STR_CHUNK <= str.length; i += __STR_CHUNK)
+    {
+        uint32_t mask = __str_mask(__str_eq(__str_load(s + i), splat));
+        if (!match)
+            mask = ~mask & __STR_FULL;
+        if (mask)
+            return i + __builtin_ctz(mask);
+    }
+    for (; i < str.length; i++)
+        if ((s[i] == c) == match)
+            return i;
+    return -1;
+}
+
+/* same as __str_scan but for whitespace, see __str_is_space */
+static inline int32_t __str_scan_space(const StrView str, int32_t start, bool match)
 {
-    int32_t j = 0, i = 1;
-    while (i < needle.length)
+    if (start < 0 || start >= str.length)
+        return -1;
+    const char *s = str.string;
+    uint32_t i = start;
+    __StrChunk space = __str_splat(' ');
+    for (; i + __STR_CHUNK <= str.length; i += __STR_CHUNK)
     {
-        if (needle.string[i] == needle.string[j])
-            lps[i++] = ++j;
-        else if (j == 0)
-            i++;
-        else
-            j = lps[j - 1];
+        uint32_t mask = __str_mask(__str_le(__str_load(s + i), space));
+        if (!match)
+            mask = ~mask & __STR_FULL;
+        if (mask)
+            return i + __builtin_ctz(mask);
     }
+    for (; i < str.length; i++)
+        if (__str_is_space(s[i]) == match)
+            return i;
+    return -1;
 }
 
+static inline int32_t str_find_char(const StrView str, char c, int32_t start)
+{
+    return __str_scan(str, c, start, true);
+}
+
+/* candidates are positions where both the first and the last needle byte match, only those get a memcmp */
 static inline int32_t str_find(const StrView haystack, const StrView needle, int32_t start)
 {
 
@@ -65,29 +128,33 @@ static inline int32_t str_find(const StrView haystack, const StrView needle, int
         return -1;
     if (start < 0 || start >= haystack.length)
         return -1;
-    int32_t j = 0, i = start;
     uint32_t n = needle.length;
-    int32_t *lps = (int *)xxstack(sizeof(int32_t) * n);
-    memset(lps, 0, sizeof(int32_t) * n);
-    str_lps(needle, lps);
-    while (i < haystack.length)
+    if (n == 1)
+        return str_find_char(haystack, needle.string[0], start);
+    if (n > haystack.length - start)
+        return -1;
+    const char *s = haystack.string;
+    const char *w = needle.string;
+    uint32_t last = haystack.length - n;
+    uint32_t i = start;
+    __StrChunk first = __str_splat(w[0]);
+    __StrChunk final = __str_splat(w[n - 1]);
+    for (; i + __STR_CHUNK <= last + 1; i += __STR_CHUNK)
     {
-        if (haystack.string[i] == needle.string[j])
+        __StrChunk a = __str_eq(first, __str_load(s + i));
+        __StrChunk b = __str_eq(final, __str_load(s + i + n - 1));
+        uint32_t mask = __str_mask(__str_and(a, b));
+        while (mask)
         {
-            i++;
-            j++;
-        }
-        else if (j == 0)
-            i++;
-        else
-            j = lps[j - 1];
-        if (j == n)
-        {
-            xxfreestack(lps);
-            return i - n;
+            uint32_t bit = __builtin_ctz(mask);
+            if (memcmp(s + i + bit + 1, w + 1, n - 2) == 0)
+                return i + bit;
+            mask &= mask - 1;
         }
     }
-    xxfreestack(lps);
+    for (; i <= last; i++)
+        if (s[i] == w[0] && s[i + n - 1] == w[n - 1] && memcmp(s + i + 1, w + 1, n - 2) == 0)
+            return i;
     return -1;
 }
 
@@ -102,22 +169,12 @@ static inline long str_tolong(const StrView str)
 }
 static inline int32_t str_skipchar(const StrView str, char c, int32_t start)
 {
-    if (start < 0 || start >= str.length)
-        return -1;
-    for (uint32_t i = start; i < str.length; i++)
-        if (str.string[i] != c)
-            return i;
-    return -1;
+    return __str_scan(str, c, start, false);
 }
 
 static inline int32_t str_untilchar(const StrView str, char c, int32_t start)
 {
-    if (start < 0 || start >= str.length)
-        return -1;
-    for (uint32_t i = start; i < str.length; i++)
-        if (str.string[i] == c)
-            return i;
-    return -1;
+    return __str_scan(str, c, start, true);
 }
 
 static inline int32_t str_untilchar_rev(const StrView str, char c, int32_t start)
@@ -206,6 +263,22 @@ inline static int str_splitchar(StrView line, char c, StrView splits[])
     return i;
 }
 
+/* splits on whitespace runs into at most max tokens, returns the count */
+inline static int str_tokenize(StrView line, StrView tokens[], int max)
+{
+    int n = 0;
+    int32_t start = __str_scan_space(line, 0, false);
+    while (start != -1 && n < max)
+    {
+        int32_t end = __str_scan_space(line, start, true);
+        if (end == -1)
+            end = line.length;
+        tokens[n++] = strv(line.string + start, (uint32_t)(end - start));
+        start = __str_scan_space(line, end, false);
+    }
+    return n;
+}
+
 inline static void str_truncate(StrView splits[], int n)
 {
     for (int i = 0; i < n; i++)
@@ -1,18 +1,221 @@
-
 #include <jemalloc/jemalloc.h>
 #include <stdint.h>
+#include <stdatomic.h>
+#include <pthread.h>
 #include <memory.h>
+#include <assert.h>
 #include "mem/alloc.h"
 #include "mem/defs.h"
 
-void *xxmalloc(size_t size)
+// small blocks are recycled through a per thread cache, larger ones go straight to jemalloc
+#define CACHE_MAX_SIZE 4096
+#define CACHE_MAX_BYTES (64 * KILOBYTES)
+#define CACHE_GRANULE DEFAULT_MEMORY_ALIGNMENT
+
+static const size_t cache_classes[] = {
+    32, 64, 96, 128, 192, 256, 384, 512, 768, 1024, 1536, 2048, 3072, 4096};
+
+#define CACHE_CLASS_COUNT (sizeof(cache_classes) / sizeof(cache_classes[0]))
+
+typedef struct CacheBlock
+{
+    struct CacheBlock *next;
+} CacheBlock;
+
+typedef struct ThreadCache
+{
+    CacheBlock *free[CACHE_CLASS_COUNT];
+    size_t count[CACHE_CLASS_COUNT];
+    // only the owning thread writes this, other threads read it when summing
+    _Atomic int64_t usage;
+    struct ThreadCache *prev;
+    struct ThreadCache *next;
+    int registered;
+} ThreadCache;
+
+static uint8_t cache_class_map[CACHE_MAX_SIZE / CACHE_GRANULE + 1];
+static pthread_once_t cache_once = PTHREAD_ONCE_INIT;
+static pthread_key_t cache_key;
+static pthread_mutex_t cache_mutex = PTHREAD_MUTEX_INITIALIZER;
+static ThreadCache *cache_threads = NULL;
+// usage left behind by threads that already exited
+static _Atomic int64_t cache_retired = 0;
+
+static _Thread_local ThreadCache cache;
+
+static void cache_flush(ThreadCache *self)
+{
+    for (size_t i = 0; i < CACHE_CLASS_COUNT; i++)
+    {
+        CacheBlock *block = self->free[i];
+        while (block)
+        {
+            CacheBlock *next = block->next;
+            free(block);
+            block = next;
+        }
+        self->free[i] = NULL;
+        self->count[i] = 0;
+    }
+}
+
+static void cache_thread_exit(void *ptr)
+{
+    ThreadCache *self = (ThreadCache *)ptr;
+    cache_flush(self);
+
+    pthread_mutex_lock(&cache_mutex);
+    atomic_fetch_add(&cache_retired, atomic_load(&self->usage));
+    if (self->prev)
+        self->prev->next = self->next;
+    else
+        cache_threads = self->next;
+    if (self->next)
+        self->next->prev = self->prev;
+    pthread_mutex_unlock(&cache_mutex);
+
+    atomic_store(&self->usage, 0);
+    self->registered = 0;
+}
+
+static void cache_init()
+{
+    size_t j = 0;
+    for (size_t i = 0; i <= CACHE_MAX_SIZE / CACHE_GRANULE; i++)
+    {
+        while (cache_classes[j] < i * CACHE_GRANULE)
+            j++;
+        cache_class_map[i] = (uint8_t)j;
+    }
+    pthread_key_create(&cache_key, cache_thread_exit);
+}
+
+static inline ThreadCache *cache_get()
+{
+    ThreadCache *self = &cache;
+    if (__builtin_expect(!self->registered, 0))
+    {
+        pthread_once(&cache_once, cache_init);
+        pthread_mutex_lock(&cache_mutex);
+        self->prev = NULL;
+        self->next = cache_threads;
+        if (cache_threads)
+            cache_threads->prev = self;
+        cache_threads = self;
+        pthread_mutex_unlock(&cache_mutex);
+        pthread_setspecific(cache_key, self);
+        self->registered = 1;
+    }
+    return self;
+}
+
+static inline size_t cache_class(size_t size)
 {
-    alloc->usage += size;
-    return aligned_alloc(DEFAULT_MEMORY_ALIGNMENT, size);
+    return cache_class_map[(size + CACHE_GRANULE - 1) / CACHE_GRANULE];
 }
 
-extern void xxfree(void *ptr, size_t size)
+static inline void cache_account(ThreadCache *self, int64_t delta)
 {
-    alloc->usage -= size;
+    int64_t usage = atomic_load_explicit(&self->usage, memory_order_relaxed);
+    atomic_store_explicit(&self->usage, usage + delta, memory_order_relaxed);
+}
+
+void *(xxmalloc)(size_t size)
+{
+    ThreadCache *self = cache_get();
+    cache_account(self, (int64_t)size);
+    if (size > CACHE_MAX_SIZE)
+        return aligned_alloc(DEFAULT_MEMORY_ALIGNMENT, size);
+
+    size_t index = cache_class(size);
+    CacheBlock *block = self->free[index];
+    if (block)
+    {
+        self->free[index] = block->next;
+        self->count[index]--;
+        return block;
+    }
+    return aligned_alloc(DEFAULT_MEMORY_ALIGNMENT, cache_classes[index]);
+}
+
+void (xxfree)(void *ptr, size_t size)
+{
+    if (!ptr)
+        return;
+    // the class comes from the size the caller passes, one larger than the block would later
+    // hand it out to an allocation it cannot hold
+    assert(sallocx(ptr, 0) >= (size > CACHE_MAX_SIZE ? size : cache_classes[cache_class(size)]));
+    ThreadCache *self = cache_get();
+    cache_account(self, -(int64_t)size);
+    if (size > CACHE_MAX_SIZE)
+    {
+        free(ptr);
+        return;
+    }
+
+    size_t index = cache_class(size);
+    if (self->count[index] * cache_classes[index] >= CACHE_MAX_BYTES)
+    {
+        free(ptr);
+        return;
+    }
+    CacheBlock *block = (CacheBlock *)ptr;
+    block->next = self->free[index];
+    self->free[index] = block;
+    self->count[index]++;
+}
+
+void *(xxrealloc)(void *ptr, size_t size, size_t newSize)
+{
+    if (!ptr)
+        return (xxmalloc)(newSize);
+    ThreadCache *self = cache_get();
+    if (size > CACHE_MAX_SIZE && newSize > CACHE_MAX_SIZE)
+    {
+        // jemalloc extends large blocks in place when the next pages are free and moves huge ones by remapping
+        void *block = rallocx(ptr, newSize, MALLOCX_ALIGN(DEFAULT_MEMORY_ALIGNMENT));
+        if (block)
+            cache_account(self, (int64_t)newSize - (int64_t)size);
+        return block;
+    }
+    if (size <= CACHE_MAX_SIZE && newSize <= CACHE_MAX_SIZE && cache_class(size) == cache_class(newSize))
+    {
+        cache_account(self, (int64_t)newSize - (int64_t)size);
+        return ptr;
+    }
+    void *block = (xxmalloc)(newSize);
+    memcpy(block, ptr, size < newSize ? size : newSize);
+    (xxfree)(ptr, size);
+    return block;
+}
+
+void *xxmalloc_aligned(size_t alignment, size_t size)
+{
+    void *block = aligned_alloc(alignment, size);
+    if (block)
+        cache_account(cache_get(), (int64_t)size);
+    return block;
+}
+
+void xxfree_aligned(void *ptr, size_t size)
+{
+    if (!ptr)
+        return;
+    cache_account(cache_get(), -(int64_t)size);
     free(ptr);
 }
+
+size_t xxusage()
+{
+    pthread_mutex_lock(&cache_mutex);
+    int64_t usage = atomic_load(&cache_retired);
+    for (ThreadCache *it = cache_threads; it; it = it->next)
+        usage += atomic_load_explicit(&it->usage, memory_order_relaxed);
+    pthread_mutex_unlock(&cache_mutex);
+    return usage > 0 ? (size_t)usage : 0;
+}
+
+void xxtrim()
+{
+    cache_flush(cache_get());
+}
@@ -769,7 +769,7 @@ b2ChainId b2CreateChain(b2BodyId bodyId, const b2ChainDef* def)
 	else
 	{
 		chainShape->count = n - 3;
-		chainShape->shapeIndices = xxmalloc(n * sizeof(int32_t));
+		chainShape->shapeIndices = xxmalloc((n - 3) * sizeof(int32_t));
 
 		b2SmoothSegment smoothSegment;
 
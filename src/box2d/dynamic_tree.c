@@ -940,7 +940,8 @@ int32_t b2DynamicTree_GetMaxBalance(const b2DynamicTree* tree)
 
 void b2DynamicTree_RebuildBottomUp(b2DynamicTree* tree)
 {
-	int32_t* nodes = (int32_t*)xxmalloc(tree->nodeCount * sizeof(int32_t));
+	int32_t nodeCount = tree->nodeCount;
+	int32_t* nodes = (int32_t*)xxmalloc(nodeCount * sizeof(int32_t));
 	int32_t count = 0;
 
 	// Build array of leaves. Free the rest.
@@ -1009,7 +1010,7 @@ void b2DynamicTree_RebuildBottomUp(b2DynamicTree* tree)
 	}
 
 	tree->root = nodes[0];
-	xxfree(nodes, tree->nodeCount * sizeof(b2TreeNode));
+	xxfree(nodes, nodeCount * sizeof(int32_t));
 
 	b2DynamicTree_Validate(tree);
 }
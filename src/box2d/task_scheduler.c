@@ -0,0 +1,389 @@
+// SPDX-FileCopyrightText: 2023 Erin Catto
+// SPDX-License-Identifier: MIT
+
+#include "task_scheduler.h"
+
+#include "mem/mem.h"
+#include "core.h"
+
+#include <immintrin.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <string.h>
+#include <unistd.h>
+
+// Tasks in flight at once. Box2D enqueues at most a few tasks per worker per stage.
+#define b2_maxSchedulerTasks 256
+
+// Must be a power of two
+#define b2_dequeCapacity 256
+
+// A task is split into at most this many ranges per worker, subject to minRange.
+#define b2_rangesPerWorker 4
+
+// Idle iterations before a worker goes to sleep on the condition variable
+#define b2_workerSpinCount 4096
+
+typedef struct b2SchedulerTask
+{
+	b2TaskCallback* task;
+	void* taskContext;
+	_Atomic int32_t pendingCount;
+	int32_t nextFree;
+} b2SchedulerTask;
+
+typedef struct b2TaskRange
+{
+	b2SchedulerTask* task;
+	int32_t startIndex;
+	int32_t endIndex;
+} b2TaskRange;
+
+// The owner pushes and pops at the bottom (LIFO, cache warm), thieves take from the top (FIFO, oldest and
+// usually largest work). Critical sections are a few instructions so a spin lock is enough.
+typedef struct b2TaskDeque
+{
+	atomic_flag lock;
+	int32_t top;
+	int32_t bottom;
+	b2TaskRange ranges[b2_dequeCapacity];
+
+	// keep neighbouring deques off the same cache line
+	char padding[64];
+} b2TaskDeque;
+
+typedef struct b2WorkerInfo
+{
+	struct b2TaskScheduler* scheduler;
+	uint32_t workerIndex;
+} b2WorkerInfo;
+
+struct b2TaskScheduler
+{
+	b2TaskDeque* deques;
+	uint32_t workerCount;
+
+	pthread_t threads[b2_maxWorkers];
+	b2WorkerInfo workers[b2_maxWorkers];
+
+	b2SchedulerTask tasks[b2_maxSchedulerTasks];
+	int32_t freeTask;
+	atomic_flag taskLock;
+
+	// Number of ranges sitting in deques. Sleeping workers wait for this to become positive.
+	_Atomic int32_t queuedCount;
+	_Atomic bool shutdown;
+
+	pthread_mutex_t sleepMutex;
+	pthread_cond_t sleepCondition;
+};
+
+// Threads that are not owned by a scheduler act as worker 0
+static _Thread_local b2TaskScheduler* b2_currentScheduler = NULL;
+static _Thread_local uint32_t b2_currentWorker = 0;
+
+static inline uint32_t b2GetWorkerIndex(b2TaskScheduler* scheduler)
+{
+	return b2_currentScheduler == scheduler ? b2_currentWorker : 0;
+}
+
+static inline void b2Lock(atomic_flag* lock)
+{
+	while (atomic_flag_test_and_set_explicit(lock, memory_order_acquire))
+	{
+		_mm_pause();
+	}
+}
+
+static inline void b2Unlock(atomic_flag* lock)
+{
+	atomic_flag_clear_explicit(lock, memory_order_release);
+}
+
+static bool b2PushRange(b2TaskDeque* deque, b2TaskRange range)
+{
+	bool pushed = false;
+	b2Lock(&deque->lock);
+	if (deque->bottom - deque->top < b2_dequeCapacity)
+	{
+		deque->ranges[deque->bottom & (b2_dequeCapacity - 1)] = range;
+		deque->bottom += 1;
+		pushed = true;
+	}
+	b2Unlock(&deque->lock);
+	return pushed;
+}
+
+static bool b2PopRange(b2TaskDeque* deque, b2TaskRange* range)
+{
+	bool popped = false;
+	b2Lock(&deque->lock);
+	if (deque->bottom > deque->top)
+	{
+		deque->bottom -= 1;
+		*range = deque->ranges[deque->bottom & (b2_dequeCapacity - 1)];
+		popped = true;
+	}
+	b2Unlock(&deque->lock);
+	return popped;
+}
+
+static bool b2StealRange(b2TaskDeque* deque, b2TaskRange* range)
+{
+	bool stolen = false;
+	b2Lock(&deque->lock);
+	if (deque->bottom > deque->top)
+	{
+		*range = deque->ranges[deque->top & (b2_dequeCapacity - 1)];
+		deque->top += 1;
+		stolen = true;
+	}
+	b2Unlock(&deque->lock);
+	return stolen;
+}
+
+static bool b2ExecuteNextRange(b2TaskScheduler* scheduler, uint32_t workerIndex)
+{
+	if (atomic_load_explicit(&scheduler->queuedCount, memory_order_relaxed) <= 0)
+	{
+		return false;
+	}
+
+	b2TaskRange range;
+	bool found = b2PopRange(scheduler->deques + workerIndex, &range);
+
+	uint32_t workerCount = scheduler->workerCount;
+	for (uint32_t i = 1; i < workerCount && found == false; ++i)
+	{
+		uint32_t victim = (workerIndex + i) % workerCount;
+		found = b2StealRange(scheduler->deques + victim, &range);
+	}
+
+	if (found == false)
+	{
+		return false;
+	}
+
+	atomic_fetch_sub_explicit(&scheduler->queuedCount, 1, memory_order_relaxed);
+
+	b2SchedulerTask* task = range.task;
+	task->task(range.startIndex, range.endIndex, workerIndex, task->taskContext);
+	atomic_fetch_sub_explicit(&task->pendingCount, 1, memory_order_release);
+	return true;
+}
+
+static void* b2WorkerMain(void* arg)
+{
+	b2WorkerInfo* info = arg;
+	b2TaskScheduler* scheduler = info->scheduler;
+	uint32_t workerIndex = info->workerIndex;
+
+	b2_currentScheduler = scheduler;
+	b2_currentWorker = workerIndex;
+
+	int32_t idleCount = 0;
+	while (atomic_load_explicit(&scheduler->shutdown, memory_order_acquire) == false)
+	{
+		if (b2ExecuteNextRange(scheduler, workerIndex))
+		{
+			idleCount = 0;
+			continue;
+		}
+
+		if (idleCount < b2_workerSpinCount)
+		{
+			idleCount += 1;
+			_mm_pause();
+			continue;
+		}
+
+		// The queued count is re-checked under the mutex and producers broadcast under the same mutex,
+		// so a wake up cannot be lost between the check and the wait.
+		pthread_mutex_lock(&scheduler->sleepMutex);
+		while (atomic_load(&scheduler->queuedCount) <= 0 && atomic_load(&scheduler->shutdown) == false)
+		{
+			pthread_cond_wait(&scheduler->sleepCondition, &scheduler->sleepMutex);
+		}
+		pthread_mutex_unlock(&scheduler->sleepMutex);
+		idleCount = 0;
+	}
+
+	return NULL;
+}
+
+static b2SchedulerTask* b2AllocateTask(b2TaskScheduler* scheduler)
+{
+	b2Lock(&scheduler->taskLock);
+	b2SchedulerTask* task = NULL;
+	if (scheduler->freeTask != B2_NULL_INDEX)
+	{
+		task = scheduler->tasks + scheduler->freeTask;
+		scheduler->freeTask = task->nextFree;
+		task->nextFree = B2_NULL_INDEX;
+	}
+	b2Unlock(&scheduler->taskLock);
+	return task;
+}
+
+static void b2FreeTask(b2TaskScheduler* scheduler, b2SchedulerTask* task)
+{
+	b2Lock(&scheduler->taskLock);
+	task->nextFree = scheduler->freeTask;
+	scheduler->freeTask = (int32_t)(task - scheduler->tasks);
+	b2Unlock(&scheduler->taskLock);
+}
+
+b2TaskScheduler* b2CreateTaskScheduler(uint32_t workerCount)
+{
+	if (workerCount == 0)
+	{
+		long coreCount = sysconf(_SC_NPROCESSORS_ONLN);
+		workerCount = coreCount > 0 ? (uint32_t)coreCount : 1;
+	}
+
+	if (workerCount > b2_maxWorkers)
+	{
+		workerCount = b2_maxWorkers;
+	}
+
+	b2TaskScheduler* scheduler = xxmalloc(sizeof(b2TaskScheduler));
+	memset(scheduler, 0, sizeof(b2TaskScheduler));
+
+	scheduler->workerCount = workerCount;
+	scheduler->deques = xxmalloc(workerCount * sizeof(b2TaskDeque));
+	memset(scheduler->deques, 0, workerCount * sizeof(b2TaskDeque));
+	for (uint32_t i = 0; i < workerCount; ++i)
+	{
+		atomic_flag_clear(&scheduler->deques[i].lock);
+	}
+
+	for (int32_t i = 0; i < b2_maxSchedulerTasks; ++i)
+	{
+		scheduler->tasks[i].nextFree = i + 1 < b2_maxSchedulerTasks ? i + 1 : B2_NULL_INDEX;
+	}
+	scheduler->freeTask = 0;
+	atomic_flag_clear(&scheduler->taskLock);
+
+	atomic_store(&scheduler->queuedCount, 0);
+	atomic_store(&scheduler->shutdown, false);
+	pthread_mutex_init(&scheduler->sleepMutex, NULL);
+	pthread_cond_init(&scheduler->sleepCondition, NULL);
+
+	// Worker 0 is whichever thread finishes tasks, usually the main thread
+	for (uint32_t i = 1; i < workerCount; ++i)
+	{
+		scheduler->workers[i].scheduler = scheduler;
+		scheduler->workers[i].workerIndex = i;
+		pthread_create(scheduler->threads + i, NULL, b2WorkerMain, scheduler->workers + i);
+	}
+
+	return scheduler;
+}
+
+void b2DestroyTaskScheduler(b2TaskScheduler* scheduler)
+{
+	pthread_mutex_lock(&scheduler->sleepMutex);
+	atomic_store(&scheduler->shutdown, true);
+	pthread_cond_broadcast(&scheduler->sleepCondition);
+	pthread_mutex_unlock(&scheduler->sleepMutex);
+
+	for (uint32_t i = 1; i < scheduler->workerCount; ++i)
+	{
+		pthread_join(scheduler->threads[i], NULL);
+	}
+
+	pthread_cond_destroy(&scheduler->sleepCondition);
+	pthread_mutex_destroy(&scheduler->sleepMutex);
+
+	xxfree(scheduler->deques, scheduler->workerCount * sizeof(b2TaskDeque));
+	xxfree(scheduler, sizeof(b2TaskScheduler));
+}
+
+uint32_t b2TaskScheduler_GetWorkerCount(const b2TaskScheduler* scheduler)
+{
+	return scheduler->workerCount;
+}
+
+void* b2EnqueueSchedulerTask(b2TaskCallback* task, int32_t itemCount, int32_t minRange, void* taskContext,
+							 void* userContext)
+{
+	b2TaskScheduler* scheduler = userContext;
+	uint32_t workerIndex = b2GetWorkerIndex(scheduler);
+	uint32_t workerCount = scheduler->workerCount;
+
+	if (itemCount <= 0 || workerCount == 1)
+	{
+		task(0, itemCount, workerIndex, taskContext);
+		return NULL;
+	}
+
+	b2SchedulerTask* schedulerTask = b2AllocateTask(scheduler);
+	if (schedulerTask == NULL)
+	{
+		// Out of task slots, behave like the default single threaded callback
+		task(0, itemCount, workerIndex, taskContext);
+		return NULL;
+	}
+
+	minRange = minRange < 1 ? 1 : minRange;
+	int32_t rangeCount = itemCount / minRange;
+	int32_t maxRangeCount = (int32_t)(workerCount * b2_rangesPerWorker);
+	rangeCount = rangeCount < 1 ? 1 : (rangeCount > maxRangeCount ? maxRangeCount : rangeCount);
+
+	schedulerTask->task = task;
+	schedulerTask->taskContext = taskContext;
+	atomic_store_explicit(&schedulerTask->pendingCount, rangeCount, memory_order_relaxed);
+
+	// Spread ranges round robin starting with the caller so every worker finds local work first
+	int32_t rangeSize = itemCount / rangeCount;
+	int32_t remainder = itemCount - rangeSize * rangeCount;
+	int32_t startIndex = 0;
+	for (int32_t i = 0; i < rangeCount; ++i)
+	{
+		int32_t endIndex = startIndex + rangeSize + (i < remainder ? 1 : 0);
+		b2TaskRange range = {schedulerTask, startIndex, endIndex};
+		b2TaskDeque* deque = scheduler->deques + (workerIndex + (uint32_t)i) % workerCount;
+
+		if (b2PushRange(deque, range))
+		{
+			atomic_fetch_add_explicit(&scheduler->queuedCount, 1, memory_order_release);
+		}
+		else
+		{
+			task(startIndex, endIndex, workerIndex, taskContext);
+			atomic_fetch_sub_explicit(&schedulerTask->pendingCount, 1, memory_order_release);
+		}
+
+		startIndex = endIndex;
+	}
+
+	pthread_mutex_lock(&scheduler->sleepMutex);
+	pthread_cond_broadcast(&scheduler->sleepCondition);
+	pthread_mutex_unlock(&scheduler->sleepMutex);
+
+	return schedulerTask;
+}
+
+void b2FinishSchedulerTask(void* userTask, void* userContext)
+{
+	if (userTask == NULL)
+	{
+		return;
+	}
+
+	b2TaskScheduler* scheduler = userContext;
+	b2SchedulerTask* schedulerTask = userTask;
+	uint32_t workerIndex = b2GetWorkerIndex(scheduler);
+
+	// Help out instead of blocking. This is also what keeps nested waits from deadlocking.
+	while (atomic_load_explicit(&schedulerTask->pendingCount, memory_order_acquire) > 0)
+	{
+		if (b2ExecuteNextRange(scheduler, workerIndex) == false)
+		{
+			_mm_pause();
+		}
+	}
+
+	b2FreeTask(scheduler, schedulerTask);
+}
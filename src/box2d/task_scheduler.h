@@ -0,0 +1,30 @@
+// SPDX-FileCopyrightText: 2023 Erin Catto
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include "box2d/types.h"
+
+/// Work-stealing task system that plugs into b2WorldDef::enqueueTask and b2WorldDef::finishTask.
+/// Each worker owns a deque of task ranges. Workers pop their own deque from the bottom and steal
+/// from the top of other deques when they run dry. The thread that calls b2FinishSchedulerTask
+/// participates as worker 0 while it waits.
+typedef struct b2TaskScheduler b2TaskScheduler;
+
+/// Create a scheduler with workerCount workers including the calling thread, so workerCount - 1
+/// threads are spawned. A workerCount of 0 uses one worker per online core. Clamped to b2_maxWorkers.
+b2TaskScheduler* b2CreateTaskScheduler(uint32_t workerCount);
+
+/// Join the worker threads and release the scheduler.
+void b2DestroyTaskScheduler(b2TaskScheduler* scheduler);
+
+/// Number of workers including the calling thread. Use this for b2WorldDef::workerCount.
+uint32_t b2TaskScheduler_GetWorkerCount(const b2TaskScheduler* scheduler);
+
+/// b2EnqueueTaskCallback implementation. The user context must be the b2TaskScheduler.
+/// The item range is split into chunks of at least minRange items.
+void* b2EnqueueSchedulerTask(b2TaskCallback* task, int32_t itemCount, int32_t minRange, void* taskContext,
+							 void* userContext);
+
+/// b2FinishTaskCallback implementation. Executes pending work until the task completes.
+void b2FinishSchedulerTask(void* userTask, void* userContext);
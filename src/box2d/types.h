@@ -115,6 +115,10 @@ typedef struct b2WorldDef
 
 	/// User context that is provided to enqueueTask and finishTask
 	void *userTaskContext;
+
+	/// Use the built-in work-stealing scheduler when enqueueTask and finishTask are not provided.
+	/// A workerCount of 0 selects one worker per core. The world owns the scheduler.
+	bool enableTaskScheduler;
 } b2WorldDef;
 
 /// Use this to initialize your world definition
@@ -134,6 +138,7 @@ static const b2WorldDef b2_defaultWorldDef = {
 	NULL,						   // enqueueTask
 	NULL,						   // finishTask
 	NULL,						   // userTaskContext
+	false,						   // enableTaskScheduler
 };
 
 /// The body type.
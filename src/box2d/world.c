@@ -22,6 +22,7 @@
 #include "pool.h"
 #include "shape.h"
 #include "solver_data.h"
+#include "task_scheduler.h"
 
 // needed for dll export
 #include "box2d.h"
@@ -172,6 +173,14 @@ b2WorldId b2CreateWorld(const b2WorldDef* def)
 		world->finishTaskFcn = def->finishTask;
 		world->userTaskContext = def->userTaskContext;
 	}
+	else if (def->enableTaskScheduler)
+	{
+		world->taskScheduler = b2CreateTaskScheduler(def->workerCount);
+		world->workerCount = b2TaskScheduler_GetWorkerCount(world->taskScheduler);
+		world->enqueueTaskFcn = b2EnqueueSchedulerTask;
+		world->finishTaskFcn = b2FinishSchedulerTask;
+		world->userTaskContext = world->taskScheduler;
+	}
 	else
 	{
 		world->workerCount = 1;
@@ -239,6 +248,11 @@ void b2DestroyWorld(b2WorldId id)
 	b2DestroyBlockAllocator(world->blockAllocator);
 	b2DestroyStackAllocator(world->stackAllocator);
 
+	if (world->taskScheduler != NULL)
+	{
+		b2DestroyTaskScheduler(world->taskScheduler);
+	}
+
 	*world = (b2World){0};
 }
 
@@ -111,6 +111,9 @@ typedef struct b2World
 	b2FinishTaskCallback* finishTaskFcn;
 	void* userTaskContext;
 
+	// Built-in scheduler owned by this world, NULL when the user supplies task callbacks
+	struct b2TaskScheduler* taskScheduler;
+
 	void* userTreeTask;
 
 	int32_t splitIslandIndex;
@@ -1,20 +1,50 @@
 #include "atlas.h"
 
-#include <pthread.h>
+#include <string.h>
+#include <stdio.h>
 #include "mem/alloc.h"
 
 #include "file.h"
+#include "loader.h"
 #include "stb_image.h"
 
 #include "glad.h"
 
-make_fastmap_directives(StrTexId, const char *, TextureId, adt_compare_cstr, adt_hashof_cstr);
+#define STBRP_STATIC
+#define STB_RECT_PACK_IMPLEMENTATION
+#include "gui/imstb_rectpack.h"
+
+// images are packed into square pages of a few layers each, one that does not fit a layer gets a page of its own
+#define ATLAS_PAGE_SIZE 1024
+#define ATLAS_PAGE_LAYERS 4
+// transparent gutter around every image, it stands in for the clamp to border of separate textures and
+// keeps neighbours from bleeding into each other down to the last mip level
+#define ATLAS_PADDING 4
+#define ATLAS_MAX_LEVEL 2
+// checker shown by textures whose image is still loading
+#define ATLAS_PLACEHOLDER_SIZE 2
+
+typedef struct
+{
+    uint32_t gid;
+    int width;
+    int height;
+    int layers;
+    // null for a page holding a single oversized image
+    stbrp_context *packers;
+    stbrp_node *nodes;
+} AtlasPage;
+
+make_fastmap_directives(AtomTexId, Atom, TextureId, adt_compare_primitive, adt_hashof_atom);
 make_fastvec_directives(Tex, Texture);
+make_fastvec_directives(AtlasPage, AtlasPage);
 
 typedef struct
 {
-    Fastmap_StrTexId *indices;
+    Fastmap_AtomTexId *indices;
     Fastvec_Tex *textures;
+    Fastvec_AtlasPage *pages;
+    uint32_t placeholder;
 } AtlasContext;
 
 static AtlasContext *self;
@@ -22,30 +52,132 @@ static AtlasContext *self;
 void atlas_init()
 {
     self = (AtlasContext *)xxarena(sizeof(AtlasContext));
-    self->indices = fastmap_StrTexId_init();
+    self->indices = fastmap_AtomTexId_init();
     self->textures = fastvec_Tex_init(2);
+    self->pages = fastvec_AtlasPage_init(2);
+
+    const uint32_t checker[] = {0xFFFF00FF, 0xFF000000, 0xFF000000, 0xFFFF00FF};
+    glGenTextures(1, &self->placeholder);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, self->placeholder);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_RGBA8, ATLAS_PLACEHOLDER_SIZE, ATLAS_PLACEHOLDER_SIZE, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, checker);
 }
 
-Texture *atlas_load(const char *name, const char *p)
+static AtlasPage atlas_page_create(int width, int height, int layers, bool packed)
 {
-    FastmapNode_StrTexId *node = fastmap_StrTexId_get(self->indices, name);
-    if (node != NULL)
-        return &self->textures->vector[node->value];
-    Texture tex;
-    tex.name = name;
+    AtlasPage page = {0, width, height, layers, NULL, NULL};
+    glGenTextures(1, &page.gid);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, page.gid);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_RGBA8, width, height, layers, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+    if (!packed)
+        return page;
 
-    int width, height;
-    StrView path = resolve_stack(p);
-    uint8_t *data = stbi_load(path.string, &width, &height, &tex.channels, 0);
-    xxfreestack(path.string);
-    if (data == NULL)
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAX_LEVEL, ATLAS_MAX_LEVEL);
+    // new storage is undefined, the gutters have to read as transparent
+    size_t bytes = (size_t)width * height * 4;
+    void *zero = xxmalloc(bytes);
+    memset(zero, 0, bytes);
+    for (int i = 0; i < layers; i++)
+        glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, 0, 0, i, width, height, 1, GL_RGBA, GL_UNSIGNED_BYTE, zero);
+    xxfree(zero, bytes);
+
+    page.packers = (stbrp_context *)xxmalloc(sizeof(stbrp_context) * layers);
+    page.nodes = (stbrp_node *)xxmalloc(sizeof(stbrp_node) * width * layers);
+    for (int i = 0; i < layers; i++)
+    {
+        stbrp_init_target(&page.packers[i], width, height, &page.nodes[i * width], width);
+        stbrp_setup_heuristic(&page.packers[i], STBRP_HEURISTIC_Skyline_default);
+    }
+    return page;
+}
+
+static void atlas_page_destroy(AtlasPage *page)
+{
+    glDeleteTextures(1, &page->gid);
+    if (page->packers == NULL)
+        return;
+    xxfree(page->packers, sizeof(stbrp_context) * page->layers);
+    xxfree(page->nodes, sizeof(stbrp_node) * page->width * page->layers);
+}
+
+// finds room for an image in the existing pages, opening a new page when none has it
+static void atlas_place(Texture *tex, int width, int height, int *x, int *y)
+{
+    // sizes rounded to the mip block keep every image aligned on the texels of the coarsest level
+    const int block = 1 << ATLAS_MAX_LEVEL;
+    stbrp_rect r = {0};
+    r.w = (width + ATLAS_PADDING * 2 + block - 1) & ~(block - 1);
+    r.h = (height + ATLAS_PADDING * 2 + block - 1) & ~(block - 1);
+
+    if (r.w > ATLAS_PAGE_SIZE || r.h > ATLAS_PAGE_SIZE)
+    {
+        AtlasPage page = atlas_page_create(width, height, 1, false);
+        fastvec_AtlasPage_push(self->pages, page);
+        tex->page = self->pages->length - 1;
+        tex->layer = 0;
+        *x = *y = 0;
+        return;
+    }
+
+    for (int i = 0; i <= self->pages->length; i++)
+    {
+        if (i == self->pages->length)
+            fastvec_AtlasPage_push(self->pages, atlas_page_create(ATLAS_PAGE_SIZE, ATLAS_PAGE_SIZE, ATLAS_PAGE_LAYERS, true));
+        AtlasPage *page = &self->pages->vector[i];
+        if (page->packers == NULL)
+            continue;
+        for (int j = 0; j < page->layers; j++)
+        {
+            if (!stbrp_pack_rects(&page->packers[j], &r, 1))
+                continue;
+            tex->page = i;
+            tex->layer = j;
+            *x = r.x + ATLAS_PADDING;
+            *y = r.y + ATLAS_PADDING;
+            return;
+        }
+    }
+}
+
+typedef struct
+{
+    int width;
+    int height;
+    int channels;
+    uint8_t *data;
+} AtlasImage;
+
+static void *atlas_decode(const char *path, size_t *bytes)
+{
+    AtlasImage image;
+    image.data = stbi_load(path, &image.width, &image.height, &image.channels, 0);
+    if (image.data == NULL)
         return NULL;
+    AtlasImage *out = (AtlasImage *)xxmalloc(sizeof(AtlasImage));
+    *out = image;
+    *bytes = (size_t)image.width * image.height * image.channels;
+    return out;
+}
+
+static void atlas_release(void *data)
+{
+    AtlasImage *image = (AtlasImage *)data;
+    stbi_image_free(image->data);
+    xxfree(image, sizeof(AtlasImage));
+}
 
-    tex.size.x = (float)width;
-    tex.size.y = (float)height;
-    tex.ratio = vec2_ratio(tex.size);
+// packs a decoded image into a page and points the texture at it, false for unsupported formats
+static bool atlas_store(Texture *tex, const AtlasImage *image)
+{
     GLenum type = 0;
-    switch (tex.channels)
+    switch (image->channels)
     {
     case 3:
         type = GL_RGB;
@@ -54,31 +186,127 @@ Texture *atlas_load(const char *name, const char *p)
         type = GL_RGBA;
         break;
     default:
-        stbi_image_free(data);
-        return NULL;
+        return false;
+    }
+
+    int x = 0, y = 0;
+    atlas_place(tex, image->width, image->height, &x, &y);
+    AtlasPage *page = &self->pages->vector[tex->page];
+    tex->channels = image->channels;
+    tex->size = vec2(image->width, image->height);
+    tex->ratio = vec2_ratio(tex->size);
+    tex->gid = page->gid;
+    tex->pageSize = vec2(page->width, page->height);
+    tex->uv = rect(x / tex->pageSize.x, y / tex->pageSize.y, image->width / tex->pageSize.x, image->height / tex->pageSize.y);
+
+    glBindTexture(GL_TEXTURE_2D_ARRAY, page->gid);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, x, y, tex->layer, image->width, image->height, 1, type, GL_UNSIGNED_BYTE, image->data);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    glGenerateMipmap(GL_TEXTURE_2D_ARRAY);
+    tex->ready = true;
+    tex->ticket = LOAD_NONE;
+    return true;
+}
+
+static void atlas_upload(int32_t target, void *data)
+{
+    Texture *tex = &self->textures->vector[target];
+    // a failed load keeps showing the placeholder
+    if (data == NULL || !atlas_store(tex, (AtlasImage *)data))
+    {
+        printf("atlas: failed to load %s\n", tex->name);
+        tex->ready = true;
+        tex->ticket = LOAD_NONE;
     }
+}
 
-    glGenTextures(1, &tex.gid);
-    glBindTexture(GL_TEXTURE_2D, tex.gid);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, (GLsizei)tex.size.x, (GLsizei)tex.size.y, 0, type, GL_UNSIGNED_BYTE, data);
-    glGenerateMipmap(GL_TEXTURE_2D);
-    //
-    stbi_image_free(data);
-    // map
-    tex.id = self->indices->length;
+static const LoadHandler atlas_handler = {atlas_decode, atlas_upload, atlas_release};
+
+// a new entry that samples the placeholder until its image is stored
+static Texture *atlas_entry(Atom atom)
+{
+    Texture tex;
+    tex.id = self->textures->length;
+    tex.gid = self->placeholder;
+    tex.page = UINT32_MAX;
+    tex.layer = 0;
+    tex.uv = rect(0, 0, 1, 1);
+    tex.pageSize = vec2(ATLAS_PLACEHOLDER_SIZE, ATLAS_PLACEHOLDER_SIZE);
+    tex.atom = atom;
+    tex.name = cstr(atom_str(atom));
+    tex.channels = 4;
+    tex.size = tex.pageSize;
+    tex.ratio = 1;
+    tex.ready = false;
+    tex.ticket = LOAD_NONE;
     fastvec_Tex_push(self->textures, tex);
-    node = fastmap_StrTexId_put(self->indices, name);
+    FastmapNode_AtomTexId *node = fastmap_AtomTexId_put(self->indices, atom);
     node->value = tex.id;
     return &self->textures->vector[tex.id];
 }
 
+Texture *atlas_load(const char *name, const char *p)
+{
+    Atom atom = atom_intern_cstr(name);
+    FastmapNode_AtomTexId *node = fastmap_AtomTexId_get(self->indices, atom);
+    if (node != NULL)
+    {
+        atlas_wait(node->value);
+        return &self->textures->vector[node->value];
+    }
+
+    size_t bytes;
+    StrView path = resolve_stack(p);
+    AtlasImage *image = (AtlasImage *)atlas_decode(path.string, &bytes);
+    xxfreestack(path.string);
+    if (image == NULL)
+        return NULL;
+    if (image->channels != 3 && image->channels != 4)
+    {
+        atlas_release(image);
+        return NULL;
+    }
+    Texture *tex = atlas_entry(atom);
+    atlas_store(tex, image);
+    atlas_release(image);
+    return tex;
+}
+
+TextureId atlas_request(const char *name, const char *p)
+{
+    Atom atom = atom_intern_cstr(name);
+    FastmapNode_AtomTexId *node = fastmap_AtomTexId_get(self->indices, atom);
+    if (node != NULL)
+        return node->value;
+    TextureId id = atlas_entry(atom)->id;
+    LoadTicket ticket = loader_request(&atlas_handler, p, id);
+    // the loader may have stored it already when it had to decode in place
+    Texture *tex = &self->textures->vector[id];
+    if (!tex->ready)
+        tex->ticket = ticket;
+    return id;
+}
+
+bool atlas_is_ready(TextureId id)
+{
+    return atlas_has(id) && self->textures->vector[id].ready;
+}
+
+void atlas_wait(TextureId id)
+{
+    if (atlas_has(id) && !self->textures->vector[id].ready)
+        loader_wait(self->textures->vector[id].ticket);
+}
+
 Texture *atlas_get_byname(const char *name)
 {
-    FastmapNode_StrTexId *node = fastmap_StrTexId_get(self->indices, name);
+    return atlas_get_byatom(atom_find_cstr(name));
+}
+
+Texture *atlas_get_byatom(Atom atom)
+{
+    FastmapNode_AtomTexId *node = fastmap_AtomTexId_get(self->indices, atom);
     if (node == NULL)
         return NULL;
 
@@ -99,18 +327,31 @@ void atlas_clear()
 {
     for (int i = 0; i < self->textures->length; i++)
     {
-        glDeleteTextures(1, &self->textures->vector[i].gid);
+        if (!self->textures->vector[i].ready)
+            loader_cancel(self->textures->vector[i].ticket);
+    }
+    for (int i = 0; i < self->pages->length; i++)
+    {
+        atlas_page_destroy(&self->pages->vector[i]);
     }
+    fastvec_AtlasPage_clear(self->pages);
     fastvec_Tex_clear(self->textures);
-    fastmap_StrTexId_clear(self->indices);
+    fastmap_AtomTexId_clear(self->indices);
 }
 
 void atlas_destroy()
 {
     for (int i = 0; i < self->textures->length; i++)
     {
-        glDeleteTextures(1, &self->textures->vector[i].gid);
+        if (!self->textures->vector[i].ready)
+            loader_cancel(self->textures->vector[i].ticket);
+    }
+    glDeleteTextures(1, &self->placeholder);
+    for (int i = 0; i < self->pages->length; i++)
+    {
+        atlas_page_destroy(&self->pages->vector[i]);
     }
-    fastmap_StrTexId_destroy(self->indices);
+    fastmap_AtomTexId_destroy(self->indices);
     fastvec_Tex_destroy(self->textures);
+    fastvec_AtlasPage_destroy(self->pages);
 }
@@ -3,30 +3,63 @@
 
 
 #include "math/vec2.h"
+#include "math/rect.h"
 #include "adt/murmur.h"
 #include "adt/fastmap.h"
 #include "adt/fastvec.h"
 #include "adt/common.h"
+#include "loader.h"
 
 typedef int32_t TextureId;
 
+// images are packed into the layers of shared array textures, gid is the array texture of the page
+// holding the image and uv its normalized placement inside the layer
 typedef struct
 {
     TextureId id;
     uint32_t gid;
+    uint32_t page;
+    uint32_t layer;
+    Rect uv;
+    Vec2 pageSize;
+    Atom atom;
     const char *name;
     int channels;
     Vec2 size;
     float ratio;
+    // false while the image loads, the entry samples a placeholder until then
+    bool ready;
+    LoadTicket ticket;
 } Texture;
 
+// uv rect of a pixel area of the image inside its page layer, an empty area selects the whole image
+static inline Rect atlas_crop(const Texture *tex, Rect area)
+{
+    if (area.c == 0 || area.d == 0)
+        return tex->uv;
+    return rect(tex->uv.a + area.a / tex->pageSize.x,
+                tex->uv.b + area.b / tex->pageSize.y,
+                area.c / tex->pageSize.x,
+                area.d / tex->pageSize.y);
+}
+
 
 void atlas_init();
 
+// loads and packs the image before returning
 Texture *atlas_load(const char *name, const char *p);
 
+// queues the image on the loader, the id resolves to a placeholder right away and is filled in once uploaded
+TextureId atlas_request(const char *name, const char *p);
+
+bool atlas_is_ready(TextureId id);
+
+void atlas_wait(TextureId id);
+
 Texture *atlas_get_byname(const char *name);
 
+Texture *atlas_get_byatom(Atom atom);
+
 Texture *atlas_get(TextureId id);
 
 bool atlas_has(TextureId id);
@@ -1,7 +1,23 @@
 #include "camera.h"
 
+#define GLFW_INCLUDE_NONE
+#include <GLFW/glfw3.h>
+#include "glad.h"
+
+#include "shader.h"
+
+// std140 layout of the Camera block, mat4 members need no padding
+typedef struct
+{
+    Mat4 projection;
+    Mat4 view;
+    Mat4 view_projection;
+} CameraBlock;
+
 Camera *camera;
 
+static uint32_t cameraUbo = 0;
+
 void camera_update()
 {
     if (!(camera->ortho & VIEW_ORTHOGRAPHIC))
@@ -18,11 +34,20 @@ void camera_update()
         camera->view = mat4_view(camera->position, r);
     }
     camera->view_projection = mat4_mul(camera->view, camera->projection);
+
+    CameraBlock block = {camera->projection, camera->view, camera->view_projection};
+    glBindBuffer(GL_UNIFORM_BUFFER, cameraUbo);
+    glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(CameraBlock), &block);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
 }
 
 void camera_init()
 {
     camera = (Camera *)xxarena(sizeof(Camera));
+    glGenBuffers(1, &cameraUbo);
+    glBindBuffer(GL_UNIFORM_BUFFER, cameraUbo);
+    glBufferData(GL_UNIFORM_BUFFER, sizeof(CameraBlock), NULL, GL_DYNAMIC_DRAW);
+    glBindBufferBase(GL_UNIFORM_BUFFER, SHADER_CAMERA_BINDING, cameraUbo);
     camera->rotation = rot(-30, 180, 0);
     camera->far_plane = 5000;
     camera->zoom = 100.0f;
@@ -34,6 +59,12 @@ void camera_init()
     camera_update();
 }
 
+void camera_destroy()
+{
+    glDeleteBuffers(1, &cameraUbo);
+    cameraUbo = 0;
+}
+
 Vec2 camera_worldToScreen(Vec3 p)
 {
     Vec4 r = mat4_mulv4(camera->view_projection, vec4(p.x, p.y, p.z, 1));
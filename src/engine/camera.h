@@ -40,8 +40,10 @@ typedef struct
 
 extern Camera *camera;
 
+// also uploads the matrices to the shared Camera uniform block
 void camera_update();
 void camera_init();
+void camera_destroy();
 Vec2 camera_worldToScreen(Vec3 p);
 Ray camera_screenToWorld(Vec2 s);
 
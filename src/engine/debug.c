@@ -6,10 +6,14 @@
 
 #include "mem/alloc.h"
 #include "mem/defs.h"
+#include "adt/fastvec.h"
+#include "adt/fastmap.h"
+#include "adt/common.h"
 
 #include "game.h"
 #include "shader.h"
 #include "camera.h"
+#include "render.h"
 #include "file.h"
 #include "glad.h"
 #include "stb_image.h"
@@ -18,11 +22,36 @@ typedef struct
 {
     Vec3 position;
     Vec2 coord;
-} VertexData;
+    Color color;
+} GlyphVertex;
+
+// a laid out string, four vertices per glyph starting at first
+typedef struct
+{
+    uint32_t first;
+    uint32_t count;
+} GlyphRun;
+
+make_fastvec_directives(GlyphVertex, GlyphVertex);
+make_fastmap_directives(GlyphRun, uint64_t, GlyphRun, adt_compare_primitive, adt_hashof_primitive);
+
+// glyph quads of every string of one kind, drawn with a single call. the previous frame is
+// kept so a string with the same text, transform and color is copied instead of laid out again
+typedef struct
+{
+    Fastvec_GlyphVertex *vertices[2];
+    Fastmap_GlyphRun *runs[2];
+    int frame;
+
+    // local quad edges of one cell, along the line and down to the next line
+    Vec3 advance;
+    Vec3 down;
+    // horizontal uv inset, the font cells are square but glyph quads are narrow
+    float inset;
+} GlyphLayer;
 
 enum
 {
-    max_space = 100 * KILOBYTES,
     max_elements = 4096,
 };
 
@@ -52,9 +81,16 @@ typedef struct
 typedef struct
 {
     Shader shader;
-    GLuint vaoIds[2];
-    GLuint vboIds[2];
-    GLuint eboIds[2];
+    int projectionLocation;
+    int viewLocation;
+    GLuint vao;
+    GLuint vbo;
+    GLuint ebo;
+    // quads the index buffer covers
+    int quadCapacity;
+
+    GlyphLayer layer2d;
+    GlyphLayer layer3d;
 
     Text2DData data2d[max_elements];
     Text3DData data3d[max_elements];
@@ -73,81 +109,189 @@ typedef struct
 
     char enabled;
 
-    ArenaMemory *arena;
-
 } DrawData;
 
 static DrawData *debugData;
 
+// one text layer, executed from the render queue
+typedef struct
+{
+    Mat4 projection;
+    Mat4 view;
+    int minFilter;
+    int quads;
+    int baseVertex;
+} GlyphDraw;
+
+static void glyph_layer_init(GlyphLayer *layer, Vec3 advance, Vec3 down, float inset)
+{
+    for (int i = 0; i < 2; i++)
+    {
+        layer->vertices[i] = fastvec_GlyphVertex_init(1024);
+        layer->runs[i] = fastmap_GlyphRun_init();
+    }
+    layer->frame = 0;
+    layer->advance = advance;
+    layer->down = down;
+    layer->inset = inset;
+}
+
+static void glyph_layer_destroy(GlyphLayer *layer)
+{
+    for (int i = 0; i < 2; i++)
+    {
+        fastvec_GlyphVertex_destroy(layer->vertices[i]);
+        fastmap_GlyphRun_destroy(layer->runs[i]);
+    }
+}
+
+// the frame just drawn becomes the cache for the next one
+static void glyph_layer_swap(GlyphLayer *layer)
+{
+    layer->frame ^= 1;
+    fastvec_GlyphVertex_clear(layer->vertices[layer->frame]);
+    fastmap_GlyphRun_clear(layer->runs[layer->frame]);
+}
+
+static void glyph_layout(GlyphLayer *layer, Mat4 world, Vec2 origin, Color color, const char *text)
+{
+    Fastvec_GlyphVertex *out = layer->vertices[layer->frame];
+    int length = (int)strlen(text);
+
+    struct
+    {
+        Mat4 world;
+        Vec2 origin;
+        Color color;
+    } params = {world, origin, color};
+    uint64_t key = hash64(text, length, hash64(&params, sizeof(params), 0));
+
+    FastmapNode_GlyphRun *cached = fastmap_GlyphRun_get(layer->runs[layer->frame ^ 1], key);
+    if (cached)
+    {
+        GlyphRun run = {(uint32_t)out->length, cached->value.count};
+        fastvec_GlyphVertex_push_n(out, layer->vertices[layer->frame ^ 1]->vector + cached->value.first, run.count);
+        fastmap_GlyphRun_put(layer->runs[layer->frame], key)->value = run;
+        return;
+    }
+
+    int cols = 0, rows = 1, col = 0, glyphs = 0;
+    for (int i = 0; i < length; i++)
+    {
+        if (text[i] == '\n')
+        {
+            rows++;
+            col = 0;
+            continue;
+        }
+        glyphs++;
+        if (++col > cols)
+            cols = col;
+    }
+
+    // the transform is affine, so glyph corners are the origin plus multiples of the two cell edges
+    Vec3 o = mat4_mulv3(world, vec3_zero, 1);
+    Vec3 a = mat4_mulv3(world, layer->advance, 0);
+    Vec3 d = mat4_mulv3(world, layer->down, 0);
+    float c0 = -cols * origin.x;
+    float r = -rows * origin.y;
+    float c = c0;
+
+    GlyphRun run = {(uint32_t)out->length, (uint32_t)glyphs * 4};
+    fastvec_GlyphVertex_resize(out, out->length + run.count);
+    GlyphVertex *v = out->vector + run.first;
+    const float p = 1 / 16.0f;
+    for (int i = 0; i < length; i++)
+    {
+        unsigned char ch = (unsigned char)text[i];
+        if (ch == '\n')
+        {
+            c = c0;
+            r += 1;
+            continue;
+        }
+        Vec3 base = vec3_add(o, vec3_add(vec3_mulf(a, c), vec3_mulf(d, r)));
+        float u0 = ((ch % 16) + layer->inset) * p;
+        float u1 = ((ch % 16) + 1 - layer->inset) * p;
+        float v0 = (ch / 16) * p;
+        float v1 = v0 + p;
+        v[0] = (GlyphVertex){base, vec2(u0, v0), color};
+        v[1] = (GlyphVertex){vec3_add(base, a), vec2(u1, v0), color};
+        v[2] = (GlyphVertex){vec3_add(base, vec3_add(a, d)), vec2(u1, v1), color};
+        v[3] = (GlyphVertex){vec3_add(base, d), vec2(u0, v1), color};
+        v += 4;
+        c += 1;
+    }
+    fastmap_GlyphRun_put(layer->runs[layer->frame], key)->value = run;
+}
+
+// every quad uses the same six index pattern, so the buffer is only rebuilt when it has to grow
+static void glyph_indices(int quads)
+{
+    if (quads <= debugData->quadCapacity)
+        return;
+    int capacity = debugData->quadCapacity > 256 ? debugData->quadCapacity : 256;
+    while (capacity < quads)
+        capacity <<= 1;
+    size_t size = capacity * 6 * sizeof(uint32_t);
+    uint32_t *indices = (uint32_t *)xxmalloc(size);
+    for (int i = 0; i < capacity; i++)
+    {
+        uint32_t *it = indices + i * 6;
+        uint32_t q = i * 4;
+        it[0] = q;
+        it[1] = q + 1;
+        it[2] = q + 3;
+        it[3] = q + 1;
+        it[4] = q + 2;
+        it[5] = q + 3;
+    }
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, size, indices, GL_STATIC_DRAW);
+    xxfree(indices, size);
+    debugData->quadCapacity = capacity;
+}
+
 void debug_init()
 {
     debugData = (DrawData *)xxarena(sizeof(DrawData));
     memset(debugData, 0, sizeof(DrawData));
 
-    debugData->arena = make_arena_raw(xxarena(max_space), max_space);
-
     debugData->enabled = 1;
     debugData->origin = vec2_zero;
     debugData->color = color_white;
     debugData->scale = 1.0f;
     debugData->rotation = rot_zero;
     debugData->shader = shader_load("shaders/debug.vs", "shaders/debug.fs");
-
-    // vao
-    glGenVertexArrays(2, debugData->vaoIds);
-    glGenBuffers(2, debugData->vboIds);
-    glGenBuffers(2, debugData->eboIds);
+    debugData->projectionLocation = shader_location(debugData->shader, "projection");
+    debugData->viewLocation = shader_location(debugData->shader, "view");
+
+    glGenVertexArrays(1, &debugData->vao);
+    glGenBuffers(1, &debugData->vbo);
+    glGenBuffers(1, &debugData->ebo);
+
+    glBindVertexArray(debugData->vao);
+    glBindBuffer(GL_ARRAY_BUFFER, debugData->vbo);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, debugData->ebo);
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(GlyphVertex), (void *)offsetof(GlyphVertex, position));
+    glEnableVertexAttribArray(1);
+    glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, sizeof(GlyphVertex), (void *)offsetof(GlyphVertex, coord));
+    glEnableVertexAttribArray(2);
+    glVertexAttribPointer(2, 4, GL_FLOAT, GL_FALSE, sizeof(GlyphVertex), (void *)offsetof(GlyphVertex, color));
+    glBindVertexArray(0);
 
     {
         float w = 8.0f;
         float h = 24.0f;
         debugData->bound2d = vec2(w, h);
-        float offset = (h - w) / (h * 2.0f);
-        VertexData vertices[] = {
-            {vec3(0, 0, 0), vec2(offset, 0)},
-            {vec3(w, 0, 0), vec2(1 - offset, 0)},
-            {vec3(w, h, 0), vec2(1 - offset, 1)},
-            {vec3(0, h, 0), vec2(offset, 1)},
-        };
-        unsigned int indices[] = {0, 1, 3, 1, 2, 3};
-
-        glBindVertexArray(debugData->vaoIds[1]);
-        glBindBuffer(GL_ARRAY_BUFFER, debugData->vboIds[1]);
-        glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
-
-        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, debugData->eboIds[1]);
-        glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(indices), indices, GL_STATIC_DRAW);
-
-        glEnableVertexAttribArray(0);
-        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(VertexData), (void *)offsetof(VertexData, position));
-        glEnableVertexAttribArray(1);
-        glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, sizeof(VertexData), (void *)offsetof(VertexData, coord));
+        glyph_layer_init(&debugData->layer2d, vec3(w, 0, 0), vec3(0, h, 0), (h - w) / (h * 2.0f));
     }
 
     {
         float w = 2.5f;
         float h = 8.0f;
         debugData->bound3d = vec2(w, h);
-        float offset = (h - w) / (h * 2.0f);
-        VertexData vertices[] = {
-            {vec3(0, 0, 0), vec2(offset, 0)},
-            {vec3(0, -w, 0), vec2(1 - offset, 0)},
-            {vec3(0, -w, -h), vec2(1 - offset, 1)},
-            {vec3(0, 0, -h), vec2(offset, 1)},
-        };
-        unsigned int indices[] = {0, 1, 3, 1, 2, 3};
-
-        glBindVertexArray(debugData->vaoIds[0]);
-        glBindBuffer(GL_ARRAY_BUFFER, debugData->vboIds[0]);
-        glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
-
-        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, debugData->eboIds[0]);
-        glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(indices), indices, GL_STATIC_DRAW);
-
-        glEnableVertexAttribArray(0);
-        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(VertexData), (void *)offsetof(VertexData, position));
-        glEnableVertexAttribArray(1);
-        glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, sizeof(VertexData), (void *)offsetof(VertexData, coord));
+        glyph_layer_init(&debugData->layer3d, vec3(0, -w, 0), vec3(0, 0, -h), (h - w) / (h * 2.0f));
     }
 
     // texture
@@ -174,31 +318,23 @@ void debug_init()
     stbi_image_free(data);
 }
 
-static Vec2 calculateSpace(const char *str, Vec2 bound)
+static void glyph_execute(const void *data)
 {
-    Vec2 v = {0, 0};
-    Vec3 of = {0, 0, 0};
-    int i = 0;
-    while (*str != '\0')
-    {
-        if (*str == '\n')
-        {
-            of.x = 0;
-            of.y += bound.y;
-            str++;
-        }
-        of.x += bound.x;
-        str++;
-        i++;
-
-        if (of.x > v.x)
-            v.x = of.x;
-        if (of.y > v.y)
-            v.y = of.y;
-    }
-    if (i > 0)
-        v.y += bound.y;
-    return v;
+    const GlyphDraw *it = (const GlyphDraw *)data;
+
+    render_program(debugData->shader);
+    render_cull(false);
+    render_depth_test(true);
+    render_depth_func(GL_LESS);
+    render_blend(true);
+    render_blend_func(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    render_texture(0, debugData->fontTexture[0]);
+    render_texture_filter(debugData->fontTexture[0], it->minFilter, GL_LINEAR);
+    render_vao(debugData->vao);
+
+    shader_set_mat4(debugData->projectionLocation, &it->projection);
+    shader_set_mat4(debugData->viewLocation, &it->view);
+    render_draw_elements_base_vertex(GL_TRIANGLES, it->quads * 6, GL_UNSIGNED_INT, 0, it->baseVertex);
 }
 
 void debug_render()
@@ -209,115 +345,68 @@ void debug_render()
     if (debugData->count2d == 0 && debugData->count3d == 0)
         return;
 
-    shader_begin(debugData->shader);
-    glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D, debugData->fontTexture[0]);
+    GlyphLayer *layer2d = &debugData->layer2d;
+    GlyphLayer *layer3d = &debugData->layer3d;
 
-    glDisable(GL_CULL_FACE);
-    glEnable(GL_DEPTH_TEST);
-    glEnable(GL_BLEND);
-    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-    glDepthFunc(GL_LESS);
-    glBlendEquation(GL_ADD);
+    for (int i = 0; i < debugData->count2d; i++)
+    {
+        Text2DData *it = &debugData->data2d[i];
+        Mat4 mt = mat4_scalef(it->scale);
+        mt = mat4_mul(mt, mat4_origin(vec3(it->position.x, it->position.y, 0)));
+        glyph_layout(layer2d, mt, it->origin, it->color, it->text);
+    }
 
-    if (debugData->count2d > 0)
+    for (int i = 0; i < debugData->count3d; i++)
     {
-        Mat4 ortho = mat4_orthographic(0, game->size.x, game->size.y, 0, -1.0f, 1.0f, 0);
+        Text3DData *it = &debugData->data3d[i];
+        Mat4 mt = mat4_scalef(it->scale);
+        if (!rot_eq(it->rotation, rot_zero))
+            mt = mat4_mul(mt, rot_matrix(it->rotation, vec3_zero));
+        mt = mat4_mul(mt, mat4_origin(it->position));
+        glyph_layout(layer3d, mt, it->origin, it->color, it->text);
+    }
 
-        shader_mat4(debugData->shader, "projection", &ortho);
-        shader_mat4(debugData->shader, "view", &mat4_identity);
+    Fastvec_GlyphVertex *vertices2d = layer2d->vertices[layer2d->frame];
+    Fastvec_GlyphVertex *vertices3d = layer3d->vertices[layer3d->frame];
+    int quads2d = vertices2d->length / 4;
+    int quads3d = vertices3d->length / 4;
 
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    // both layers share one orphaned buffer, the 3d quads start after the 2d ones
+    glBindVertexArray(debugData->vao);
+    glBindBuffer(GL_ARRAY_BUFFER, debugData->vbo);
+    glBufferData(GL_ARRAY_BUFFER, (vertices2d->length + vertices3d->length) * sizeof(GlyphVertex), NULL, GL_STREAM_DRAW);
+    glBufferSubData(GL_ARRAY_BUFFER, 0, vertices2d->length * sizeof(GlyphVertex), vertices2d->vector);
+    glBufferSubData(GL_ARRAY_BUFFER, vertices2d->length * sizeof(GlyphVertex), vertices3d->length * sizeof(GlyphVertex), vertices3d->vector);
+    glyph_indices(quads2d > quads3d ? quads2d : quads3d);
 
-        for (int i = 0; i < debugData->count2d; i++)
-        {
-            Text2DData it = debugData->data2d[i];
-            Mat4 mt = mat4_scalef(it.scale);
-            mt = mat4_mul(mt,
-                          mat4_origin(vec3(it.position.x, it.position.y, 0)));
-            shader_mat4(debugData->shader, "world", &mt);
-            shader_vec4(debugData->shader, "color", &it.color);
-
-            Vec2 space = calculateSpace(it.text, debugData->bound2d);
-            space.x *= it.origin.x;
-            space.y *= it.origin.y;
-            Vec3 of = {-space.x, -space.y, 0};
-            while (*it.text != '\0')
-            {
-                if (*it.text == '\n')
-                {
-                    of.x = -space.x;
-                    of.y += debugData->bound2d.y;
-                    it.text++;
-                }
-                shader_vec3(debugData->shader, "offset", &of);
-                shader_int(debugData->shader, "character", (int)(*it.text));
-
-                glBindVertexArray(debugData->vaoIds[1]);
-                glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
-                of.x += debugData->bound2d.x;
-                it.text++;
-            }
-        }
-    }
+    glBindVertexArray(0);
 
-    if (debugData->count3d > 0)
+    uint64_t key = render_key(RENDER_PASS_OVERLAY, debugData->shader, debugData->fontTexture[0], debugData->vao, 0);
+    if (quads2d > 0)
     {
-        shader_mat4(debugData->shader, "projection", &camera->projection);
-        shader_mat4(debugData->shader, "view", &camera->view);
-
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-        for (int i = 0; i < debugData->count3d; i++)
-        {
-            Text3DData it = debugData->data3d[i];
-
-            Mat4 mt = mat4_scalef(it.scale);
-            if (!rot_eq(it.rotation, rot_zero))
-                mt = mat4_mul(mt, rot_matrix(it.rotation, vec3_zero));
-
-            mt = mat4_mul(mt, mat4_origin(it.position));
-
-            shader_mat4(debugData->shader, "world", &mt);
-            shader_vec4(debugData->shader, "color", &it.color);
-
-            Vec2 space = calculateSpace(it.text, debugData->bound3d);
-            space.x *= it.origin.x;
-            space.y *= it.origin.y;
-            Vec3 of = {0, space.x, space.y};
-            while (*it.text != '\0')
-            {
-                if (*it.text == '\n')
-                {
-                    of.y = space.x;
-                    of.z -= debugData->bound3d.y;
-                    it.text++;
-                }
-                shader_vec3(debugData->shader, "offset", &of);
-                shader_int(debugData->shader, "character", (int)(*it.text));
-
-                glBindVertexArray(debugData->vaoIds[0]);
-                glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
-                of.y -= debugData->bound3d.x;
-                it.text++;
-            }
-        }
+        GlyphDraw draw = {mat4_orthographic(0, game->size.x, game->size.y, 0, -1.0f, 1.0f, 0), mat4_identity, GL_LINEAR, quads2d, 0};
+        render_submit(key, glyph_execute, &draw, sizeof(draw));
+    }
+    if (quads3d > 0)
+    {
+        GlyphDraw draw = {camera->projection, camera->view, GL_LINEAR_MIPMAP_LINEAR, quads3d, vertices2d->length};
+        render_submit(key | 1, glyph_execute, &draw, sizeof(draw));
     }
 
-    shader_end();
+    glyph_layer_swap(layer2d);
+    glyph_layer_swap(layer3d);
 
     debugData->count2d = 0;
     debugData->count3d = 0;
-    arena_reset(debugData->arena);
 }
 
 void debug_terminate()
 {
-    glDeleteVertexArrays(2, debugData->vaoIds);
-    glDeleteBuffers(2, debugData->vboIds);
-    glDeleteBuffers(2, debugData->eboIds);
+    glDeleteVertexArrays(1, &debugData->vao);
+    glDeleteBuffers(1, &debugData->vbo);
+    glDeleteBuffers(1, &debugData->ebo);
+    glyph_layer_destroy(&debugData->layer2d);
+    glyph_layer_destroy(&debugData->layer3d);
     glDeleteTextures(1, debugData->fontTexture);
     shader_destroy(debugData->shader);
 }
@@ -354,7 +443,7 @@ void debug_string(Vec2 pos, const char *str, int n)
     if (debugData->count2d == max_elements)
         debugData->count2d = 0;
 
-    char *cpy = arena_alloc(debugData->arena, n);
+    char *cpy = xxframe(n);
     memcpy(cpy, str, n);
     Text2DData dt;
     dt.position = pos;
@@ -371,7 +460,7 @@ void debug_string3d(Vec3 pos, const char *str, int n)
     if (debugData->count3d == max_elements)
         debugData->count3d = 0;
 
-    char *cpy = arena_alloc(debugData->arena, n);
+    char *cpy = xxframe(n);
     memcpy(cpy, str, n);
     Text3DData dt;
     dt.position = pos;
@@ -1,17 +1,22 @@
-
 #include "draw.h"
 
 #include <string.h>
 #include "shader.h"
 #include "camera.h"
+#include "render.h"
 #include "glad.h"
 
 #include "math/scalar.h"
+#include "adt/fastvec.h"
 
 enum
 {
     types_n = 4,
-    object_count = 50000,
+    // frames in flight, each owns one segment of a stream
+    segments_n = 3,
+    // a multiple of 6, and so is every doubling of it, so a line or triangle never ends up split
+    // between the segment draw and the overflow draw
+    initial_segment = 16380,
 };
 
 typedef struct
@@ -21,108 +26,231 @@ typedef struct
     float size;
 } Vertex;
 
+make_fastvec_directives(Vertex, Vertex);
+
+// vertices of one primitive type, written straight into the mapped segment of the current frame.
+// a fence per segment keeps the cpu from overwriting vertices the gpu has not drawn yet
+typedef struct
+{
+    GLuint vao;
+    GLuint vbo;
+    GLenum mode;
+    // vertices per segment
+    int capacity;
+    int segment;
+    int count;
+    // whole buffer, only kept with persistent mapping
+    Vertex *base;
+    Vertex *mapped;
+    GLsync fences[segments_n];
+    // vertices past the segment capacity, drawn once from a grown buffer at the end of the frame
+    Fastvec_Vertex *overflow;
+} DrawStream;
+
 typedef struct
 {
-    GLuint vaoIds[types_n];
-    GLuint vboIds[types_n];
-    int types[types_n];
-    int counter[types_n];
+    DrawStream streams[types_n];
+    // GL_ARB_buffer_storage, otherwise each segment is mapped unsynchronized for the frame and unmapped before drawing
+    bool persistent;
     Shader shader;
-    Vertex vertices[types_n][object_count];
 } DrawData;
 
 static DrawData *drawData;
 
-void draw_init()
+#define DRAW_STORAGE_FLAGS (GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT)
+
+static void stream_allocate(DrawStream *self, int capacity)
 {
-    drawData = (DrawData *)xxarena(sizeof(DrawData));
-    memset(drawData, 0, sizeof(DrawData));
+    GLsizeiptr size = (GLsizeiptr)segments_n * capacity * sizeof(Vertex);
+    self->capacity = capacity;
+    self->segment = 0;
+    self->count = 0;
+    self->mapped = NULL;
+    memset(self->fences, 0, sizeof(self->fences));
+
+    glGenBuffers(1, &self->vbo);
+    render_vao(self->vao);
+    glBindBuffer(GL_ARRAY_BUFFER, self->vbo);
+    if (drawData->persistent)
+    {
+        glBufferStorage(GL_ARRAY_BUFFER, size, NULL, DRAW_STORAGE_FLAGS);
+        self->base = (Vertex *)glMapBufferRange(GL_ARRAY_BUFFER, 0, size, DRAW_STORAGE_FLAGS);
+    }
+    else
+    {
+        glBufferData(GL_ARRAY_BUFFER, size, NULL, GL_STREAM_DRAW);
+        self->base = NULL;
+    }
 
-    drawData->types[0] = GL_POINTS;
-    drawData->types[1] = GL_LINES;
-    drawData->types[2] = GL_TRIANGLES;
-    drawData->types[3] = GL_TRIANGLES;
+    glEnableVertexAttribArray(0);
+    glEnableVertexAttribArray(1);
+    glEnableVertexAttribArray(2);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void *)offsetof(Vertex, position));
+    glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void *)offsetof(Vertex, color));
+    glVertexAttribPointer(2, 1, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void *)offsetof(Vertex, size));
+}
 
-    drawData->counter[0] = 0;
-    drawData->counter[1] = 0;
-    drawData->counter[2] = 0;
-    drawData->counter[3] = 0;
+static void stream_release(DrawStream *self)
+{
+    for (int i = 0; i < segments_n; i++)
+    {
+        if (self->fences[i])
+            glDeleteSync(self->fences[i]);
+        self->fences[i] = 0;
+    }
+    if (self->mapped)
+    {
+        glBindBuffer(GL_ARRAY_BUFFER, self->vbo);
+        glUnmapBuffer(GL_ARRAY_BUFFER);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+    }
+    // the gpu keeps the storage alive until draws already queued from it are done
+    glDeleteBuffers(1, &self->vbo);
+    self->vbo = 0;
+    self->base = NULL;
+    self->mapped = NULL;
+}
 
-    drawData->shader = shader_load("shaders/draw.vs", "shaders/draw.fs");
-    glGenVertexArrays(types_n, drawData->vaoIds);
-    glGenBuffers(types_n, drawData->vboIds);
+// waits until the gpu is done with the current segment and maps it for writing
+static void stream_begin(DrawStream *self)
+{
+    GLsync fence = self->fences[self->segment];
+    if (fence)
+    {
+        while (glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000) == GL_TIMEOUT_EXPIRED)
+            ;
+        glDeleteSync(fence);
+        self->fences[self->segment] = 0;
+    }
 
-    for (int i = 0; i < types_n; i++)
+    self->count = 0;
+    if (drawData->persistent)
     {
-        glBindVertexArray(drawData->vaoIds[i]);
-        glBindBuffer(GL_ARRAY_BUFFER, drawData->vboIds[i]);
-        glBufferData(GL_ARRAY_BUFFER, sizeof(drawData->vertices[i]),
-                     drawData->vertices[i], GL_DYNAMIC_DRAW);
-
-        glEnableVertexAttribArray(0);
-        glEnableVertexAttribArray(1);
-        glEnableVertexAttribArray(2);
-        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void *)offsetof(Vertex, position));
-        glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void *)offsetof(Vertex, color));
-        glVertexAttribPointer(2, 1, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void *)offsetof(Vertex, size));
-
-        drawData->counter[i] = 0;
+        self->mapped = self->base + (size_t)self->segment * self->capacity;
+        return;
     }
+    GLsizeiptr size = self->capacity * (GLsizeiptr)sizeof(Vertex);
+    glBindBuffer(GL_ARRAY_BUFFER, self->vbo);
+    self->mapped = (Vertex *)glMapBufferRange(GL_ARRAY_BUFFER, self->segment * size, size,
+                                              GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
     glBindBuffer(GL_ARRAY_BUFFER, 0);
-    glBindVertexArray(0);
 }
 
-void draw_render()
+// non persistent mappings have to be released before the gpu may read the buffer
+static void stream_end(DrawStream *self)
+{
+    if (drawData->persistent || self->mapped == NULL)
+        return;
+    glBindBuffer(GL_ARRAY_BUFFER, self->vbo);
+    glUnmapBuffer(GL_ARRAY_BUFFER);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    self->mapped = NULL;
+}
+
+static void stream_draw(DrawStream *self)
 {
-    shader_begin(drawData->shader);
-    shader_mat4(drawData->shader, "projection", &camera->projection);
-    shader_mat4(drawData->shader, "view", &camera->view);
+    stream_end(self);
+    if (self->count > 0)
+    {
+        render_vao(self->vao);
+        render_draw_arrays(self->mode, self->segment * self->capacity, self->count);
+    }
+
+    if (self->overflow->length > 0)
+    {
+        // the segment was too small this frame, move to a buffer that fits the whole frame and
+        // draw the spilled vertices from it, the ones already drawn stay in the old buffer
+        int needed = self->count + self->overflow->length;
+        int capacity = self->capacity << 1;
+        while (capacity < needed)
+            capacity <<= 1;
+        stream_release(self);
+        stream_allocate(self, capacity);
+        stream_begin(self);
+        memcpy(self->mapped, self->overflow->vector, self->overflow->length * sizeof(Vertex));
+        self->count = self->overflow->length;
+        fastvec_Vertex_clear(self->overflow);
+        stream_end(self);
+        render_vao(self->vao);
+        render_draw_arrays(self->mode, 0, self->count);
+    }
+
+    self->fences[self->segment] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    self->segment = (self->segment + 1) % segments_n;
+    stream_begin(self);
+}
 
-    glLineWidth(1);
-    glEnable(GL_DEPTH_TEST);
-    glCullFace(GL_FRONT);
-    glFrontFace(GL_CW);
+void draw_init()
+{
+    drawData = (DrawData *)xxarena(sizeof(DrawData));
+    memset(drawData, 0, sizeof(DrawData));
 
-    glEnable(GL_BLEND);
-    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-    glDepthFunc(GL_LEQUAL);
-    glBlendEquation(GL_ADD);
+    drawData->persistent = GLAD_GL_ARB_buffer_storage && glBufferStorage != NULL;
+    drawData->shader = shader_load("shaders/draw.vs", "shaders/draw.fs");
 
+    GLenum modes[types_n] = {GL_POINTS, GL_LINES, GL_TRIANGLES, GL_TRIANGLES};
     for (int i = 0; i < types_n; i++)
     {
-        int count = drawData->counter[i];
-        if (count == 0)
-            continue;
-        if (i == 3)
-            glDisable(GL_CULL_FACE);
-        else
-            glEnable(GL_CULL_FACE);
+        DrawStream *it = &drawData->streams[i];
+        it->mode = modes[i];
+        it->overflow = fastvec_Vertex_init(0);
+        glGenVertexArrays(1, &it->vao);
+        stream_allocate(it, initial_segment);
+        stream_begin(it);
+    }
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
 
-        glBindVertexArray(drawData->vaoIds[i]);
-        glBindBuffer(GL_ARRAY_BUFFER, drawData->vboIds[i]);
-        glBufferSubData(GL_ARRAY_BUFFER, 0, count * (GLsizeiptr)sizeof(Vertex), drawData->vertices[i]);
-        glDrawArrays(drawData->types[i], 0, count);
+static void draw_execute(const void *data)
+{
+    int type = *(const int *)data;
+
+    render_program(drawData->shader);
+    render_line_width(1);
+    render_depth_test(true);
+    render_depth_func(GL_LEQUAL);
+    render_cull(type != 3);
+    render_cull_face(GL_FRONT);
+    render_front_face(GL_CW);
+    render_blend(true);
+    render_blend_func(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+
+    stream_draw(&drawData->streams[type]);
+}
 
-        drawData->counter[i] = 0;
+void draw_render()
+{
+    for (int i = 0; i < types_n; i++)
+    {
+        DrawStream *it = &drawData->streams[i];
+        if (it->count == 0 && it->overflow->length == 0)
+            continue;
+        // the type goes into the mesh bits to keep points, lines and triangles in order
+        render_submit(render_key(RENDER_PASS_TRANSPARENT, drawData->shader, 0, i, 0), draw_execute, &i, sizeof(i));
     }
-
-    shader_end();
 }
 
 void draw_terminate()
 {
-    glDeleteVertexArrays(types_n, drawData->vaoIds);
-    glDeleteBuffers(types_n, drawData->vboIds);
+    for (int i = 0; i < types_n; i++)
+    {
+        DrawStream *it = &drawData->streams[i];
+        stream_release(it);
+        glDeleteVertexArrays(1, &it->vao);
+        fastvec_Vertex_destroy(it->overflow);
+    }
     shader_destroy(drawData->shader);
 }
 
-static void add_vertex(int type, Vertex v)
+static inline void add_vertex(int type, Vertex v)
 {
-    if (drawData->counter[type] == object_count)
+    DrawStream *it = &drawData->streams[type];
+    if (__builtin_expect(it->count < it->capacity && it->mapped != NULL, 1))
+    {
+        it->mapped[it->count++] = v;
         return;
-    int count = drawData->counter[type];
-    drawData->vertices[type][count] = v;
-    drawData->counter[type]++;
+    }
+    fastvec_Vertex_push(it->overflow, v);
 }
 
 void draw_point(Vec3 pos, float size, Color c)
@@ -424,6 +552,7 @@ void draw_circle_xy(Vec3 cen, float radius, Color color, int seg)
     Vec2 center = vec2xy(cen);
     Vertex va;
     va.color = color;
+    va.size = 0;
     const float k_increment = 360.0f / seg;
     float sinInc = sindf(k_increment);
     float cosInc = cosdf(k_increment);
@@ -479,6 +608,7 @@ void draw_circle_xz(Vec3 cen, float radius, Color color, int seg)
     Vec2 center = vec2xz(cen);
     Vertex va;
     va.color = color;
+    va.size = 0;
     const float k_increment = 360.0f / seg;
     float sinInc = sindf(k_increment);
     float cosInc = cosdf(k_increment);
@@ -504,6 +634,7 @@ void draw_circle_yz(Vec3 cen, float radius, Color color, int seg)
     Vec2 center = vec2yz(cen);
     Vertex va;
     va.color = color;
+    va.size = 0;
     const float k_increment = 360.0f / seg;
     float sinInc = sindf(k_increment);
     float cosInc = cosdf(k_increment);
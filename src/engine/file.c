@@ -38,6 +38,31 @@ StrView readfile_stack(const char *p)
     return (StrView){data, n};
 }
 
+StrView readfile_heap(const char *path)
+{
+    FILE *f = fopen(path, "rb");
+    if (f == NULL)
+        return (StrView){NULL, 0};
+    fseek(f, 0, SEEK_END);
+    long size = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    if (size < 0)
+    {
+        fclose(f);
+        return (StrView){NULL, 0};
+    }
+    char *data = (char *)xxmalloc(size + 1);
+    size_t n = fread(data, 1, size, f);
+    fclose(f);
+    data[n] = 0;
+    if (n != (size_t)size)
+    {
+        xxfree(data, size + 1);
+        return (StrView){NULL, 0};
+    }
+    return (StrView){data, n};
+}
+
 StrView readline_stack(void *f, size_t *cursor)
 {
     fseek(f, *cursor, SEEK_SET);
@@ -8,6 +8,10 @@ StrView resolve_stack(const char *fmt, ...);
 
 StrView readfile_stack(const char *p);
 
+// reads an already resolved path into an xxmalloc block that is free to use off the main thread,
+// release it with xxfree(string, length + 1)
+StrView readfile_heap(const char *path);
+
 StrView readline_stack(void *f, size_t *cursor);
 
 void file_init(const char *fmt, ...);
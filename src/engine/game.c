@@ -2,6 +2,7 @@
 #include "game.h"
 
 #include "mem/alloc.h"
+#include "mem/profile.h"
 #include "math/scalar.h"
 
 #define GLFW_INCLUDE_NONE
@@ -116,6 +117,9 @@ void calculate_fps()
 
 void game_begin()
 {
+    frame_swap(alloc->frame);
+    profile_frame();
+
     glClearColor(0.05f, 0.05f, 0.05f, 1.0f);
     glClear(GL_DEPTH_BUFFER_BIT | GL_COLOR_BUFFER_BIT);
     glDepthFunc(GL_LESS);
@@ -7,6 +7,7 @@
 	APIs: gl=3.2
 	Profile: compatibility
 	Extensions:
+		GL_ARB_buffer_storage,
 		GL_ARB_multisample,
 		GL_ARB_robustness,
 		GL_KHR_debug
@@ -143,6 +144,7 @@ int GLAD_GL_VERSION_2_1;
 int GLAD_GL_VERSION_3_0;
 int GLAD_GL_VERSION_3_1;
 int GLAD_GL_VERSION_3_2;
+int GLAD_GL_VERSION_3_3;
 PFNGLCOPYTEXIMAGE1DPROC glad_glCopyTexImage1D;
 PFNGLVERTEXATTRIBI3UIPROC glad_glVertexAttribI3ui;
 PFNGLWINDOWPOS2SPROC glad_glWindowPos2s;
@@ -347,6 +349,7 @@ PFNGLMAPGRID2DPROC glad_glMapGrid2d;
 PFNGLMAPGRID2FPROC glad_glMapGrid2f;
 PFNGLVERTEX2IPROC glad_glVertex2i;
 PFNGLVERTEXATTRIBPOINTERPROC glad_glVertexAttribPointer;
+PFNGLVERTEXATTRIBDIVISORPROC glad_glVertexAttribDivisor;
 PFNGLFRAMEBUFFERTEXTURELAYERPROC glad_glFramebufferTextureLayer;
 PFNGLVERTEX2SPROC glad_glVertex2s;
 PFNGLNORMAL3BVPROC glad_glNormal3bv;
@@ -812,6 +815,8 @@ PFNGLCLEARBUFFERUIVPROC glad_glClearBufferuiv;
 int GLAD_GL_KHR_debug;
 int GLAD_GL_ARB_robustness;
 int GLAD_GL_ARB_multisample;
+int GLAD_GL_ARB_buffer_storage;
+PFNGLBUFFERSTORAGEPROC glad_glBufferStorage;
 PFNGLSAMPLECOVERAGEARBPROC glad_glSampleCoverageARB;
 PFNGLGETGRAPHICSRESETSTATUSARBPROC glad_glGetGraphicsResetStatusARB;
 PFNGLGETNTEXIMAGEARBPROC glad_glGetnTexImageARB;
@@ -1578,6 +1583,18 @@ static void load_GL_VERSION_3_2(GLADloadproc load)
 	glad_glGetMultisamplefv = (PFNGLGETMULTISAMPLEFVPROC)load("glGetMultisamplefv");
 	glad_glSampleMaski = (PFNGLSAMPLEMASKIPROC)load("glSampleMaski");
 }
+static void load_GL_VERSION_3_3(GLADloadproc load)
+{
+	if (!GLAD_GL_VERSION_3_3)
+		return;
+	glad_glVertexAttribDivisor = (PFNGLVERTEXATTRIBDIVISORPROC)load("glVertexAttribDivisor");
+}
+static void load_GL_ARB_buffer_storage(GLADloadproc load)
+{
+	if (!GLAD_GL_ARB_buffer_storage)
+		return;
+	glad_glBufferStorage = (PFNGLBUFFERSTORAGEPROC)load("glBufferStorage");
+}
 static void load_GL_ARB_multisample(GLADloadproc load)
 {
 	if (!GLAD_GL_ARB_multisample)
@@ -1640,6 +1657,7 @@ static int find_extensionsGL(void)
 {
 	if (!get_exts())
 		return 0;
+	GLAD_GL_ARB_buffer_storage = has_ext("GL_ARB_buffer_storage");
 	GLAD_GL_ARB_multisample = has_ext("GL_ARB_multisample");
 	GLAD_GL_ARB_robustness = has_ext("GL_ARB_robustness");
 	GLAD_GL_KHR_debug = has_ext("GL_KHR_debug");
@@ -1699,6 +1717,7 @@ static void find_coreGL(void)
 	GLAD_GL_VERSION_3_0 = (major == 3 && minor >= 0) || major > 3;
 	GLAD_GL_VERSION_3_1 = (major == 3 && minor >= 1) || major > 3;
 	GLAD_GL_VERSION_3_2 = (major == 3 && minor >= 2) || major > 3;
+	GLAD_GL_VERSION_3_3 = (major == 3 && minor >= 3) || major > 3;
 	if (GLVersion.major > 3 || (GLVersion.major >= 3 && GLVersion.minor >= 2))
 	{
 		max_loaded_major = 3;
@@ -1727,9 +1746,11 @@ int gladLoadGLLoader(GLADloadproc load)
 	load_GL_VERSION_3_0(load);
 	load_GL_VERSION_3_1(load);
 	load_GL_VERSION_3_2(load);
+	load_GL_VERSION_3_3(load);
 
 	if (!find_extensionsGL())
 		return 0;
+	load_GL_ARB_buffer_storage(load);
 	load_GL_ARB_multisample(load);
 	load_GL_ARB_robustness(load);
 	load_GL_KHR_debug(load);
@@ -5,6 +5,7 @@
 #include "shader.h"
 #include "camera.h"
 #include "draw.h"
+#include "render.h"
 
 #include "math/vec3.h"
 #include "math/color.h"
@@ -34,6 +35,8 @@ typedef struct
     int displayState;
     int showAxis;
     Shader shader;
+    int worldLocation;
+    int alphaLocation;
     GLuint vaoIds[1];
     GLuint vboIds[1];
     Vertex vertices[ne];
@@ -43,6 +46,14 @@ typedef struct
 
 static GridData *gridData;
 
+// one pass over the grid lines, executed from the render queue
+typedef struct
+{
+    Mat4 world;
+    float alpha;
+    float width;
+} GridLines;
+
 void grid_init()
 {
 
@@ -54,20 +65,10 @@ void grid_init()
     gridData->prev_enabled = -1;
 
     gridData->shader = shader_load("shaders/grid.vs", "shaders/grid.fs");
-    glGenVertexArrays(2, gridData->vaoIds);
-    glGenBuffers(2, gridData->vboIds);
-
-    glBindVertexArray(gridData->vaoIds[0]);
-    glBindBuffer(GL_ARRAY_BUFFER, gridData->vboIds[0]);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(gridData->vertices), gridData->vertices, GL_DYNAMIC_DRAW);
-
-    glEnableVertexAttribArray(0);
-    glEnableVertexAttribArray(1);
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void *)offsetof(Vertex, position));
-    glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void *)offsetof(Vertex, color));
-
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
-    glBindVertexArray(0);
+    gridData->worldLocation = shader_location(gridData->shader, "world");
+    gridData->alphaLocation = shader_location(gridData->shader, "alpha");
+    glGenVertexArrays(1, gridData->vaoIds);
+    glGenBuffers(1, gridData->vboIds);
 
     Vertex a;
     Color c;
@@ -99,6 +100,19 @@ void grid_init()
         a.position.z = 0;
         gridData->vertices[k++] = a;
     }
+
+    // the lines never change, only the world transform moves them with the camera
+    glBindVertexArray(gridData->vaoIds[0]);
+    glBindBuffer(GL_ARRAY_BUFFER, gridData->vboIds[0]);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(gridData->vertices), gridData->vertices, GL_STATIC_DRAW);
+
+    glEnableVertexAttribArray(0);
+    glEnableVertexAttribArray(1);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void *)offsetof(Vertex, position));
+    glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void *)offsetof(Vertex, color));
+
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glBindVertexArray(0);
 }
 
 void grid_enable()
@@ -124,11 +138,28 @@ void grid_restore()
 }
 void grid_terminate()
 {
-    glDeleteVertexArrays(2, gridData->vaoIds);
-    glDeleteBuffers(2, gridData->vboIds);
+    glDeleteVertexArrays(1, gridData->vaoIds);
+    glDeleteBuffers(1, gridData->vboIds);
     shader_destroy(gridData->shader);
 }
 
+static void grid_execute(const void *data)
+{
+    const GridLines *it = (const GridLines *)data;
+
+    render_program(gridData->shader);
+    render_depth_test(false);
+    render_depth_func(GL_LEQUAL);
+    render_blend(true);
+    render_blend_func(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    render_line_width(it->width);
+    render_vao(gridData->vaoIds[0]);
+
+    shader_set_mat4(gridData->worldLocation, &it->world);
+    shader_set_float(gridData->alphaLocation, it->alpha);
+    render_draw_arrays(GL_LINES, 0, ne);
+}
+
 void grid_render()
 {
     if (!gridData->enabled)
@@ -150,21 +181,6 @@ void grid_render()
         Mat4 world2;
         Vec3 t = vec3_zero;
 
-        shader_begin(gridData->shader);
-        shader_mat4(gridData->shader, "projection", &camera->projection);
-        shader_mat4(gridData->shader, "view", &camera->view);
-
-        glDisable(GL_DEPTH_TEST);
-
-        glEnable(GL_BLEND);
-        glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-        glDepthFunc(GL_LEQUAL);
-        glBlendEquation(GL_ADD);
-
-        glLineWidth(1);
-        glBindVertexArray(gridData->vaoIds[0]);
-        glBindBuffer(GL_ARRAY_BUFFER, gridData->vboIds[0]);
-        glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(gridData->vertices), gridData->vertices);
         char isOrtho = (char)(camera->ortho & VIEW_ORTHOGRAPHIC);
 
         t.x = camera->position.x;
@@ -207,20 +223,10 @@ void grid_render()
         }
         float factor = (1.0f - clamp01f((camera->zoom - UNIT_SCALE * 100) / (UNIT_SCALE * 10.0f)));
 
-        shader_mat4(gridData->shader, "world", &world1);
-        shader_float(gridData->shader, "alpha", flt * factor);
-        glDrawArrays(GL_LINES, 0, sizeof(gridData->vertices));
-
-        glLineWidth(2);
-        shader_mat4(gridData->shader, "world", &world2);
-        shader_float(gridData->shader, "alpha", flt * 2);
-        glDrawArrays(GL_LINES, 0, sizeof(gridData->vertices));
-
-        glEnable(GL_DEPTH_TEST);
-        glBindBuffer(GL_ARRAY_BUFFER, 0);
-        glBindVertexArray(0);
-
-        shader_end();
+        GridLines fine = {world1, flt * factor, 1};
+        GridLines coarse = {world2, flt * 2, 2};
+        render_submit(render_key(RENDER_PASS_BACKGROUND, gridData->shader, 0, gridData->vaoIds[0], 0), grid_execute, &fine, sizeof(fine));
+        render_submit(render_key(RENDER_PASS_BACKGROUND, gridData->shader, 0, gridData->vaoIds[0], 1), grid_execute, &coarse, sizeof(coarse));
     }
 
     if (gridData->displayState == 1 || gridData->displayState == 0)
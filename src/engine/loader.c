@@ -0,0 +1,297 @@
+#include "loader.h"
+
+#include <string.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <unistd.h>
+
+#include "mem/alloc.h"
+#include "mem/slab.h"
+#include "adt/fastqu.h"
+#include "adt/fastslot.h"
+#include "adt/fastvec.h"
+#include "file.h"
+
+// loads handed to the workers at once, past this they are decoded on the main thread
+#define LOADER_QUEUE_SIZE 256
+#define LOADER_MAX_WORKERS 8
+
+typedef struct
+{
+    const LoadHandler *handler;
+    char *path;
+    size_t pathSize;
+    int32_t target;
+    LoadTicket ticket;
+    // set by the main thread, a worker that sees it skips the decode
+    _Atomic bool cancelled;
+    void *data;
+    size_t bytes;
+} LoadJob;
+
+// the containers hold pointers, jobs stay put while workers use them
+typedef LoadJob *LoadJobPtr;
+
+make_fastslot_directives(LoadJob, LoadJobPtr);
+make_fastmpmc_directives(LoadJob, LoadJobPtr);
+make_fastvec_directives(LoadJob, LoadJobPtr);
+
+typedef struct
+{
+    size_t budget;
+    int workerCount;
+    pthread_t workers[LOADER_MAX_WORKERS];
+    // workers sleep on wake while there are no requests, the main thread sleeps on done inside loader_wait
+    pthread_mutex_t mutex;
+    pthread_cond_t wake;
+    pthread_cond_t done;
+    bool quit;
+    Fastmpmc_LoadJob *requests;
+    Fastmpmc_LoadJob *decoded;
+
+    // main thread only from here
+    int inflight;
+    // jobs and their paths, workers read them but only the main thread allocates and frees
+    SlabMemory *slab;
+    Fastslot_LoadJob *jobs;
+    // decoded and waiting for upload budget, in arrival order
+    Fastvec_LoadJob *ready;
+} LoaderContext;
+
+static LoaderContext *self = NULL;
+
+static void loader_decode(LoadJob *job)
+{
+    if (!atomic_load_explicit(&job->cancelled, memory_order_relaxed))
+        job->data = job->handler->decode(job->path, &job->bytes);
+}
+
+static void *loader_worker(void *arg)
+{
+    (void)arg;
+    while (true)
+    {
+        LoadJob *job;
+        if (!fastmpmc_LoadJob_pop(self->requests, &job))
+        {
+            pthread_mutex_lock(&self->mutex);
+            while (!self->quit && fastmpmc_LoadJob_empty(self->requests))
+                pthread_cond_wait(&self->wake, &self->mutex);
+            bool quit = self->quit && fastmpmc_LoadJob_empty(self->requests);
+            pthread_mutex_unlock(&self->mutex);
+            if (quit)
+                return NULL;
+            continue;
+        }
+        loader_decode(job);
+        // never full, the main thread keeps at most LOADER_QUEUE_SIZE jobs in flight
+        fastmpmc_LoadJob_push(self->decoded, job);
+        pthread_mutex_lock(&self->mutex);
+        pthread_cond_signal(&self->done);
+        pthread_mutex_unlock(&self->mutex);
+    }
+}
+
+void loader_init(int workers, size_t budget)
+{
+    self = (LoaderContext *)xxarena(sizeof(LoaderContext));
+    memset(self, 0, sizeof(LoaderContext));
+    if (workers <= 0)
+    {
+        long cores = sysconf(_SC_NPROCESSORS_ONLN);
+        workers = cores > 1 ? (int)cores - 1 : 1;
+    }
+    self->workerCount = workers < LOADER_MAX_WORKERS ? workers : LOADER_MAX_WORKERS;
+    self->budget = budget;
+    self->slab = make_slab();
+    self->requests = fastmpmc_LoadJob_init(LOADER_QUEUE_SIZE);
+    self->decoded = fastmpmc_LoadJob_init(LOADER_QUEUE_SIZE);
+    self->jobs = fastslot_LoadJob_init(16);
+    self->ready = fastvec_LoadJob_init(16);
+    pthread_mutex_init(&self->mutex, NULL);
+    pthread_cond_init(&self->wake, NULL);
+    pthread_cond_init(&self->done, NULL);
+    for (int i = 0; i < self->workerCount; i++)
+    {
+        if (pthread_create(&self->workers[i], NULL, loader_worker, NULL) != 0)
+        {
+            self->workerCount = i;
+            break;
+        }
+    }
+}
+
+static void loader_free(LoadJob *job)
+{
+    if (job->data != NULL)
+        job->handler->release(job->data);
+    slab_free(self->slab, job->path, job->pathSize);
+    slab_free(self->slab, job, sizeof(LoadJob));
+}
+
+static void loader_upload(LoadJob *job)
+{
+    fastslot_LoadJob_remove(self->jobs, job->ticket);
+    job->handler->upload(job->target, job->data);
+    loader_free(job);
+}
+
+// takes a job out of the ready list keeping the order of the rest
+static LoadJob *loader_take(int index)
+{
+    LoadJob *job = self->ready->vector[index];
+    memmove(&self->ready->vector[index], &self->ready->vector[index + 1], (self->ready->length - index - 1) * sizeof(LoadJob *));
+    self->ready->length--;
+    return job;
+}
+
+// moves whatever the workers finished into the ready list
+static void loader_collect()
+{
+    LoadJob *job;
+    while (fastmpmc_LoadJob_pop(self->decoded, &job))
+    {
+        self->inflight--;
+        if (atomic_load_explicit(&job->cancelled, memory_order_relaxed))
+            loader_free(job);
+        else
+            fastvec_LoadJob_push(self->ready, job);
+    }
+}
+
+LoadTicket loader_request(const LoadHandler *handler, const char *p, int32_t target)
+{
+    LoadJob *job = (LoadJob *)slab_alloc(self->slab, sizeof(LoadJob));
+    // the stack allocator belongs to the main thread, so the path is resolved here
+    StrView path = resolve_stack(p);
+    job->pathSize = path.length + 1;
+    job->path = (char *)slab_alloc(self->slab, job->pathSize);
+    memcpy(job->path, path.string, job->pathSize);
+    xxfreestack(path.string);
+    job->handler = handler;
+    job->target = target;
+    atomic_init(&job->cancelled, false);
+    job->data = NULL;
+    job->bytes = 0;
+    job->ticket = fastslot_LoadJob_add(self->jobs, job);
+    if (job->ticket == LOAD_NONE)
+    {
+        loader_decode(job);
+        loader_upload(job);
+        return LOAD_NONE;
+    }
+
+    if (self->inflight < LOADER_QUEUE_SIZE && self->workerCount > 0 && fastmpmc_LoadJob_push(self->requests, job))
+    {
+        self->inflight++;
+        pthread_mutex_lock(&self->mutex);
+        pthread_cond_signal(&self->wake);
+        pthread_mutex_unlock(&self->mutex);
+    }
+    else
+    {
+        // no room for it on the workers, the upload is still paced by the budget
+        loader_decode(job);
+        fastvec_LoadJob_push(self->ready, job);
+    }
+    return job->ticket;
+}
+
+void loader_cancel(LoadTicket ticket)
+{
+    LoadJob **it = fastslot_LoadJob_get(self->jobs, ticket);
+    if (it == NULL)
+        return;
+    LoadJob *job = *it;
+    fastslot_LoadJob_remove(self->jobs, ticket);
+    atomic_store_explicit(&job->cancelled, true, memory_order_relaxed);
+    // a decoded job is freed now, one still on a worker when loader_collect gets it back
+    for (int i = 0; i < self->ready->length; i++)
+    {
+        if (self->ready->vector[i] == job)
+        {
+            loader_free(loader_take(i));
+            return;
+        }
+    }
+}
+
+bool loader_is_ready(LoadTicket ticket)
+{
+    return !fastslot_LoadJob_has(self->jobs, ticket);
+}
+
+void loader_wait(LoadTicket ticket)
+{
+    while (fastslot_LoadJob_has(self->jobs, ticket))
+    {
+        loader_collect();
+        for (int i = 0; i < self->ready->length; i++)
+        {
+            if (self->ready->vector[i]->ticket == ticket)
+            {
+                loader_upload(loader_take(i));
+                return;
+            }
+        }
+        pthread_mutex_lock(&self->mutex);
+        while (fastmpmc_LoadJob_empty(self->decoded))
+            pthread_cond_wait(&self->done, &self->mutex);
+        pthread_mutex_unlock(&self->mutex);
+    }
+}
+
+void loader_wait_all()
+{
+    while (!fastslot_LoadJob_empty(self->jobs))
+        loader_wait(fastslot_LoadJob_id_at(self->jobs, 0));
+}
+
+int loader_pending()
+{
+    return self->jobs->length;
+}
+
+void loader_update()
+{
+    loader_collect();
+    size_t spent = 0;
+    while (self->ready->length > 0)
+    {
+        size_t bytes = self->ready->vector[0]->bytes;
+        if (spent > 0 && spent + bytes > self->budget)
+            break;
+        spent += bytes > 0 ? bytes : 1;
+        loader_upload(loader_take(0));
+    }
+}
+
+void loader_destroy()
+{
+    for (int i = 0; i < self->jobs->length; i++)
+        atomic_store_explicit(&self->jobs->dense[i]->cancelled, true, memory_order_relaxed);
+    for (int i = 0; i < self->ready->length; i++)
+        loader_free(self->ready->vector[i]);
+
+    pthread_mutex_lock(&self->mutex);
+    self->quit = true;
+    pthread_cond_broadcast(&self->wake);
+    pthread_mutex_unlock(&self->mutex);
+    for (int i = 0; i < self->workerCount; i++)
+        pthread_join(self->workers[i], NULL);
+
+    // the workers drained every request before leaving
+    LoadJob *job;
+    while (fastmpmc_LoadJob_pop(self->decoded, &job))
+        loader_free(job);
+
+    fastmpmc_LoadJob_destroy(self->requests);
+    fastmpmc_LoadJob_destroy(self->decoded);
+    fastslot_LoadJob_destroy(self->jobs);
+    fastvec_LoadJob_destroy(self->ready);
+    slab_destroy(self->slab);
+    pthread_cond_destroy(&self->wake);
+    pthread_cond_destroy(&self->done);
+    pthread_mutex_destroy(&self->mutex);
+    self = NULL;
+}
@@ -0,0 +1,50 @@
+#ifndef cgame_LOADER_H
+#define cgame_LOADER_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+// handle to a queued load, it stops resolving once the result was uploaded or the load was cancelled
+typedef uint32_t LoadTicket;
+
+#define LOAD_NONE 0
+
+// what a kind of asset does at each stage of a load
+typedef struct
+{
+    // runs on a worker, turns the resolved path into cpu data and reports its upload size, NULL on failure
+    void *(*decode)(const char *path, size_t *bytes);
+    // runs on the main thread with the decoded data, or NULL when decoding failed
+    void (*upload)(int32_t target, void *data);
+    // frees decoded data, also for loads that were cancelled before their upload
+    void (*release)(void *data);
+} LoadHandler;
+
+// starts the decode workers, 0 picks one per spare core. budget caps the bytes uploaded per frame,
+// at least one load is uploaded every frame so assets bigger than the budget still get through
+void loader_init(int workers, size_t budget);
+
+// queues a load, target is handed back to the upload callback so it can find the placeholder to replace
+LoadTicket loader_request(const LoadHandler *handler, const char *p, int32_t target);
+
+// drops a load, its upload never runs
+void loader_cancel(LoadTicket ticket);
+
+// true once the load was uploaded or cancelled
+bool loader_is_ready(LoadTicket ticket);
+
+// blocks until the load is decoded and uploads it right away, outside the frame budget
+void loader_wait(LoadTicket ticket);
+
+void loader_wait_all();
+
+// number of loads not uploaded yet
+int loader_pending();
+
+// uploads decoded loads in request order until the frame budget is spent
+void loader_update();
+
+void loader_destroy();
+
+#endif
@@ -2,198 +2,685 @@
 
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <stdatomic.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 
 #include "mem/alloc.h"
+#include "mem/defs.h"
 #include "file.h"
 #include "adt/str.h"
+#include "adt/hash.h"
 
 #include "adt/fastvec.h"
 #include "glad.h"
 
-make_fastmap_directives(StrMeshId, const char *, MeshId, adt_compare_cstr, adt_hashof_cstr);
+make_fastmap_directives(AtomMeshId, Atom, MeshId, adt_compare_primitive, adt_hashof_atom);
 make_fastvec_directives(Mesh, Mesh);
 make_fastvec_directives(Vec3, Vec3);
 make_fastvec_directives(Vec2, Vec2);
 
-RawMesh *mesh_raw_from_obj(const char *p)
+// one face corner, indices into the position, coord and normal lists, -1 where the face leaves one out
+typedef struct
 {
-    size_t cursor = 0;
-    StrView line;
-    StrView pt = resolve_stack(p);
-    FILE *f = fopen(pt.string, "r");
-    xxfreestack(pt.string);
-    RawMesh *mesh = NULL;
-    if (f != NULL)
-    {
-        Fastvec_Vec3 *positions = fastvec_Vec3_init(2);
-        Fastvec_Vec3 *normals = fastvec_Vec3_init(2);
-        Fastvec_Vec2 *coords = fastvec_Vec2_init(2);
+    int32_t position;
+    int32_t coords;
+    int32_t normal;
+} ObjCorner;
+
+static inline int obj_corner_compare(ObjCorner a, ObjCorner b)
+{
+    return memcmp(&a, &b, sizeof(ObjCorner));
+}
+
+static inline uint64_t obj_corner_hash(ObjCorner key, uint64_t seed)
+{
+    return hash64_12(&key, seed);
+}
+
+make_fastmap_directives(ObjCorner, ObjCorner, int32_t, obj_corner_compare, obj_corner_hash);
+
+// corners per face, longer faces are rejected
+#define OBJ_MAX_CORNERS 64
+
+static inline bool obj_is(StrView token, const char *keyword)
+{
+    size_t length = strlen(keyword);
+    return token.length == length && memcmp(token.string, keyword, length) == 0;
+}
 
-#define SAFE_RETURN()                \
-    fastvec_Vec3_destroy(positions); \
-    fastvec_Vec3_destroy(normals);   \
-    fastvec_Vec2_destroy(coords);    \
-    fclose(f);                       \
-    xxfreestack(line.string);
+// resolves a one based or negative obj index against a list of n items, -1 when out of range
+static inline int32_t obj_index(long i, int n)
+{
+    long r = i < 0 ? n + i : i - 1;
+    return r >= 0 && r < n ? (int32_t)r : -1;
+}
 
-#define CLEAR_MESH() \
-    mesh_raw_free(mesh)
+// parses "p", "p/t", "p//n" or "p/t/n"
+static bool obj_corner(StrView token, int positions, int coords, int normals, ObjCorner *out)
+{
+    char *end;
+    out->position = obj_index(strtol(token.string, &end, 10), positions);
+    out->coords = -1;
+    out->normal = -1;
+    if (out->position < 0)
+        return false;
+    if (*end != '/')
+        return true;
+    if (end[1] != '/')
+    {
+        out->coords = obj_index(strtol(end + 1, &end, 10), coords);
+        if (out->coords < 0)
+            return false;
+        if (*end != '/')
+            return true;
+    }
+    else
+    {
+        end++;
+    }
+    out->normal = obj_index(strtol(end + 1, &end, 10), normals);
+    return out->normal >= 0;
+}
+
+// twice the signed area of a b c in the projection plane
+static inline float obj_area(Vec2 a, Vec2 b, Vec2 c)
+{
+    return (b.x - a.x) * (c.y - a.y) - (b.y - a.y) * (c.x - a.x);
+}
 
-        while ((line = readline_stack(f, &cursor)).string != NULL)
+// ear clips a face in the plane it faces the most, so concave faces come out right. writes
+// 3 * (n - 2) corner numbers in the winding of the face, the leftover of a degenerate face is fanned
+static void obj_triangulate(const Vec3 *points, int n, int *out)
+{
+    Vec3 normal = vec3_zero;
+    for (int i = 0; i < n; i++)
+    {
+        Vec3 a = points[i];
+        Vec3 b = points[(i + 1) % n];
+        normal.x += (a.y - b.y) * (a.z + b.z);
+        normal.y += (a.z - b.z) * (a.x + b.x);
+        normal.z += (a.x - b.x) * (a.y + b.y);
+    }
+    Vec3 magnitude = vec3(fabsf(normal.x), fabsf(normal.y), fabsf(normal.z));
+    Vec2 flat[OBJ_MAX_CORNERS];
+    float side;
+    for (int i = 0; i < n; i++)
+    {
+        Vec3 p = points[i];
+        if (magnitude.x >= magnitude.y && magnitude.x >= magnitude.z)
+            flat[i] = vec2(p.y, p.z);
+        else if (magnitude.y >= magnitude.z)
+            flat[i] = vec2(p.z, p.x);
+        else
+            flat[i] = vec2(p.x, p.y);
+    }
+    if (magnitude.x >= magnitude.y && magnitude.x >= magnitude.z)
+        side = normal.x < 0 ? -1 : 1;
+    else if (magnitude.y >= magnitude.z)
+        side = normal.y < 0 ? -1 : 1;
+    else
+        side = normal.z < 0 ? -1 : 1;
+
+    int remaining[OBJ_MAX_CORNERS];
+    for (int i = 0; i < n; i++)
+        remaining[i] = i;
+    int count = n;
+    int m = 0;
+    while (count > 3)
+    {
+        int ear = -1;
+        for (int i = 0; i < count && ear < 0; i++)
         {
-            StrView ft = str_first_token(line, ' ');
-            if (str_eq(ft, str("o")))
+            int a = remaining[(i + count - 1) % count];
+            int b = remaining[i];
+            int c = remaining[(i + 1) % count];
+            if (side * obj_area(flat[a], flat[b], flat[c]) <= 0)
+                continue;
+            bool inside = false;
+            for (int j = 0; j < count && !inside; j++)
             {
-                if (mesh != NULL)
-                {
-                    // do not allow multiple mesh per file
-                    SAFE_RETURN();
-                    return mesh;
-                }
-                // alloc mesh when object is found
-                mesh = xxmalloc(sizeof(RawMesh));
-                mesh->vertices = fastvec_MeshVertex_init(2);
-                mesh->indices = fastvec_MeshIndices_init(2);
+                int k = remaining[j];
+                if (k == a || k == b || k == c)
+                    continue;
+                inside = side * obj_area(flat[a], flat[b], flat[k]) >= 0 &&
+                         side * obj_area(flat[b], flat[c], flat[k]) >= 0 &&
+                         side * obj_area(flat[c], flat[a], flat[k]) >= 0;
             }
-            else if (str_eq(ft, str("v")))
+            if (!inside)
+                ear = i;
+        }
+        if (ear < 0)
+            break;
+        out[m++] = remaining[(ear + count - 1) % count];
+        out[m++] = remaining[ear];
+        out[m++] = remaining[(ear + 1) % count];
+        memmove(&remaining[ear], &remaining[ear + 1], (count - ear - 1) * sizeof(int));
+        count--;
+    }
+    for (int i = 1; i + 1 < count; i++)
+    {
+        out[m++] = remaining[0];
+        out[m++] = remaining[i];
+        out[m++] = remaining[i + 1];
+    }
+}
+
+// starts a submesh at the current end of the index buffer, an empty one is taken over instead
+static void obj_submesh(RawMesh *mesh, Atom object, Atom material)
+{
+    Submesh *last = mesh->submeshes->length > 0 ? fastvec_Submesh_top(mesh->submeshes) : NULL;
+    if (last == NULL || last->length > 0)
+    {
+        fastvec_Submesh_push(mesh->submeshes, (Submesh){object, material, mesh->indices->length, 0});
+        return;
+    }
+    last->object = object;
+    last->material = material;
+}
+
+RawMesh *mesh_raw_from_obj_text(StrView text)
+{
+    // a first pass over the line heads sizes every list up front
+    int counts[4] = {0};
+    for (char *it = text.string, *end = text.string + text.length; it < end; it++)
+    {
+        if (it[0] == 'v')
+            counts[it[1] == 't' ? 1 : it[1] == 'n' ? 2 : 0]++;
+        else if (it[0] == 'f')
+            counts[3]++;
+        it = memchr(it, '\n', end - it);
+        if (it == NULL)
+            break;
+    }
+
+    Fastvec_Vec3 *positions = fastvec_Vec3_init(2);
+    Fastvec_Vec2 *coords = fastvec_Vec2_init(2);
+    Fastvec_Vec3 *normals = fastvec_Vec3_init(2);
+    fastvec_Vec3_reserve(positions, counts[0]);
+    fastvec_Vec2_reserve(coords, counts[1]);
+    // faces without normals append a face normal of their own
+    fastvec_Vec3_reserve(normals, counts[2] + counts[3]);
+
+    RawMesh *mesh = (RawMesh *)xxmalloc(sizeof(RawMesh));
+    mesh->vertices = fastvec_MeshVertex_init(2);
+    mesh->indices = fastvec_MeshIndices_init(2);
+    mesh->submeshes = fastvec_Submesh_init(2);
+    fastvec_MeshVertex_reserve(mesh->vertices, counts[0]);
+    fastvec_MeshIndices_reserve(mesh->indices, counts[3] * 3);
+    Fastmap_ObjCorner *corners = fastmap_ObjCorner_init();
+
+    Atom object = ATOM_NONE;
+    Atom material = ATOM_NONE;
+    obj_submesh(mesh, object, material);
+
+    bool failed = false;
+    char *cursor = text.string;
+    char *end = text.string + text.length;
+    while (cursor < end && !failed)
+    {
+        // lines are cut in place, the text is terminated so the last one needs no special case
+        char *next = memchr(cursor, '\n', end - cursor);
+        if (next == NULL)
+            next = end;
+        *next = 0;
+        StrView line = strv(cursor, (uint32_t)(next - cursor));
+        cursor = next + 1;
+
+        StrView tokens[OBJ_MAX_CORNERS + 2];
+        int n = str_tokenize(line, tokens, OBJ_MAX_CORNERS + 2);
+        if (n == 0)
+            continue;
+        StrView ft = tokens[0];
+        if (obj_is(ft, "v") && n >= 4)
+        {
+            fastvec_Vec3_push(positions, vec3(str_tofloat(tokens[1]), str_tofloat(tokens[2]), str_tofloat(tokens[3])));
+        }
+        else if (obj_is(ft, "vt") && n >= 3)
+        {
+            fastvec_Vec2_push(coords, vec2(str_tofloat(tokens[1]), 1 - str_tofloat(tokens[2])));
+        }
+        else if (obj_is(ft, "vn") && n >= 4)
+        {
+            fastvec_Vec3_push(normals, vec3(str_tofloat(tokens[1]), str_tofloat(tokens[2]), str_tofloat(tokens[3])));
+        }
+        else if (obj_is(ft, "o"))
+        {
+            object = n > 1 ? atom_intern(tokens[1]) : ATOM_NONE;
+            obj_submesh(mesh, object, material);
+        }
+        else if (obj_is(ft, "usemtl"))
+        {
+            material = n > 1 ? atom_intern(tokens[1]) : ATOM_NONE;
+            obj_submesh(mesh, object, material);
+        }
+        else if (obj_is(ft, "f"))
+        {
+            int m = n - 1;
+            if (m < 3 || m > OBJ_MAX_CORNERS)
             {
-                // load vertex positions
-                StrView splits[5];
-                int n = str_splitchar(str_last_token(line, ' '), ' ', splits);
-                if (n == 3)
-                {
-                    str_truncate(splits, n);
-                    Vec3 p = vec3(str_tofloat(splits[0]), str_tofloat(splits[1]), str_tofloat(splits[2]));
-                    fastvec_Vec3_push(positions, p);
-                }
+                printf("mesh: face with %d corners\n", m);
+                failed = true;
+                break;
             }
-            else if (str_eq(ft, str("vn")))
+            ObjCorner face[OBJ_MAX_CORNERS];
+            Vec3 points[OBJ_MAX_CORNERS];
+            bool flat = false;
+            for (int i = 0; i < m; i++)
             {
-                // load normals
-                StrView splits[5];
-                int n = str_splitchar(str_last_token(line, ' '), ' ', splits);
-                if (n == 3)
+                if (!obj_corner(tokens[i + 1], positions->length, coords->length, normals->length, &face[i]))
                 {
-                    str_truncate(splits, n);
-                    Vec3 p = vec3(str_tofloat(splits[0]), str_tofloat(splits[1]), str_tofloat(splits[2]));
-                    fastvec_Vec3_push(normals, p);
+                    failed = true;
+                    break;
                 }
+                flat |= face[i].normal < 0;
+                points[i] = positions->vector[face[i].position];
             }
-            else if (str_eq(ft, str("vt")))
+            if (failed)
             {
-                // load tex coords
-                StrView splits[5];
-                int n = str_splitchar(str_last_token(line, ' '), ' ', splits);
-                if (n == 2)
-                {
-                    str_truncate(splits, n);
-                    float y = 1 - str_tofloat(splits[1]);
-                    Vec2 p = vec2(str_tofloat(splits[0]), y);
-                    fastvec_Vec2_push(coords, p);
-                }
+                printf("mesh: invalid face indices\n");
+                break;
             }
-            else if (str_eq(ft, str("f")))
-            {
 
-                // generate indices, mesh must be triangulated before import
-                StrView face_data[5];
-                int n = str_splitchar(str_last_token(line, ' '), ' ', face_data);
+            int order[(OBJ_MAX_CORNERS - 2) * 3];
+            obj_triangulate(points, m, order);
+            if (flat)
+            {
+                Vec3 a = points[order[0]], b = points[order[1]], c = points[order[2]];
+                fastvec_Vec3_push(normals, vec3_norm(vec3_cross(vec3_sub(b, a), vec3_sub(c, a))));
+                for (int i = 0; i < m; i++)
+                    face[i].normal = normals->length - 1;
+            }
 
-                for (int i = 0; i < n; i++)
+            // corners that repeat a position, coord and normal triplet share one vertex
+            int32_t vertex[OBJ_MAX_CORNERS];
+            for (int i = 0; i < m; i++)
+            {
+                FastmapNode_ObjCorner *node = fastmap_ObjCorner_get(corners, face[i]);
+                if (node == NULL)
                 {
-                    StrView splits[5];
-                    int m = str_splitchar(face_data[i], '/', splits);
-
-                    if (m != 3)
-                    {
-                        SAFE_RETURN();
-                        CLEAR_MESH();
-                        printf("mesh: invalid indices size\n");
-                        return NULL;
-                    }
-                    str_truncate(splits, m);
-
-                    long i0 = str_tolong(splits[0]);
-                    long i1 = str_tolong(splits[1]);
-                    long i2 = str_tolong(splits[2]);
-
                     MeshVertex vert;
-                    vert.position = positions->vector[i0 < 0 ? (positions->length + i0) : (i0 - 1)];
-                    vert.coords = coords->vector[i1 < 0 ? (coords->length + i1) : (i1 - 1)];
-                    vert.normal = normals->vector[i2 < 0 ? (normals->length + i2) : (i2 - 1)];
+                    vert.position = points[i];
+                    vert.coords = face[i].coords >= 0 ? coords->vector[face[i].coords] : vec2_zero;
+                    vert.normal = normals->vector[face[i].normal];
+                    node = fastmap_ObjCorner_put(corners, face[i]);
+                    node->value = mesh->vertices->length;
                     fastvec_MeshVertex_push(mesh->vertices, vert);
                 }
-                if (mesh->vertices->length == 0)
-                {
-                    SAFE_RETURN();
-                    CLEAR_MESH();
-                    printf("mesh: no vertices to create mesh\n");
-                    return NULL;
-                }
-                if (n == 3)
-                {
-                    int indices[] = {0, 1, 2};
-                    for (int i = 0; i < 3; i++)
-                    {
-                        int ind = (mesh->vertices->length - n) + indices[i];
-                        fastvec_MeshIndices_push(mesh->indices, ind);
-                    }
-                }
+                vertex[i] = node->value;
             }
-            xxfreestack(line.string);
+            for (int i = 0; i < (m - 2) * 3; i++)
+                fastvec_MeshIndices_push(mesh->indices, vertex[order[i]]);
+            fastvec_Submesh_top(mesh->submeshes)->length += (m - 2) * 3;
         }
-        SAFE_RETURN();
     }
+
+    fastvec_Vec3_destroy(positions);
+    fastvec_Vec2_destroy(coords);
+    fastvec_Vec3_destroy(normals);
+    fastmap_ObjCorner_destroy(corners);
+
+    if (!failed && mesh->indices->length == 0)
+    {
+        printf("mesh: no faces to create mesh\n");
+        failed = true;
+    }
+    if (failed)
+    {
+        mesh_raw_free(mesh);
+        return NULL;
+    }
+    // a trailing object or material switch with no faces after it
+    if (fastvec_Submesh_top(mesh->submeshes)->length == 0)
+        mesh->submeshes->length--;
     return mesh;
 }
 
-void *mesh_raw_free(RawMesh *ptr)
+RawMesh *mesh_raw_from_obj(const char *p)
+{
+    StrView path = resolve_stack(p);
+    StrView text = readfile_heap(path.string);
+    xxfreestack(path.string);
+    if (text.string == NULL)
+        return NULL;
+    RawMesh *mesh = mesh_raw_from_obj_text(text);
+    xxfree(text.string, text.length + 1);
+    return mesh;
+}
+
+void mesh_raw_free(RawMesh *ptr)
 {
     if (ptr != NULL)
     {
         fastvec_MeshVertex_destroy(ptr->vertices);
         fastvec_MeshIndices_destroy(ptr->indices);
+        fastvec_Submesh_destroy(ptr->submeshes);
         xxfree(ptr, sizeof(RawMesh));
     }
 }
 
+// vertex and index data ready for upload, parsed from the obj or mapped from its binary cache
 typedef struct
 {
-    Fastmap_StrMeshId *indices;
-    Fastvec_Mesh *meshes;
-} MeshContext;
+    const MeshVertex *vertices;
+    const int32_t *indices;
+    const Submesh *submeshes;
+    uint32_t vertexCount;
+    uint32_t indexCount;
+    uint32_t submeshCount;
+    BBox bounds;
+    // owns the arrays when the obj was parsed
+    RawMesh *raw;
+    // owns them when the cache was mapped, the submeshes are rebuilt since atoms do not outlive the process
+    void *mapping;
+    size_t mappingSize;
+} MeshData;
+
+// binary cache compiled next to the obj on first load, vertices and indices sit in it exactly as
+// they are uploaded so a cached mesh goes from the page cache to the driver without a copy
+#define MESH_CACHE_MAGIC 0x4853454Du
+#define MESH_CACHE_VERSION 3
+#define MESH_CACHE_ALIGN 64
+#define MESH_CACHE_EXTENSION ".mesh"
 
-static MeshContext *self;
+typedef struct
+{
+    uint32_t magic;
+    uint32_t version;
+    uint32_t vertexSize;
+    uint32_t vertexCount;
+    uint32_t indexCount;
+    uint32_t submeshCount;
+    // the obj it was compiled from, a different size or modification time in nanoseconds invalidates it
+    uint64_t sourceSize;
+    int64_t sourceTime;
+    uint64_t vertexOffset;
+    uint64_t indexOffset;
+    uint64_t submeshOffset;
+    uint64_t stringOffset;
+    uint64_t stringSize;
+    BBox bounds;
+} MeshCacheHeader;
+
+// names are offsets into the string table plus one, 0 for none
+typedef struct
+{
+    uint32_t offset;
+    uint32_t length;
+    uint32_t object;
+    uint32_t material;
+} MeshCacheSubmesh;
 
-void mesh_init()
+static _Atomic uint32_t mesh_cache_serial = 0;
+
+static inline uint64_t mesh_cache_align(uint64_t offset)
 {
-    self = (MeshContext *)xxarena(sizeof(MeshContext));
-    self->indices = fastmap_StrMeshId_init();
-    self->meshes = fastvec_Mesh_init(2);
+    return (offset + MESH_CACHE_ALIGN - 1) & ~(uint64_t)(MESH_CACHE_ALIGN - 1);
 }
 
-Mesh *mesh_load(const char *name, const char *p)
+// whole seconds miss an obj rewritten within the same second as the cache
+static inline int64_t mesh_cache_time(const struct stat *source)
 {
-    FastmapNode_StrMeshId *node = fastmap_StrMeshId_get(self->indices, name);
-    if (node != NULL)
-        return &self->meshes->vector[node->value];
+    return (int64_t)source->st_mtim.tv_sec * 1000000000 + source->st_mtim.tv_nsec;
+}
 
-    Mesh mesh;
-    mesh.name = name;
-    mesh.id = self->indices->length;
+// model.obj becomes model.mesh, other names get the extension appended
+static char *mesh_cache_path(const char *path, size_t *size)
+{
+    size_t length = strlen(path);
+    if (length > 4 && strcmp(path + length - 4, ".obj") == 0)
+        length -= 4;
+    *size = length + sizeof(MESH_CACHE_EXTENSION);
+    char *out = (char *)xxmalloc(*size);
+    memcpy(out, path, length);
+    memcpy(out + length, MESH_CACHE_EXTENSION, sizeof(MESH_CACHE_EXTENSION));
+    return out;
+}
 
-    RawMesh *raw = mesh_raw_from_obj(p);
+static Atom mesh_cache_name(const char *strings, uint64_t size, uint32_t name)
+{
+    if (name == 0 || name > size)
+        return ATOM_NONE;
+    const char *it = strings + name - 1;
+    size_t length = strnlen(it, strings + size - it);
+    return atom_intern(strv((char *)it, (uint32_t)length));
+}
+
+static bool mesh_cache_map(const char *cache, const struct stat *source, MeshData *out)
+{
+    int fd = open(cache, O_RDONLY);
+    if (fd < 0)
+        return false;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(MeshCacheHeader))
+    {
+        close(fd);
+        return false;
+    }
+    size_t size = (size_t)st.st_size;
+    void *mapping = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (mapping == MAP_FAILED)
+        return false;
+
+    const MeshCacheHeader *header = (const MeshCacheHeader *)mapping;
+    uint64_t vertexEnd = header->vertexOffset + (uint64_t)header->vertexCount * sizeof(MeshVertex);
+    uint64_t indexEnd = header->indexOffset + (uint64_t)header->indexCount * sizeof(int32_t);
+    uint64_t submeshEnd = header->submeshOffset + (uint64_t)header->submeshCount * sizeof(MeshCacheSubmesh);
+    if (header->magic != MESH_CACHE_MAGIC ||
+        header->version != MESH_CACHE_VERSION ||
+        header->vertexSize != sizeof(MeshVertex) ||
+        header->sourceSize != (uint64_t)source->st_size ||
+        header->sourceTime != mesh_cache_time(source) ||
+        header->vertexOffset < sizeof(MeshCacheHeader) ||
+        header->vertexOffset % MESH_CACHE_ALIGN != 0 ||
+        header->indexOffset % MESH_CACHE_ALIGN != 0 ||
+        header->submeshOffset % MESH_CACHE_ALIGN != 0 ||
+        vertexEnd > header->indexOffset ||
+        indexEnd > header->submeshOffset ||
+        submeshEnd > header->stringOffset ||
+        header->stringOffset + header->stringSize > size)
+    {
+        munmap(mapping, size);
+        return false;
+    }
+
+    // start reading it in now, the checks below and the upload on the main thread then find it resident
+    posix_madvise(mapping, size, POSIX_MADV_WILLNEED);
+
+    // the buffers go to the driver as they are, so a truncated or corrupt cache must not reach
+    // past the index buffer or the vertex buffer. failing sends it back to the obj and rewrites it
+    const uint8_t *base = (const uint8_t *)mapping;
+    const MeshCacheSubmesh *records = (const MeshCacheSubmesh *)(base + header->submeshOffset);
+    const int32_t *indices = (const int32_t *)(base + header->indexOffset);
+    bool valid = true;
+    for (uint32_t i = 0; i < header->submeshCount && valid; i++)
+        valid = (uint64_t)records[i].offset + records[i].length <= header->indexCount;
+    for (uint32_t i = 0; i < header->indexCount && valid; i++)
+        valid = (uint32_t)indices[i] < header->vertexCount;
+    if (!valid)
+    {
+        munmap(mapping, size);
+        return false;
+    }
+
+    const char *strings = (const char *)(base + header->stringOffset);
+    Submesh *submeshes = (Submesh *)xxmalloc(header->submeshCount * sizeof(Submesh));
+    for (uint32_t i = 0; i < header->submeshCount; i++)
+    {
+        submeshes[i].object = mesh_cache_name(strings, header->stringSize, records[i].object);
+        submeshes[i].material = mesh_cache_name(strings, header->stringSize, records[i].material);
+        submeshes[i].offset = records[i].offset;
+        submeshes[i].length = records[i].length;
+    }
+
+    out->vertices = (const MeshVertex *)(base + header->vertexOffset);
+    out->indices = indices;
+    out->submeshes = submeshes;
+    out->vertexCount = header->vertexCount;
+    out->indexCount = header->indexCount;
+    out->submeshCount = header->submeshCount;
+    out->bounds = header->bounds;
+    out->mapping = mapping;
+    out->mappingSize = size;
+    return true;
+}
+
+static bool mesh_cache_pad(FILE *f, uint64_t offset)
+{
+    static const uint8_t zero[MESH_CACHE_ALIGN] = {0};
+    long at = ftell(f);
+    return at >= 0 && (uint64_t)at <= offset && fwrite(zero, 1, offset - at, f) == offset - at;
+}
+
+// appends a name to the string table, returns its offset plus one
+static uint32_t mesh_cache_string(char *strings, uint64_t *size, Atom atom)
+{
+    if (atom == ATOM_NONE)
+        return 0;
+    StrView name = atom_str(atom);
+    uint32_t offset = (uint32_t)*size;
+    memcpy(strings + offset, name.string, name.length);
+    strings[offset + name.length] = 0;
+    *size += name.length + 1;
+    return offset + 1;
+}
+
+// written to a private name and renamed into place, so readers never see a partial cache
+static void mesh_cache_write(const char *cache, const struct stat *source, const MeshData *data)
+{
+    MeshCacheHeader header;
+    memset(&header, 0, sizeof(header));
+    header.magic = MESH_CACHE_MAGIC;
+    header.version = MESH_CACHE_VERSION;
+    header.vertexSize = sizeof(MeshVertex);
+    header.vertexCount = data->vertexCount;
+    header.indexCount = data->indexCount;
+    header.submeshCount = data->submeshCount;
+    header.sourceSize = (uint64_t)source->st_size;
+    header.sourceTime = mesh_cache_time(source);
+    header.vertexOffset = mesh_cache_align(sizeof(MeshCacheHeader));
+    header.indexOffset = mesh_cache_align(header.vertexOffset + (uint64_t)data->vertexCount * sizeof(MeshVertex));
+    header.submeshOffset = mesh_cache_align(header.indexOffset + (uint64_t)data->indexCount * sizeof(int32_t));
+    header.stringOffset = header.submeshOffset + (uint64_t)data->submeshCount * sizeof(MeshCacheSubmesh);
+    header.bounds = data->bounds;
+
+    size_t capacity = 0;
+    for (uint32_t i = 0; i < data->submeshCount; i++)
+        capacity += atom_str(data->submeshes[i].object).length + atom_str(data->submeshes[i].material).length + 2;
+    size_t recordBytes = data->submeshCount * sizeof(MeshCacheSubmesh);
+    MeshCacheSubmesh *records = (MeshCacheSubmesh *)xxmalloc(recordBytes + capacity + 1);
+    char *strings = (char *)(records + data->submeshCount);
+    for (uint32_t i = 0; i < data->submeshCount; i++)
+    {
+        records[i].offset = data->submeshes[i].offset;
+        records[i].length = data->submeshes[i].length;
+        records[i].object = mesh_cache_string(strings, &header.stringSize, data->submeshes[i].object);
+        records[i].material = mesh_cache_string(strings, &header.stringSize, data->submeshes[i].material);
+    }
+
+    char temp[4 * KILOBYTES];
+    snprintf(temp, sizeof(temp), "%s.%d.%u", cache, (int)getpid(), atomic_fetch_add(&mesh_cache_serial, 1));
+    FILE *f = fopen(temp, "wb");
+    bool ok = f != NULL &&
+              fwrite(&header, sizeof(header), 1, f) == 1 &&
+              mesh_cache_pad(f, header.vertexOffset) &&
+              fwrite(data->vertices, sizeof(MeshVertex), data->vertexCount, f) == data->vertexCount &&
+              mesh_cache_pad(f, header.indexOffset) &&
+              fwrite(data->indices, sizeof(int32_t), data->indexCount, f) == data->indexCount &&
+              mesh_cache_pad(f, header.submeshOffset) &&
+              fwrite(records, 1, recordBytes + header.stringSize, f) == recordBytes + header.stringSize;
+    xxfree(records, recordBytes + capacity + 1);
+    if (f == NULL)
+        return;
+    ok = fclose(f) == 0 && ok;
+    if (!ok || rename(temp, cache) != 0)
+        remove(temp);
+}
+
+// maps the binary cache when it matches the obj, otherwise parses the obj and compiles the cache.
+// takes a resolved path and stays off the stack allocator, so workers can call it
+static MeshData *mesh_data_open(const char *path)
+{
+    struct stat source;
+    if (stat(path, &source) != 0)
+        return NULL;
+
+    MeshData *data = (MeshData *)xxmalloc(sizeof(MeshData));
+    memset(data, 0, sizeof(MeshData));
+    size_t cacheSize;
+    char *cache = mesh_cache_path(path, &cacheSize);
+    if (mesh_cache_map(cache, &source, data))
+    {
+        xxfree(cache, cacheSize);
+        return data;
+    }
+
+    StrView text = readfile_heap(path);
+    RawMesh *raw = text.string != NULL ? mesh_raw_from_obj_text(text) : NULL;
+    if (text.string != NULL)
+        xxfree(text.string, text.length + 1);
+    if (raw == NULL)
+    {
+        xxfree(cache, cacheSize);
+        xxfree(data, sizeof(MeshData));
+        return NULL;
+    }
+
+    data->raw = raw;
+    data->vertices = raw->vertices->vector;
+    data->indices = raw->indices->vector;
+    data->submeshes = raw->submeshes->vector;
+    data->vertexCount = raw->vertices->length;
+    data->indexCount = raw->indices->length;
+    data->submeshCount = raw->submeshes->length;
+    data->bounds = bbox_empty;
+    for (uint32_t i = 0; i < data->vertexCount; i++)
+    {
+        data->bounds.min = vec3_min(data->bounds.min, data->vertices[i].position);
+        data->bounds.max = vec3_max(data->bounds.max, data->vertices[i].position);
+    }
+    mesh_cache_write(cache, &source, data);
+    xxfree(cache, cacheSize);
+    return data;
+}
 
-    glGenVertexArrays(1, &mesh.vao);
-    glGenBuffers(1, &mesh.vbo);
-    glGenBuffers(1, &mesh.ebo);
+static void mesh_data_close(MeshData *data)
+{
+    if (data->mapping != NULL)
+    {
+        xxfree((void *)data->submeshes, data->submeshCount * sizeof(Submesh));
+        munmap(data->mapping, data->mappingSize);
+    }
+    mesh_raw_free(data->raw);
+    xxfree(data, sizeof(MeshData));
+}
 
-    glBindVertexArray(mesh.vao);
-    glBindBuffer(GL_ARRAY_BUFFER, mesh.vbo);
-    glBufferData(GL_ARRAY_BUFFER, raw->vertices->length * sizeof(MeshVertex), raw->vertices->vector, GL_STATIC_DRAW);
+typedef struct
+{
+    Fastmap_AtomMeshId *indices;
+    Fastvec_Mesh *meshes;
+    Mesh placeholder;
+} MeshContext;
 
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mesh.ebo);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, raw->indices->length * sizeof(int), raw->indices->vector, GL_STATIC_DRAW);
+static MeshContext *self;
+
+static void mesh_upload(Mesh *mesh, const MeshData *data)
+{
+    glGenVertexArrays(1, &mesh->vao);
+    glGenBuffers(1, &mesh->vbo);
+    glGenBuffers(1, &mesh->ebo);
+
+    glBindVertexArray(mesh->vao);
+    glBindBuffer(GL_ARRAY_BUFFER, mesh->vbo);
+    glBufferData(GL_ARRAY_BUFFER, data->vertexCount * sizeof(MeshVertex), data->vertices, GL_STATIC_DRAW);
+
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mesh->ebo);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, data->indexCount * sizeof(int32_t), data->indices, GL_STATIC_DRAW);
 
     glEnableVertexAttribArray(0);
     glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(MeshVertex), (void *)offsetof(MeshVertex, position));
@@ -203,19 +690,146 @@ Mesh *mesh_load(const char *name, const char *p)
     glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(MeshVertex), (void *)offsetof(MeshVertex, coords));
     glBindVertexArray(0);
 
-    mesh.length = raw->indices->length;
+    mesh->length = data->indexCount;
+    mesh->submeshCount = data->submeshCount;
+    mesh->submeshes = (Submesh *)xxmalloc(data->submeshCount * sizeof(Submesh));
+    memcpy(mesh->submeshes, data->submeshes, data->submeshCount * sizeof(Submesh));
+    mesh->bounds = data->bounds;
+    mesh->ready = true;
+    mesh->ticket = LOAD_NONE;
+}
+
+static void mesh_release_buffers(Mesh *m)
+{
+    // entries still waiting on the loader share the placeholder buffers
+    if (m->vao == self->placeholder.vao)
+        return;
+    glDeleteVertexArrays(1, &m->vao);
+    glDeleteBuffers(1, &m->vbo);
+    glDeleteBuffers(1, &m->ebo);
+    xxfree(m->submeshes, m->submeshCount * sizeof(Submesh));
+}
+
+static void *mesh_decode(const char *path, size_t *bytes)
+{
+    MeshData *data = mesh_data_open(path);
+    if (data != NULL)
+        *bytes = data->vertexCount * sizeof(MeshVertex) + data->indexCount * sizeof(int32_t);
+    return data;
+}
+
+static void mesh_upload_loaded(int32_t target, void *data)
+{
+    Mesh *mesh = &self->meshes->vector[target];
+    if (data != NULL)
+    {
+        mesh_upload(mesh, (MeshData *)data);
+        return;
+    }
+    // a failed load keeps drawing the placeholder
+    printf("mesh: failed to load %s\n", mesh->name);
+    mesh->ready = true;
+    mesh->ticket = LOAD_NONE;
+}
+
+static void mesh_release(void *data)
+{
+    mesh_data_close((MeshData *)data);
+}
 
-    mesh_raw_free(raw);
+static const LoadHandler mesh_handler = {mesh_decode, mesh_upload_loaded, mesh_release};
+
+void mesh_init()
+{
+    self = (MeshContext *)xxarena(sizeof(MeshContext));
+    self->indices = fastmap_AtomMeshId_init();
+    self->meshes = fastvec_Mesh_init(2);
+
+    // unit quad facing +z, shown by meshes that are still loading
+    MeshVertex vertices[4];
+    const float corners[4][2] = {{-0.5f, -0.5f}, {0.5f, -0.5f}, {0.5f, 0.5f}, {-0.5f, 0.5f}};
+    for (int i = 0; i < 4; i++)
+    {
+        vertices[i].position = vec3(corners[i][0], corners[i][1], 0);
+        vertices[i].normal = vec3(0, 0, 1);
+        vertices[i].coords = vec2(corners[i][0] + 0.5f, 0.5f - corners[i][1]);
+    }
+    const int32_t indices[] = {0, 1, 2, 0, 2, 3};
+    const Submesh submesh = {ATOM_NONE, ATOM_NONE, 0, 6};
+    MeshData quad = {vertices, indices, &submesh, 4, 6, 1, bbox(vec3(-0.5f, -0.5f, 0), vec3(0.5f, 0.5f, 0)), NULL, NULL, 0};
+    mesh_upload(&self->placeholder, &quad);
+}
 
+// a new entry that draws the placeholder until its model is uploaded
+static Mesh *mesh_entry(Atom atom)
+{
+    Mesh mesh = self->placeholder;
+    mesh.id = self->meshes->length;
+    mesh.atom = atom;
+    mesh.name = cstr(atom_str(atom));
+    mesh.ready = false;
+    mesh.ticket = LOAD_NONE;
     fastvec_Mesh_push(self->meshes, mesh);
-    node = fastmap_StrMeshId_put(self->indices, name);
+    FastmapNode_AtomMeshId *node = fastmap_AtomMeshId_put(self->indices, atom);
     node->value = mesh.id;
     return &self->meshes->vector[mesh.id];
 }
 
+Mesh *mesh_load(const char *name, const char *p)
+{
+    Atom atom = atom_intern_cstr(name);
+    FastmapNode_AtomMeshId *node = fastmap_AtomMeshId_get(self->indices, atom);
+    if (node != NULL)
+    {
+        mesh_wait(node->value);
+        return &self->meshes->vector[node->value];
+    }
+
+    StrView path = resolve_stack(p);
+    MeshData *data = mesh_data_open(path.string);
+    xxfreestack(path.string);
+    if (data == NULL)
+        return NULL;
+    Mesh *mesh = mesh_entry(atom);
+    mesh_upload(mesh, data);
+    mesh_data_close(data);
+    return mesh;
+}
+
+MeshId mesh_request(const char *name, const char *p)
+{
+    Atom atom = atom_intern_cstr(name);
+    FastmapNode_AtomMeshId *node = fastmap_AtomMeshId_get(self->indices, atom);
+    if (node != NULL)
+        return node->value;
+    MeshId id = mesh_entry(atom)->id;
+    LoadTicket ticket = loader_request(&mesh_handler, p, id);
+    // the loader may have uploaded it already when it had to decode in place
+    Mesh *mesh = &self->meshes->vector[id];
+    if (!mesh->ready)
+        mesh->ticket = ticket;
+    return id;
+}
+
+bool mesh_is_ready(MeshId id)
+{
+    return mesh_has(id) && self->meshes->vector[id].ready;
+}
+
+void mesh_wait(MeshId id)
+{
+    if (mesh_has(id) && !self->meshes->vector[id].ready)
+        loader_wait(self->meshes->vector[id].ticket);
+}
+
 Mesh *mesh_get_byname(const char *name)
 {
-    FastmapNode_StrMeshId *node = fastmap_StrMeshId_get(self->indices, name);
+    return mesh_get_byatom(atom_find_cstr(name));
+}
+
+Mesh *mesh_get_byatom(Atom atom)
+{
+    FastmapNode_AtomMeshId *node = fastmap_AtomMeshId_get(self->indices, atom);
     if (node == NULL)
         return NULL;
     return &self->meshes->vector[node->value];
@@ -236,11 +850,11 @@ void mesh_clear()
     for (int i = 0; i < self->meshes->length; i++)
     {
         Mesh *m = &self->meshes->vector[i];
-        glDeleteVertexArrays(1, &m->vao);
-        glDeleteBuffers(1, &m->vbo);
-        glDeleteBuffers(1, &m->ebo);
+        if (!m->ready)
+            loader_cancel(m->ticket);
+        mesh_release_buffers(m);
     }
-    fastmap_StrMeshId_clear(self->indices);
+    fastmap_AtomMeshId_clear(self->indices);
     fastvec_Mesh_clear(self->meshes);
 }
 
@@ -249,10 +863,14 @@ void mesh_destroy()
     for (int i = 0; i < self->meshes->length; i++)
     {
         Mesh *m = &self->meshes->vector[i];
-        glDeleteVertexArrays(1, &m->vao);
-        glDeleteBuffers(1, &m->vbo);
-        glDeleteBuffers(1, &m->ebo);
+        if (!m->ready)
+            loader_cancel(m->ticket);
+        mesh_release_buffers(m);
     }
-    fastmap_StrMeshId_destroy(self->indices);
+    glDeleteVertexArrays(1, &self->placeholder.vao);
+    glDeleteBuffers(1, &self->placeholder.vbo);
+    glDeleteBuffers(1, &self->placeholder.ebo);
+    xxfree(self->placeholder.submeshes, self->placeholder.submeshCount * sizeof(Submesh));
+    fastmap_AtomMeshId_destroy(self->indices);
     fastvec_Mesh_destroy(self->meshes);
 }
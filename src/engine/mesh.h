@@ -3,9 +3,12 @@
 
 #include "math/vec3.h"
 #include "math/vec2.h"
+#include "math/bbox.h"
 #include "adt/fastvec.h"
 #include "adt/fastmap.h"
 #include "adt/common.h"
+#include "adt/str.h"
+#include "loader.h"
 
 typedef struct
 {
@@ -17,34 +20,70 @@ typedef struct
 make_fastvec_directives(MeshVertex, MeshVertex);
 make_fastvec_directives(MeshIndices, int32_t);
 
+// a run of the index buffer, the obj importer starts one at every object and material switch
+typedef struct
+{
+    Atom object;
+    Atom material;
+    uint32_t offset;
+    uint32_t length;
+} Submesh;
+
+make_fastvec_directives(Submesh, Submesh);
+
 typedef struct
 {
     Fastvec_MeshVertex *vertices;
     Fastvec_MeshIndices *indices;
+    Fastvec_Submesh *submeshes;
 } RawMesh;
 
 RawMesh *mesh_raw_from_obj(const char *p);
 
-void *mesh_raw_free(RawMesh *ptr);
+// parses obj text in place, it does not touch the stack allocator so workers can call it.
+// corners repeating a position, coord and normal share a vertex, faces of any size are triangulated
+// and faces without normals get a flat one
+RawMesh *mesh_raw_from_obj_text(StrView text);
+
+void mesh_raw_free(RawMesh *ptr);
 
 typedef int32_t MeshId;
 
 typedef struct
 {
     MeshId id;
+    Atom atom;
     const char *name;
     uint32_t vao;
     uint32_t vbo;
     uint32_t ebo;
     uint32_t length;
+    // index ranges of the model, length spans all of them
+    Submesh *submeshes;
+    uint32_t submeshCount;
+    BBox bounds;
+    // false while the model loads, the entry draws a placeholder quad until then
+    bool ready;
+    LoadTicket ticket;
 } Mesh;
 
 void mesh_init();
 
+// loads and uploads the model before returning. the parsed obj is compiled into a binary cache
+// next to it, later loads map that cache instead while the obj keeps its size and modification time
 Mesh *mesh_load(const char *name, const char *p);
 
+// queues the model on the loader, the id resolves to a placeholder right away and is filled in once uploaded
+MeshId mesh_request(const char *name, const char *p);
+
+bool mesh_is_ready(MeshId id);
+
+void mesh_wait(MeshId id);
+
 Mesh *mesh_get_byname(const char *name);
 
+Mesh *mesh_get_byatom(Atom atom);
+
 Mesh *mesh_get(int id);
 
 bool mesh_has(int id);
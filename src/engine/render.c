@@ -0,0 +1,346 @@
+#include "render.h"
+
+#include <string.h>
+
+#define GLFW_INCLUDE_NONE
+#include <GLFW/glfw3.h>
+#include "glad.h"
+
+#include "mem/alloc.h"
+#include "adt/fastvec.h"
+
+enum
+{
+    texture_units = 8,
+    // textures whose filters are remembered within a frame
+    filter_slots = 32,
+};
+
+// a field holding this has not been set since the cache was reset
+#define RENDER_UNKNOWN 0xFFFFFFFFu
+
+typedef struct
+{
+    uint64_t key;
+    RenderExecute execute;
+    const void *data;
+} RenderCommand;
+
+make_fastvec_directives(RenderCommand, RenderCommand);
+
+typedef struct
+{
+    uint32_t texture;
+    int min;
+    int mag;
+} RenderFilter;
+
+typedef struct
+{
+    uint32_t blend;
+    uint32_t depthTest;
+    uint32_t cull;
+    uint32_t blendSrc;
+    uint32_t blendDst;
+    uint32_t depthFunc;
+    uint32_t cullFace;
+    uint32_t frontFace;
+    float lineWidth;
+    uint32_t program;
+    uint32_t vao;
+    uint32_t activeUnit;
+    uint32_t textures[texture_units];
+    uint32_t arrays[texture_units];
+    RenderFilter filters[filter_slots];
+    int filterCount;
+} RenderState;
+
+typedef struct
+{
+    Fastvec_RenderCommand *commands;
+    Fastvec_RenderCommand *scratch;
+    RenderState state;
+    RenderStats current;
+    RenderStats last;
+} RenderContext;
+
+static RenderContext *self = NULL;
+
+static void render_reset()
+{
+    memset(&self->state, 0xFF, sizeof(RenderState));
+    self->state.lineWidth = -1;
+    self->state.filterCount = 0;
+}
+
+void render_init()
+{
+    self = (RenderContext *)xxarena(sizeof(RenderContext));
+    memset(self, 0, sizeof(RenderContext));
+    self->commands = fastvec_RenderCommand_init(256);
+    self->scratch = fastvec_RenderCommand_init(256);
+    render_reset();
+}
+
+void render_destroy()
+{
+    fastvec_RenderCommand_destroy(self->commands);
+    fastvec_RenderCommand_destroy(self->scratch);
+    self = NULL;
+}
+
+void render_submit(uint64_t key, RenderExecute execute, const void *data, size_t size)
+{
+    void *copy = NULL;
+    if (size > 0)
+    {
+        copy = xxframe(size);
+        memcpy(copy, data, size);
+    }
+    fastvec_RenderCommand_push(self->commands, (RenderCommand){key, execute, copy});
+}
+
+// lsd radix sort over the key bytes, stable so equal keys keep their submission order.
+// a byte every key shares is skipped, which with few passes and shaders is most of them
+static void render_sort(RenderCommand *commands, RenderCommand *scratch, int n)
+{
+    uint32_t counts[8][256];
+    memset(counts, 0, sizeof(counts));
+    for (int i = 0; i < n; i++)
+    {
+        uint64_t key = commands[i].key;
+        for (int b = 0; b < 8; b++)
+            counts[b][(key >> (b * 8)) & 0xFF]++;
+    }
+
+    RenderCommand *src = commands;
+    RenderCommand *dst = scratch;
+    for (int b = 0; b < 8; b++)
+    {
+        int shift = b * 8;
+        uint32_t *count = counts[b];
+        if (count[(src[0].key >> shift) & 0xFF] == (uint32_t)n)
+            continue;
+        uint32_t offset = 0;
+        for (int i = 0; i < 256; i++)
+        {
+            uint32_t c = count[i];
+            count[i] = offset;
+            offset += c;
+        }
+        for (int i = 0; i < n; i++)
+            dst[count[(src[i].key >> shift) & 0xFF]++] = src[i];
+        RenderCommand *tmp = src;
+        src = dst;
+        dst = tmp;
+    }
+    if (src != commands)
+        memcpy(commands, src, n * sizeof(RenderCommand));
+}
+
+void render_flush()
+{
+    int n = self->commands->length;
+    memset(&self->current, 0, sizeof(RenderStats));
+    self->current.commands = n;
+
+    // anything outside the queue, imgui included, may have touched the context since the last flush
+    render_reset();
+    if (n > 0)
+    {
+        fastvec_RenderCommand_resize(self->scratch, n);
+        render_sort(self->commands->vector, self->scratch->vector, n);
+        for (int i = 0; i < n; i++)
+        {
+            RenderCommand *it = &self->commands->vector[i];
+            it->execute(it->data);
+        }
+    }
+    render_vao(0);
+    render_program(0);
+    fastvec_RenderCommand_clear(self->commands);
+
+    self->last = self->current;
+}
+
+RenderStats render_stats()
+{
+    return self->last;
+}
+
+#define render_cached(field, value) ({       \
+    bool __changed = (field) != (value);     \
+    if (__changed)                           \
+    {                                        \
+        (field) = (value);                   \
+        self->current.states++;              \
+    }                                        \
+    else                                     \
+    {                                        \
+        self->current.skipped++;             \
+    }                                        \
+    __changed;                               \
+})
+
+static inline void render_capability(uint32_t *field, GLenum cap, bool enabled)
+{
+    if (render_cached(*field, (uint32_t)enabled))
+    {
+        if (enabled)
+            glEnable(cap);
+        else
+            glDisable(cap);
+    }
+}
+
+void render_blend(bool enabled)
+{
+    render_capability(&self->state.blend, GL_BLEND, enabled);
+}
+
+void render_blend_func(uint32_t src, uint32_t dst)
+{
+    if (self->state.blendSrc == src && self->state.blendDst == dst)
+    {
+        self->current.skipped++;
+        return;
+    }
+    self->state.blendSrc = src;
+    self->state.blendDst = dst;
+    self->current.states++;
+    glBlendFunc(src, dst);
+}
+
+void render_depth_test(bool enabled)
+{
+    render_capability(&self->state.depthTest, GL_DEPTH_TEST, enabled);
+}
+
+void render_depth_func(uint32_t func)
+{
+    if (render_cached(self->state.depthFunc, func))
+        glDepthFunc(func);
+}
+
+void render_cull(bool enabled)
+{
+    render_capability(&self->state.cull, GL_CULL_FACE, enabled);
+}
+
+void render_cull_face(uint32_t face)
+{
+    if (render_cached(self->state.cullFace, face))
+        glCullFace(face);
+}
+
+void render_front_face(uint32_t mode)
+{
+    if (render_cached(self->state.frontFace, mode))
+        glFrontFace(mode);
+}
+
+void render_line_width(float width)
+{
+    if (render_cached(self->state.lineWidth, width))
+        glLineWidth(width);
+}
+
+void render_program(Shader program)
+{
+    if (render_cached(self->state.program, program))
+        glUseProgram(program);
+}
+
+void render_vao(uint32_t vao)
+{
+    if (render_cached(self->state.vao, vao))
+        glBindVertexArray(vao);
+}
+
+static inline void render_active_unit(uint32_t unit)
+{
+    if (self->state.activeUnit != unit)
+    {
+        self->state.activeUnit = unit;
+        self->current.states++;
+        glActiveTexture(GL_TEXTURE0 + unit);
+    }
+}
+
+void render_texture(uint32_t unit, uint32_t texture)
+{
+    if (self->state.textures[unit] == texture)
+    {
+        self->current.skipped++;
+        return;
+    }
+    render_active_unit(unit);
+    self->state.textures[unit] = texture;
+    self->current.states++;
+    glBindTexture(GL_TEXTURE_2D, texture);
+}
+
+void render_texture_array(uint32_t unit, uint32_t texture)
+{
+    if (self->state.arrays[unit] == texture)
+    {
+        self->current.skipped++;
+        return;
+    }
+    render_active_unit(unit);
+    self->state.arrays[unit] = texture;
+    self->current.states++;
+    glBindTexture(GL_TEXTURE_2D_ARRAY, texture);
+}
+
+void render_texture_filter(uint32_t texture, int min, int mag)
+{
+    RenderFilter *it = NULL;
+    for (int i = 0; i < self->state.filterCount; i++)
+    {
+        if (self->state.filters[i].texture == texture)
+        {
+            it = &self->state.filters[i];
+            break;
+        }
+    }
+    if (it && it->min == min && it->mag == mag)
+    {
+        self->current.skipped++;
+        return;
+    }
+    if (it == NULL && self->state.filterCount < filter_slots)
+        it = &self->state.filters[self->state.filterCount++];
+
+    uint32_t unit = self->state.activeUnit == RENDER_UNKNOWN ? 0 : self->state.activeUnit;
+    render_texture(unit, texture);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, min);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, mag);
+    self->current.states++;
+    if (it)
+        *it = (RenderFilter){texture, min, mag};
+}
+
+void render_draw_arrays(uint32_t mode, int first, int count)
+{
+    self->current.draws++;
+    glDrawArrays(mode, first, count);
+}
+
+void render_draw_elements(uint32_t mode, int count, uint32_t type, size_t offset)
+{
+    self->current.draws++;
+    glDrawElements(mode, count, type, (const void *)offset);
+}
+
+void render_draw_elements_base_vertex(uint32_t mode, int count, uint32_t type, size_t offset, int base)
+{
+    self->current.draws++;
+    glDrawElementsBaseVertex(mode, count, type, (const void *)offset, base);
+}
+
+void render_draw_elements_instanced(uint32_t mode, int count, uint32_t type, size_t offset, int instances)
+{
+    self->current.draws++;
+    glDrawElementsInstanced(mode, count, type, (const void *)offset, instances);
+}
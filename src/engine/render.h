@@ -0,0 +1,77 @@
+#ifndef cgame_RENDER_H
+#define cgame_RENDER_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+#include "shader.h"
+
+// passes run in this order, they are the top bits of every sort key
+typedef enum
+{
+    RENDER_PASS_BACKGROUND = 0,
+    RENDER_PASS_OPAQUE = 1,
+    RENDER_PASS_TRANSPARENT = 2,
+    RENDER_PASS_OVERLAY = 3,
+} RenderPass;
+
+// key layout from the most significant bit: pass 4 | shader 12 | texture 16 | mesh 16 | depth 16,
+// so commands sharing a program, then a texture, then a vertex array end up next to each other
+inline static uint64_t render_key(RenderPass pass, uint32_t shader, uint32_t texture, uint32_t mesh, uint32_t depth)
+{
+    return ((uint64_t)(pass & 0xF) << 60) |
+           ((uint64_t)(shader & 0xFFF) << 48) |
+           ((uint64_t)(texture & 0xFFFF) << 32) |
+           ((uint64_t)(mesh & 0xFFFF) << 16) |
+           (uint64_t)(depth & 0xFFFF);
+}
+
+typedef void (*RenderExecute)(const void *data);
+
+typedef struct
+{
+    int commands;
+    int draws;
+    // gl state calls that were issued, and the redundant ones the cache dropped
+    int states;
+    int skipped;
+} RenderStats;
+
+void render_init();
+
+void render_destroy();
+
+// data is copied into frame memory, callers can pass a struct on the stack
+void render_submit(uint64_t key, RenderExecute execute, const void *data, size_t size);
+
+// sorts the commands submitted this frame by key and executes them
+void render_flush();
+
+// counters of the last flushed frame
+RenderStats render_stats();
+
+// the cache is reset at the start of every flush, while commands execute all of this
+// state has to go through it or it falls out of sync with the context
+void render_blend(bool enabled);
+void render_blend_func(uint32_t src, uint32_t dst);
+void render_depth_test(bool enabled);
+void render_depth_func(uint32_t func);
+void render_cull(bool enabled);
+void render_cull_face(uint32_t face);
+void render_front_face(uint32_t mode);
+void render_line_width(float width);
+void render_program(Shader program);
+void render_vao(uint32_t vao);
+void render_texture(uint32_t unit, uint32_t texture);
+// a unit keeps one binding per target, so array textures are tracked apart from 2d ones
+void render_texture_array(uint32_t unit, uint32_t texture);
+// min and mag filter of a 2d texture, binds it to the active unit when they change
+void render_texture_filter(uint32_t texture, int min, int mag);
+
+void render_draw_arrays(uint32_t mode, int first, int count);
+void render_draw_elements(uint32_t mode, int count, uint32_t type, size_t offset);
+void render_draw_elements_base_vertex(uint32_t mode, int count, uint32_t type, size_t offset, int base);
+void render_draw_elements_instanced(uint32_t mode, int count, uint32_t type, size_t offset, int instances);
+
+#endif
@@ -1,6 +1,7 @@
 
 #include "shader.h"
 #include <stdio.h>
+#include <string.h>
 
 #define GLFW_INCLUDE_NONE
 #include <GLFW/glfw3.h>
@@ -8,6 +9,52 @@
 
 #include "file.h"
 #include "mem/alloc.h"
+#include "adt/fastmap.h"
+#include "adt/common.h"
+
+// keyed by program << 32 | atom of the uniform name
+make_fastmap_directives(ShaderLocation, uint64_t, int, adt_compare_primitive, adt_hashof_primitive);
+
+static Fastmap_ShaderLocation *shader_locations = NULL;
+// the table is released with the last program
+static int shader_programs = 0;
+
+static inline uint64_t shader_key(Shader p, Atom name)
+{
+    return ((uint64_t)p << 32) | name;
+}
+
+// active uniform names, with the [0] suffix of arrays dropped so they resolve by their plain name
+static void shader_reflect(Shader p, void (*callback)(Shader p, const char *name))
+{
+    GLint count = 0;
+    glGetProgramiv(p, GL_ACTIVE_UNIFORMS, &count);
+    char name[256];
+    for (GLint i = 0; i < count; i++)
+    {
+        GLsizei length = 0;
+        GLint size;
+        GLenum type;
+        glGetActiveUniform(p, (GLuint)i, sizeof(name), &length, &size, &type, name);
+        if (length > 3 && strcmp(name + length - 3, "[0]") == 0)
+            name[length - 3] = '\0';
+        callback(p, name);
+    }
+}
+
+static void shader_cache_add(Shader p, const char *name)
+{
+    // members of uniform blocks have no location
+    GLint location = glGetUniformLocation(p, name);
+    if (location < 0)
+        return;
+    fastmap_ShaderLocation_put(shader_locations, shader_key(p, atom_intern_cstr(name)))->value = location;
+}
+
+static void shader_cache_remove(Shader p, const char *name)
+{
+    fastmap_ShaderLocation_remove(shader_locations, shader_key(p, atom_find_cstr(name)));
+}
 
 Shader shader_create(const char *vs, const char *fs)
 {
@@ -50,6 +97,15 @@ Shader shader_create(const char *vs, const char *fs)
     glDeleteShader(vsp);
     glDeleteShader(fsp);
 
+    if (shader_locations == NULL)
+        shader_locations = fastmap_ShaderLocation_init();
+    shader_programs++;
+    shader_reflect(programId, shader_cache_add);
+
+    GLuint block = glGetUniformBlockIndex(programId, "Camera");
+    if (block != GL_INVALID_INDEX)
+        glUniformBlockBinding(programId, block, SHADER_CAMERA_BINDING);
+
     return programId;
 }
 
@@ -68,6 +124,14 @@ Shader shader_load(const char *vs, const char *fs)
 
 void shader_destroy(Shader p)
 {
+    if (p == 0)
+        return;
+    shader_reflect(p, shader_cache_remove);
+    if (--shader_programs == 0)
+    {
+        fastmap_ShaderLocation_destroy(shader_locations);
+        shader_locations = NULL;
+    }
     glDeleteProgram(p);
 }
 
@@ -82,37 +146,80 @@ void shader_end()
     glUseProgram(0);
 }
 
+int shader_location_atom(Shader p, Atom name)
+{
+    if (shader_locations == NULL || name == ATOM_NONE)
+        return -1;
+    FastmapNode_ShaderLocation *node = fastmap_ShaderLocation_get(shader_locations, shader_key(p, name));
+    return node ? node->value : -1;
+}
+
+int shader_location(Shader p, const char *name)
+{
+    return shader_location_atom(p, atom_find_cstr(name));
+}
+
 void shader_texture(Shader p, const char *name, int a)
 {
-    glUniform1i(glGetUniformLocation(p, name), a);
+    glUniform1i(shader_location(p, name), a);
 }
 
 void shader_int(Shader p, const char *name, int a)
 {
-    glUniform1i(glGetUniformLocation(p, name), a);
+    glUniform1i(shader_location(p, name), a);
 }
 
 void shader_vec2(Shader p, const char *name, const void *v)
 {
-    glUniform2fv(glGetUniformLocation(p, name), 1, (const float *)v);
+    glUniform2fv(shader_location(p, name), 1, (const float *)v);
 }
 
 void shader_vec3(Shader p, const char *name, const void *v)
 {
-    glUniform3fv(glGetUniformLocation(p, name), 1, (const float *)v);
+    glUniform3fv(shader_location(p, name), 1, (const float *)v);
 }
 
 void shader_vec4(Shader p, const char *name, const void *v)
 {
-    glUniform4fv(glGetUniformLocation(p, name), 1, (const float *)v);
+    glUniform4fv(shader_location(p, name), 1, (const float *)v);
 }
 
 void shader_mat4(Shader p, const char *name, const void *v)
 {
-    glUniformMatrix4fv(glGetUniformLocation(p, name), 1, GL_FALSE, (const float *)v);
+    glUniformMatrix4fv(shader_location(p, name), 1, GL_FALSE, (const float *)v);
 }
 
 void shader_float(Shader p, const char *name, float f)
 {
-    glUniform1f(glGetUniformLocation(p, name), f);
-}
\ No newline at end of file
+    glUniform1f(shader_location(p, name), f);
+}
+
+void shader_set_int(int location, int a)
+{
+    glUniform1i(location, a);
+}
+
+void shader_set_float(int location, float f)
+{
+    glUniform1f(location, f);
+}
+
+void shader_set_vec2(int location, const void *v)
+{
+    glUniform2fv(location, 1, (const float *)v);
+}
+
+void shader_set_vec3(int location, const void *v)
+{
+    glUniform3fv(location, 1, (const float *)v);
+}
+
+void shader_set_vec4(int location, const void *v)
+{
+    glUniform4fv(location, 1, (const float *)v);
+}
+
+void shader_set_mat4(int location, const void *v)
+{
+    glUniformMatrix4fv(location, 1, GL_FALSE, (const float *)v);
+}
@@ -3,13 +3,21 @@
 
 #include <stdint.h>
 
+#include "adt/atom.h"
+
 typedef uint32_t Shader;
 
+// uniform buffer binding of the std140 Camera block, programs declaring it are bound at link time
+#define SHADER_CAMERA_BINDING 0
+
 Shader shader_create(const char *vs, const char *fs);
 Shader shader_load(const char *vs, const char *fs);
 void shader_destroy(Shader p);
 void shader_begin(Shader p);
 void shader_end();
+// locations come from a table filled when the program is linked, -1 when the program has no such uniform
+int shader_location(Shader p, const char *name);
+int shader_location_atom(Shader p, Atom name);
 void shader_texture(Shader p, const char *name, int a);
 void shader_int(Shader p, const char *name, int a);
 void shader_vec2(Shader p, const char *name, const void *v);
@@ -17,5 +25,12 @@ void shader_vec3(Shader p, const char *name, const void *v);
 void shader_vec4(Shader p, const char *name, const void *v);
 void shader_mat4(Shader p, const char *name, const void *v);
 void shader_float(Shader p, const char *name, float f);
+// same setters for a location looked up once, for uniforms set on every draw
+void shader_set_int(int location, int a);
+void shader_set_float(int location, float f);
+void shader_set_vec2(int location, const void *v);
+void shader_set_vec3(int location, const void *v);
+void shader_set_vec4(int location, const void *v);
+void shader_set_mat4(int location, const void *v);
 
 #endif
\ No newline at end of file
@@ -1,6 +1,8 @@
 #include "sprite.h"
 
 #include <string.h>
+#include <stdlib.h>
+#include <stddef.h>
 
 #define GLFW_INCLUDE_NONE
 #include <GLFW/glfw3.h>
@@ -9,6 +11,7 @@
 #include "mem/alloc.h"
 #include "shader.h"
 #include "camera.h"
+#include "render.h"
 #include "math/rect.h"
 #include <stdio.h>
 
@@ -19,10 +22,54 @@ typedef struct
     Vec2 coord;
 } VertexData;
 
+// per instance attributes, laid out to match locations 3 to 9 of sprite.vs
+typedef struct
+{
+    Mat4 world;
+    Rect uv;
+    float threshold;
+    float layer;
+} SpriteInstance;
+
+// sprites sharing a key are drawn with one instanced call
+typedef struct
+{
+    uint64_t key;
+    int index;
+} SpriteDraw;
+
+// one instanced draw, executed from the render queue
+typedef struct
+{
+    Shader shader;
+    uint32_t texture;
+    Vec2 texSize;
+    uint32_t flags;
+    uint32_t vao;
+    uint32_t length;
+    int first;
+    int count;
+} SpriteBatch;
+
+make_fastvec_directives(SpriteInstance, SpriteInstance);
+make_fastvec_directives(SpriteDraw, SpriteDraw);
+
+#define SPRITE_ATTRIB_WORLD 3
+#define SPRITE_ATTRIB_UV 7
+#define SPRITE_ATTRIB_THRESHOLD 8
+#define SPRITE_ATTRIB_LAYER 9
+
 typedef struct
 {
     Shader shader;
-    Fastvec_Sprite *sprites;
+    int texSizeLocation;
+    int pixelartLocation;
+    Fastslot_Sprite *sprites;
+
+    uint32_t instanceVbo;
+    size_t instanceBytes;
+    Fastvec_SpriteInstance *instances;
+    Fastvec_SpriteDraw *draws;
 } SpriteContext;
 
 static SpriteContext *self = NULL;
@@ -32,49 +79,63 @@ SpriteId sprite_create(const char *model, const char *texture)
     Mesh *mesh = mesh_get_byname(model);
 
     if (mesh == NULL)
-        return -1;
+        return SPRITE_NONE;
 
     Texture *tex = atlas_get_byname(texture);
     if (tex == NULL)
-        return -1;
-    Sprite sp;
-    sp.id = self->sprites->length;
-    sp.position = vec3_zero;
-    sp.rotation = rot_zero;
-    sp.scale = vec3(1, 1, 1);
-    sp.mesh = mesh->id;
-    sp.tag = 0;
-
-    sp.material.texture = tex->id;
-    sp.material.mask_threshold = 0.5;
-    sp.material.flags = MAT_FLAG_TWO_SIDED | MAT_FLAG_PIXELART | MAT_FLAG_ALPHAMASK;
-    sp.material.cropped_area = rect(0, 0, 0, 0);
-    fastvec_Sprite_push(self->sprites, sp);
-    return sp.id;
+        return SPRITE_NONE;
+
+    SpriteId id;
+    Sprite *sp = fastslot_Sprite_emplace(self->sprites, &id);
+    if (sp == NULL)
+        return SPRITE_NONE;
+    sp->id = id;
+    sp->position = vec3_zero;
+    sp->rotation = rot_zero;
+    sp->scale = vec3(1, 1, 1);
+    sp->mesh = mesh->id;
+    sp->tag = 0;
+
+    sp->material.texture = tex->id;
+    sp->material.mask_threshold = 0.5;
+    sp->material.flags = MAT_FLAG_TWO_SIDED | MAT_FLAG_PIXELART | MAT_FLAG_ALPHAMASK;
+    sp->material.cropped_area = rect(0, 0, 0, 0);
+    return id;
 }
 
 void sprite_delete(SpriteId id)
 {
-    fastvec_Sprite_remove(self->sprites, id);
+    fastslot_Sprite_remove(self->sprites, id);
+}
+
+bool sprite_has(SpriteId id)
+{
+    return fastslot_Sprite_has(self->sprites, id);
 }
 
 Sprite *sprite_get(SpriteId id)
 {
-    return &self->sprites->vector[id];
+    return fastslot_Sprite_get(self->sprites, id);
 }
 void sprite_crop(SpriteId id, Rect r)
 {
-    Sprite *sp = &self->sprites->vector[id];
+    Sprite *sp = fastslot_Sprite_get(self->sprites, id);
+    if (sp == NULL)
+        return;
     sp->material.cropped_area = r;
 }
 void sprite_crop_pixelart(SpriteId id, Vec2 idx, Vec2 dim)
 {
-    Sprite *sp = &self->sprites->vector[id];
+    Sprite *sp = fastslot_Sprite_get(self->sprites, id);
+    if (sp == NULL)
+        return;
     sp->material.cropped_area = rectv(vec2_mulv(idx, dim), dim);
 }
 void sprite_crop_pixelart_id(SpriteId id, uint32_t hexCode)
 {
-    Sprite *sp = &self->sprites->vector[id];
+    Sprite *sp = fastslot_Sprite_get(self->sprites, id);
+    if (sp == NULL)
+        return;
 
     float x = (float)((hexCode >> 24) & 0xFF);
     float y = (float)((hexCode >> 16) & 0xFF);
@@ -87,8 +148,80 @@ void sprite_init()
 {
     self = (SpriteContext *)xxmalloc(sizeof(SpriteContext));
     memset(self, 0, sizeof(SpriteContext));
-    self->sprites = fastvec_Sprite_init(8);
+    self->sprites = fastslot_Sprite_init(8);
+    self->instances = fastvec_SpriteInstance_init(64);
+    self->draws = fastvec_SpriteDraw_init(64);
     self->shader = shader_load("shaders/sprite.vs", "shaders/sprite.fs");
+    shader_begin(self->shader);
+    shader_texture(self->shader, "texture1", 0);
+    shader_end();
+    self->texSizeLocation = shader_location(self->shader, "tex_size");
+    self->pixelartLocation = shader_location(self->shader, "pixelart");
+    glGenBuffers(1, &self->instanceVbo);
+}
+
+// keyed on the atlas page texture rather than the image, sprites of different images on one page share a draw
+static inline uint64_t sprite_key(const Sprite *it, const Texture *tex)
+{
+    return ((uint64_t)(uint32_t)it->mesh << 32) | ((uint64_t)(tex->gid & 0xFFFFFF) << 8) | (it->material.flags & 0xFF);
+}
+
+static int sprite_draw_compare(const void *a, const void *b)
+{
+    uint64_t ka = ((const SpriteDraw *)a)->key;
+    uint64_t kb = ((const SpriteDraw *)b)->key;
+    return (ka > kb) - (ka < kb);
+}
+
+// points the instance attributes of the bound vao at the first instance of a group,
+// there is no base instance in gl 3.3 so the offset goes into the pointers
+static void sprite_bind_instances(int first)
+{
+    size_t offset = (size_t)first * sizeof(SpriteInstance);
+    for (int i = 0; i < 4; i++)
+    {
+        glEnableVertexAttribArray(SPRITE_ATTRIB_WORLD + i);
+        glVertexAttribPointer(SPRITE_ATTRIB_WORLD + i, 4, GL_FLOAT, GL_FALSE, sizeof(SpriteInstance), (void *)(offset + offsetof(SpriteInstance, world) + i * sizeof(float) * 4));
+        glVertexAttribDivisor(SPRITE_ATTRIB_WORLD + i, 1);
+    }
+    glEnableVertexAttribArray(SPRITE_ATTRIB_UV);
+    glVertexAttribPointer(SPRITE_ATTRIB_UV, 4, GL_FLOAT, GL_FALSE, sizeof(SpriteInstance), (void *)(offset + offsetof(SpriteInstance, uv)));
+    glVertexAttribDivisor(SPRITE_ATTRIB_UV, 1);
+    glEnableVertexAttribArray(SPRITE_ATTRIB_THRESHOLD);
+    glVertexAttribPointer(SPRITE_ATTRIB_THRESHOLD, 1, GL_FLOAT, GL_FALSE, sizeof(SpriteInstance), (void *)(offset + offsetof(SpriteInstance, threshold)));
+    glVertexAttribDivisor(SPRITE_ATTRIB_THRESHOLD, 1);
+    glEnableVertexAttribArray(SPRITE_ATTRIB_LAYER);
+    glVertexAttribPointer(SPRITE_ATTRIB_LAYER, 1, GL_FLOAT, GL_FALSE, sizeof(SpriteInstance), (void *)(offset + offsetof(SpriteInstance, layer)));
+    glVertexAttribDivisor(SPRITE_ATTRIB_LAYER, 1);
+}
+
+static void sprite_execute(const void *data)
+{
+    const SpriteBatch *it = (const SpriteBatch *)data;
+
+    render_blend(false);
+    render_depth_test(true);
+    render_depth_func(GL_LEQUAL);
+    if (!(it->flags & MAT_FLAG_TWO_SIDED))
+    {
+        render_cull(true);
+        render_cull_face((it->flags & MAT_FLAG_FLIPPED) ? GL_BACK : GL_FRONT);
+        render_front_face(GL_CCW);
+    }
+    else
+    {
+        render_cull(false);
+    }
+
+    render_program(it->shader);
+    render_texture_array(0, it->texture);
+    shader_set_vec2(self->texSizeLocation, &it->texSize);
+    shader_set_int(self->pixelartLocation, (it->flags & MAT_FLAG_PIXELART) == MAT_FLAG_PIXELART);
+
+    render_vao(it->vao);
+    glBindBuffer(GL_ARRAY_BUFFER, self->instanceVbo);
+    sprite_bind_instances(it->first);
+    render_draw_elements_instanced(GL_TRIANGLES, it->length, GL_UNSIGNED_INT, 0, it->count);
 }
 
 void sprite_render()
@@ -96,59 +229,71 @@ void sprite_render()
     if (self->sprites->length == 0)
         return;
 
-    glDisable(GL_BLEND);
-    glEnable(GL_DEPTH_TEST);
-    glDepthFunc(GL_LEQUAL);
-
-    Shader sh = self->shader;
-    shader_begin(sh);
-    shader_texture(sh, "texture1", 0);
-    shader_mat4(self->shader, "view_projection", &camera->view_projection);
+    // sort the drawable sprites so each (mesh, page, flags) run is contiguous
+    Fastvec_SpriteDraw *draws = self->draws;
+    fastvec_SpriteDraw_resize(draws, self->sprites->length);
+    int count = 0;
     for (int i = 0; i < self->sprites->length; i++)
     {
-        Sprite *it = &self->sprites->vector[i];
+        Sprite *it = &self->sprites->dense[i];
         if (!atlas_has(it->material.texture) || !mesh_has(it->mesh))
             continue;
+        draws->vector[count++] = (SpriteDraw){sprite_key(it, atlas_get(it->material.texture)), i};
+    }
+    if (count == 0)
+        return;
+    qsort(draws->vector, count, sizeof(SpriteDraw), sprite_draw_compare);
 
+    Fastvec_SpriteInstance *instances = self->instances;
+    fastvec_SpriteInstance_resize(instances, count);
+    for (int i = 0; i < count; i++)
+    {
+        Sprite *it = &self->sprites->dense[draws->vector[i].index];
+        Texture *tex = atlas_get(it->material.texture);
+        SpriteInstance *in = &instances->vector[i];
+        in->world = mat4_mul(mat4_scale(it->scale), rot_matrix(it->rotation, it->position));
+        in->uv = atlas_crop(tex, it->material.cropped_area);
+        in->threshold = it->material.mask_threshold;
+        in->layer = (float)tex->layer;
+    }
+
+    // orphan the previous frame's storage so the upload never waits on draws still in flight
+    size_t bytes = count * sizeof(SpriteInstance);
+    glBindBuffer(GL_ARRAY_BUFFER, self->instanceVbo);
+    if (bytes > self->instanceBytes)
+        self->instanceBytes = __fast_next_pow2((uint32_t)bytes);
+    glBufferData(GL_ARRAY_BUFFER, self->instanceBytes, NULL, GL_STREAM_DRAW);
+    glBufferSubData(GL_ARRAY_BUFFER, 0, bytes, instances->vector);
+
+    int first = 0;
+    while (first < count)
+    {
+        uint64_t key = draws->vector[first].key;
+        int last = first + 1;
+        while (last < count && draws->vector[last].key == key)
+            last++;
+
+        Sprite *it = &self->sprites->dense[draws->vector[first].index];
         Texture *tex = atlas_get(it->material.texture);
         Mesh *mesh = mesh_get(it->mesh);
 
-        glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_2D, tex->gid);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-        Mat4 m = mat4_mul(mat4_scale(it->scale), rot_matrix(it->rotation, it->position));
-        shader_mat4(sh, "world", &m);
-        shader_float(sh, "threshold", it->material.mask_threshold);
-        shader_vec4(sh, "crop", &it->material.cropped_area);
-        shader_vec2(sh, "tex_size", &tex->size);
-        shader_int(sh, "pixelart", (it->material.flags & MAT_FLAG_PIXELART) == MAT_FLAG_PIXELART);
-        if (!(it->material.flags & MAT_FLAG_TWO_SIDED))
-        {
-            glEnable(GL_CULL_FACE);
-            glCullFace((it->material.flags & MAT_FLAG_FLIPPED) ? GL_BACK : GL_FRONT);
-            glFrontFace(GL_CCW);
-        }
-        else
-        {
-            glDisable(GL_CULL_FACE);
-        }
-        glBindVertexArray(mesh->vao);
-        glDrawElements(GL_TRIANGLES, mesh->length, GL_UNSIGNED_INT, NULL);
+        SpriteBatch batch = {self->shader, tex->gid, tex->pageSize, it->material.flags, mesh->vao, mesh->length, first, last - first};
+        render_submit(render_key(RENDER_PASS_OPAQUE, self->shader, tex->gid, mesh->vao, 0), sprite_execute, &batch, sizeof(batch));
+        first = last;
     }
-
-    shader_end();
 }
 
 void sprite_clear()
 {
-    fastvec_Sprite_clear(self->sprites);
+    fastslot_Sprite_clear(self->sprites);
 }
 
 void sprite_destroy()
 {
-    fastvec_Sprite_destroy(self->sprites);
+    fastslot_Sprite_destroy(self->sprites);
+    fastvec_SpriteInstance_destroy(self->instances);
+    fastvec_SpriteDraw_destroy(self->draws);
+    glDeleteBuffers(1, &self->instanceVbo);
     shader_destroy(self->shader);
     xxfree(self, sizeof(SpriteContext));
     self = NULL;
@@ -164,15 +309,18 @@ void sprite_anim(SpriteId id, uint32_t ids[], uint32_t n, float fps, float t0)
 
 SpriteItter sprite_begin()
 {
-    return (SpriteItter){&self->sprites->vector[0], 0};
+    int index = self->sprites->length - 1;
+    return (SpriteItter){index >= 0 ? &self->sprites->dense[index] : NULL, index};
 }
 
 bool sprite_eof(SpriteItter *it)
 {
-    return it->index == self->sprites->length;
+    return it->index < 0;
 }
 
 void sprite_next(SpriteItter *it)
 {
-    it->it = &self->sprites->vector[++it->index];
+    // a delete of the current sprite moved the last one into its place, which was already visited
+    if (--it->index >= 0)
+        it->it = &self->sprites->dense[it->index];
 }
\ No newline at end of file
@@ -6,7 +6,7 @@
 #include "math/rect.h"
 #include "math/vec3.h"
 #include "math/rot.h"
-#include "adt/fastvec.h"
+#include "adt/fastslot.h"
 #include "mesh.h"
 
 typedef struct
@@ -26,7 +26,7 @@ typedef struct {
     int index;
 } SpriteItter;
 
-make_fastvec_directives(Sprite, Sprite);
+make_fastslot_directives(Sprite, Sprite);
 
 void sprite_init();
 
@@ -37,6 +37,8 @@ void sprite_crop_pixelart(SpriteId id, Vec2 idx, Vec2 dim);
 void sprite_crop_pixelart_id(SpriteId id, uint32_t hexCode);
 void sprite_delete(SpriteId id);
 
+bool sprite_has(SpriteId id);
+
 void sprite_anim(SpriteId id, uint32_t ids[], uint32_t n, float fps, float t0);
 
 void sprite_clear();
@@ -47,6 +49,7 @@ SpriteItter sprite_begin();
 bool sprite_eof(SpriteItter* self);
 void sprite_next(SpriteItter* self);
 
+// walks the sprites backwards, deleting the current sprite inside the loop is safe
 #define sprite_for(it) for (SpriteItter it = sprite_begin(); !sprite_eof(&it); sprite_next(&it))
 
 #endif
\ No newline at end of file
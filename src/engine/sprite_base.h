@@ -4,8 +4,11 @@
 #include "math/rect.h"
 #include "atlas.h"
 
+// generational handle into the sprite slot map, stale ids stop resolving once the sprite is deleted
 typedef uint32_t SpriteId;
 
+#define SPRITE_NONE 0
+
 #define MAT_FLAG_TWO_SIDED 1 << 1
 #define MAT_FLAG_FLIPPED 1 << 2
 #define MAT_FLAG_PIXELART 1 << 3
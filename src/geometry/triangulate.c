@@ -2,9 +2,16 @@
 #include "mem/alloc.h"
 #include "math/vec3.h"
 #include "math/edge.h"
+#include "adt/fastheap.h"
 
 make_fastset_directives(Vec3, Vec3, adt_compare_vec3, adt_hashof_vec3);
 make_fastvec_directives(Edge, Edge);
+make_fastmap_directives(Vec3Id, Vec3, int, adt_compare_vec3, adt_hashof_vec3);
+
+// nearer vertices rank higher so the heap hands out the cheapest edge first
+#define compare_dist(a, b) (((b) > (a)) - ((b) < (a)))
+
+make_fastiheap_directives(Dist, float, compare_dist);
 
 static int orientation(Vec3 p, Vec3 q, Vec3 r)
 {
@@ -126,46 +133,100 @@ void tri_unique_edges(Triangle tris[], int nt, Fastset_Edge *edges)
     }
 }
 
+static int vertex_id(Fastmap_Vec3Id *ids, Vec3 p)
+{
+    FastmapNode_Vec3Id *node = fastmap_Vec3Id_get(ids, p);
+    if (node != NULL)
+        return node->value;
+    node = fastmap_Vec3Id_put(ids, p);
+    node->value = ids->length - 1;
+    return node->value;
+}
+
 void tri_prims_mst(Vec3 begin, Fastset_Edge *edges, Edge out_edges[], int *out_n)
 {
     if (edges->length == 0)
         return;
     int m = 0;
-    Fastset_Vec3 *vertices = fastset_Vec3_init();
-    fastset_Vec3_put(vertices, begin);
+    int ne = edges->length;
+    Fastmap_Vec3Id *ids = fastmap_Vec3Id_init();
+
+    // number the vertices and list every edge under both of its ends
+    Edge *list = xxmalloc(ne * sizeof(Edge));
+    int *ends = xxmalloc(ne * 2 * sizeof(int));
+    int k = 0;
+    fastset_for(Edge, edges, it)
+    {
+        list[k] = it.node->key;
+        ends[k * 2] = vertex_id(ids, list[k].a);
+        ends[k * 2 + 1] = vertex_id(ids, list[k].b);
+        k++;
+    }
+    int nv = ids->length;
+    int *offsets = xxmalloc((nv + 1) * sizeof(int));
+    int *cursor = xxmalloc(nv * sizeof(int));
+    int *adjacent = xxmalloc(ne * 2 * sizeof(int));
+    memset(offsets, 0, (nv + 1) * sizeof(int));
+    for (int i = 0; i < ne * 2; i++)
+        offsets[ends[i] + 1]++;
+    for (int i = 0; i < nv; i++)
+    {
+        offsets[i + 1] += offsets[i];
+        cursor[i] = offsets[i];
+    }
+    for (int i = 0; i < ne * 2; i++)
+        adjacent[cursor[ends[i]]++] = i >> 1;
 
-    while (vertices->length > 0)
+    // parent holds the edge that reaches each vertex, cursor is reused as the visited mark
+    int *parent = xxmalloc(nv * sizeof(int));
+    for (int i = 0; i < nv; i++)
     {
-        int found = 0;
-        Edge targetEdge;
-        float minLength = MAX_FLOAT;
+        parent[i] = -1;
+        cursor[i] = 0;
+    }
 
-        fastset_for(Edge, edges, it)
+    Fastiheap_Dist *heap = fastiheap_Dist_init(nv);
+    FastmapNode_Vec3Id *start = fastmap_Vec3Id_get(ids, begin);
+    if (start != NULL)
+        fastiheap_Dist_push(heap, start->value, 0);
+    while (!fastiheap_Dist_empty(heap))
+    {
+        int u;
+        fastiheap_Dist_pop(heap, &u);
+        cursor[u] = 1;
+        if (parent[u] >= 0)
         {
-            Edge e = it.node->key;
-            int a1 = fastset_Vec3_get(vertices, e.a) != NULL;
-            int a2 = fastset_Vec3_get(vertices, e.b) != NULL;
-
-            if (a1 != a2)
+            out_edges[m++] = list[parent[u]];
+            fastset_Edge_remove(edges, list[parent[u]]);
+        }
+        for (int i = offsets[u]; i < offsets[u + 1]; i++)
+        {
+            int e = adjacent[i];
+            int v = ends[e * 2] == u ? ends[e * 2 + 1] : ends[e * 2];
+            if (cursor[v])
+                continue;
+            float len = vec3_dist(list[e].a, list[e].b);
+            float *dist = fastiheap_Dist_get(heap, v);
+            if (dist == NULL)
             {
-                float len = vec3_dist(e.a, e.b);
-                if (len < minLength)
-                {
-                    found = 1;
-                    targetEdge = e;
-                    minLength = len;
-                }
+                parent[v] = e;
+                fastiheap_Dist_push(heap, v, len);
+            }
+            else if (len < *dist)
+            {
+                parent[v] = e;
+                fastiheap_Dist_decrease_key(heap, v, len);
             }
         }
-
-        if (!found)
-            break;
-
-        out_edges[m++] = targetEdge;
-        fastset_Edge_remove(edges, targetEdge);
-        fastset_Vec3_put(vertices, targetEdge.a);
-        fastset_Vec3_put(vertices, targetEdge.b);
     }
-    fastset_Vec3_destroy(vertices);
+
+    fastiheap_Dist_destroy(heap);
+    xxfree(parent, nv * sizeof(int));
+    xxfree(adjacent, ne * 2 * sizeof(int));
+    xxfree(cursor, nv * sizeof(int));
+    xxfree(offsets, (nv + 1) * sizeof(int));
+    xxfree(ends, ne * 2 * sizeof(int));
+    xxfree(list, ne * sizeof(Edge));
+    fastmap_Vec3Id_destroy(ids);
     *out_n = m;
 }
\ No newline at end of file
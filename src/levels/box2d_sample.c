@@ -36,6 +36,7 @@ static void create(Sample2dContext *self)
     worldDef.bodyCapacity = 2;
     worldDef.contactCapacity = 2;
     worldDef.arenaAllocatorCapacity = 0;
+    worldDef.enableTaskScheduler = true;
 
     self->mouseJoint = b2_nullJointId;
     self->groundId = b2_nullBodyId;
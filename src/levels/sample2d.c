@@ -22,9 +22,9 @@ typedef struct
 static void create(Sample2dContext *self)
 {
 
-    atlas_load("platform", "textures/textures.png");
-    mesh_load("plane", "models/plane.obj");
-    mesh_load("box", "models/box.obj");
+    atlas_request("platform", "textures/textures.png");
+    mesh_request("plane", "models/plane.obj");
+    mesh_request("box", "models/box.obj");
 
     {
         SpriteId id = sprite_create("plane","platform");
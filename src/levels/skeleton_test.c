@@ -25,8 +25,8 @@ typedef struct
 
 static void create(SkeletonTestbestContext *self)
 {
-    atlas_load("platform", "textures/textures.png");
-    mesh_load("bone", "models/bone.obj");
+    atlas_request("platform", "textures/textures.png");
+    mesh_request("bone", "models/bone.obj");
     gui_init("fonts/roboto.ttf");
 
     Skel *skel = skeleton_cerate(vec2_zero);
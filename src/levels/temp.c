@@ -23,6 +23,7 @@
 typedef struct
 {
     int state;
+    SpriteId ship;
 } TempContext;
 
 static void create(TempContext *self)
@@ -34,16 +35,16 @@ static void create(TempContext *self)
     camera->rotation = rot_look_at(camera->position, vec3(100, 0, 0));
     camera_update();
 
-    atlas_load("spaceship", "textures/spaceship.png");
-    mesh_load("spaceship", "models/spaceship.obj");
-    atlas_load("bomb", "textures/bomb.png");
-    mesh_load("bomb", "models/bomb.obj");
+    atlas_request("spaceship", "textures/spaceship.png");
+    mesh_request("spaceship", "models/spaceship.obj");
+    atlas_request("bomb", "textures/bomb.png");
+    mesh_request("bomb", "models/bomb.obj");
 
-    SpriteId id = sprite_create("spaceship", "spaceship");
-    Sprite *sp = sprite_get(id);
+    self->ship = sprite_create("spaceship", "spaceship");
+    Sprite *sp = sprite_get(self->ship);
     sp->scale = vec3(5, 5, 5);
     sp->position = vec3(0, 0, 0);
-    // sprite_crop_pixelart_id(id, 0x021D1010);
+    // sprite_crop_pixelart_id(self->ship, 0x021D1010);
 }
 
 static float lt = 0;
@@ -60,7 +61,7 @@ static void instantiate()
 static void render(TempContext *self)
 {
 
-    Sprite *sp = sprite_get(0);
+    Sprite *sp = sprite_get(self->ship);
     float ax = input_axis(AXIS_HORIZONTAL);
     ax = ax * ax * signf(ax);
     sp->position.y += ax;
@@ -78,10 +79,7 @@ static void render(TempContext *self)
         {
             sp->position.x -= gtime->delta * 30.0f;
             if (sp->position.x < -10)
-            {
                 sprite_delete(sp->id);
-                break;
-            }
         }
     }
 }
@@ -3,6 +3,7 @@
 
 #include "mem/alloc.h"
 #include "mem/utils.h"
+#include "mem/profile.h"
 
 #include "engine/game.h"
 
@@ -17,6 +18,9 @@
 #include "engine/atlas.h"
 #include "engine/mesh.h"
 #include "engine/sprite.h"
+#include "engine/render.h"
+#include "engine/loader.h"
+#include "adt/atom.h"
 
 #include "levels/temp.h"
 #include "levels/graph1.h"
@@ -27,19 +31,22 @@
 int main()
 {
     MemoryMetadata meta;
-    meta.global = 8 * MEGABYTES;
+    meta.global = 1 * GIGABYTES;
     meta.stack = 1 * MEGABYTES;
+    meta.frame = 1 * MEGABYTES;
     alloc_create(meta);
 
     file_init("../assets/");
     game_init();
     input_init();
     camera_init();
+    render_init();
     draw_init();
     editor_init();
     grid_init();
     debug_init();
     level_init(8);
+    loader_init(0, 4 * MEGABYTES);
     atlas_init();
     mesh_init();
     sprite_init();
@@ -55,6 +62,7 @@ int main()
     {
         game_begin();
         input_begin();
+        loader_update();
         level_render_before();
 
         grid_render();
@@ -75,12 +83,27 @@ int main()
             debug_origin(vec2(0, 1));
             debug_color(color_yellow);
             debug_rotation(rot_zero);
-            debug_stringf(vec2(10, game->size.y - 10), "global: %d / %d\nstack: %d / %d\nmemory: %d",
-                          alloc->global->usage, alloc->global->total,
-                          alloc->stack->usage, alloc->stack->total, alloc->usage);
+            RenderStats stats = render_stats();
+            debug_stringf(vec2(10, game->size.y - 10), "global: %d / %d\nstack: %d / %d\nframe: %d / %d (peak %d)\nmemory: %d\nrender: %d commands, %d draws, %d states (%d skipped)",
+                          alloc->global->usage, alloc->global->committed,
+                          alloc->stack->usage, alloc->stack->total,
+                          alloc->frame->last, alloc->frame->buffers[0]->total, alloc->frame->peak, xxusage(),
+                          stats.commands, stats.draws, stats.states, stats.skipped);
+#ifdef MEM_PROFILE
+            char text[1024];
+            int len = 0;
+            for (int i = 0; i < MEM_TAG_COUNT; i++)
+            {
+                MemoryTagStats stats = profile_stats(i);
+                len += snprintf(text + len, sizeof(text) - len, "%s: %zu (peak %zu) %zu allocs/frame\n",
+                                profile_tag_name(i), stats.live, stats.peak, stats.rate_allocations);
+            }
+            debug_string(vec2(360, game->size.y - 10), text, len + 1);
+#endif
         }
         draw_render();
         debug_render();
+        render_flush();
 
         input_end();
         level_render_after();
@@ -93,9 +116,13 @@ int main()
     sprite_destroy();
     mesh_destroy();
     atlas_destroy();
+    loader_destroy();
+    atom_destroy();
     debug_terminate();
     grid_terminate();
     draw_terminate();
+    render_destroy();
+    camera_destroy();
     game_terminate();
     alloc_terminate();
     return 0;
@@ -2,19 +2,26 @@
 #include "alloc.h"
 
 #include <malloc.h>
+#include "profile.h"
 
 MemoryLayout *alloc = NULL;
 
 void alloc_create(MemoryMetadata meta)
 {
     alloc = malloc(sizeof(MemoryLayout));
-    alloc->global = make_arena(meta.global);
+    alloc->global = make_arena_virtual(meta.global, 0);
     alloc->stack = make_stack(meta.stack);
+    alloc->frame = make_frame(meta.frame);
 }
 
 void alloc_terminate()
 {
+    frame_destroy(alloc->frame);
     stack_destroy(alloc->stack);
     arena_destroy(alloc->global);
+    xxtrim();
+#ifdef MEM_PROFILE
+    profile_report();
+#endif
     free(alloc);
 }
@@ -4,19 +4,22 @@
 #include <stddef.h>
 #include "arena.h"
 #include "stack.h"
+#include "frame.h"
 #include "mem.h"
 
 typedef struct
 {
+    // address space reserved for the global arena, pages are committed on demand
     size_t global;
     size_t stack;
+    size_t frame;
 } MemoryMetadata;
 
 typedef struct
 {
     ArenaMemory *global;
     StackMemory *stack;
-    size_t usage;
+    FrameMemory *frame;
 } MemoryLayout;
 
 extern MemoryLayout *alloc;
@@ -27,5 +30,6 @@ void alloc_terminate();
 #define xxstack(size) (stack_alloc(alloc->stack, size))
 #define xxfreestack(ptr) (stack_free(alloc->stack, ptr))
 #define xxarena(size) (arena_alloc(alloc->global, size))
+#define xxframe(size) (frame_alloc(alloc->frame, size))
 
 #endif
\ No newline at end of file
@@ -1,20 +1,54 @@
-
 #include "arena.h"
 
 #include <stdlib.h>
 #include <stdio.h>
+#include <unistd.h>
+#include <sys/mman.h>
 #include "utils.h"
+#include "defs.h"
 #include "mem.h"
 
+#define ARENA_COMMIT_SIZE (64 * KILOBYTES)
+#define ARENA_HUGEPAGE_SIZE (2 * MEGABYTES)
+
+static size_t arena_granularity(ArenaMemory *self)
+{
+    if (self->flags & ARENA_HUGEPAGES)
+        return ARENA_HUGEPAGE_SIZE;
+    return ARENA_COMMIT_SIZE;
+}
+
+static size_t arena_round(size_t size, size_t granularity)
+{
+    return (size + granularity - 1) & ~(granularity - 1);
+}
+
+static int arena_commit(ArenaMemory *self, size_t required)
+{
+    size_t start = (size_t)self - self->padding;
+    size_t committed = arena_round(required, arena_granularity(self));
+    if (committed > self->total)
+        committed = self->total;
+    if (mprotect((void *)(start + self->committed), committed - self->committed, PROT_READ | PROT_WRITE) != 0)
+    {
+        printf("arena: commit failed %zu\n", committed);
+        return 0;
+    }
+    self->committed = committed;
+    return 1;
+}
+
 void *arena_alloc(ArenaMemory *self, size_t size)
 {
     size_t address = ((size_t)self - self->padding) + self->usage;
     const size_t padding = MEMORY_PADDING(address);
     if (self->usage + size + padding > self->total)
     {
-        printf("arena: out of memory %zu\n");
+        printf("arena: out of memory %zu\n", size);
         return NULL;
     }
+    if (self->usage + size + padding > self->committed && !arena_commit(self, self->usage + size + padding))
+        return NULL;
     address += padding;
     self->usage += size + padding;
     return (void *)(address);
@@ -24,11 +58,27 @@ void arena_reset(ArenaMemory *self)
 {
     const size_t space = MEMORY_SPACE(sizeof(ArenaMemory));
     self->usage = self->padding + space;
+    if ((self->flags & ARENA_DECOMMIT) == 0)
+        return;
+
+    // keep the page holding the header, release everything after it
+    size_t start = (size_t)self - self->padding;
+    size_t keep = arena_round(self->usage, arena_granularity(self));
+    if (keep >= self->committed)
+        return;
+    madvise((void *)(start + keep), self->committed - keep, MADV_DONTNEED);
+    mprotect((void *)(start + keep), self->committed - keep, PROT_NONE);
+    self->committed = keep;
 }
 
 void arena_destroy(ArenaMemory *self)
 {
     size_t op = (size_t)self - self->padding;
+    if (self->flags & ARENA_VIRTUAL)
+    {
+        munmap((void *)(op), self->total);
+        return;
+    }
     xxfree((void *)(op), self->total);
 }
 
@@ -41,6 +91,8 @@ ArenaMemory *make_arena_raw(void *m, size_t size)
     self->total = size;
     self->usage = padding + space;
     self->padding = padding;
+    self->committed = size;
+    self->flags = 0;
     return self;
 }
 
@@ -49,9 +101,53 @@ ArenaMemory *make_arena(size_t size)
     void *m = xxmalloc(size);
     if (!m)
     {
-        printf("arena: malloc failed %zu\n");
+        printf("arena: malloc failed %zu\n", size);
         exit(1);
         return NULL;
     }
     return make_arena_raw(m, size);
 }
+
+ArenaMemory *make_arena_virtual(size_t reserve, int flags)
+{
+    size_t granularity = (flags & ARENA_HUGEPAGES) ? ARENA_HUGEPAGE_SIZE : ARENA_COMMIT_SIZE;
+    reserve = arena_round(reserve, granularity);
+    // mmap is only page aligned, huge pages need the commits to start on a 2mb boundary so
+    // one extra huge page is reserved and whatever falls outside the aligned range is given back
+    size_t slack = (flags & ARENA_HUGEPAGES) ? granularity : 0;
+    void *m = mmap(NULL, reserve + slack, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (m == MAP_FAILED)
+    {
+        printf("arena: reserve failed %zu\n", reserve);
+        exit(1);
+        return NULL;
+    }
+    if (slack)
+    {
+        size_t start = (size_t)m;
+        size_t aligned = arena_round(start, granularity);
+        if (aligned > start)
+            munmap(m, aligned - start);
+        if (start + slack > aligned)
+            munmap((void *)(aligned + reserve), start + slack - aligned);
+        m = (void *)aligned;
+    }
+#ifdef MADV_HUGEPAGE
+    if (flags & ARENA_HUGEPAGES)
+        madvise(m, reserve, MADV_HUGEPAGE);
+#endif
+    // the header sits at the start of the aligned reservation
+    ArenaMemory *self = (ArenaMemory *)m;
+    if (mprotect(m, granularity, PROT_READ | PROT_WRITE) != 0)
+    {
+        printf("arena: commit failed %zu\n", granularity);
+        exit(1);
+        return NULL;
+    }
+    self->padding = 0;
+    self->total = reserve;
+    self->usage = MEMORY_SPACE(sizeof(ArenaMemory));
+    self->committed = granularity;
+    self->flags = flags | ARENA_VIRTUAL;
+    return self;
+}
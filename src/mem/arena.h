@@ -3,20 +3,34 @@
 
 #include <stddef.h>
 
+enum
+{
+    // reserve address space up front and commit pages as the arena grows
+    ARENA_VIRTUAL = 1 << 0,
+    // back the reservation with transparent huge pages, commits in 2mb steps
+    ARENA_HUGEPAGES = 1 << 1,
+    // give committed pages back to the os on reset
+    ARENA_DECOMMIT = 1 << 2,
+};
+
 typedef struct  {
     size_t padding;
     size_t total;
     size_t usage;
+    size_t committed;
+    int flags;
 } ArenaMemory;
 
 ArenaMemory *make_arena(size_t size);
 
 ArenaMemory *make_arena_raw(void *m, size_t size);
 
+ArenaMemory *make_arena_virtual(size_t reserve, int flags);
+
 void arena_destroy(ArenaMemory *self);
 
 void *arena_alloc(ArenaMemory *self, size_t size);
 
 void arena_reset(ArenaMemory *self);
 
-#endif
\ No newline at end of file
+#endif
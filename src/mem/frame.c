@@ -0,0 +1,50 @@
+#include "frame.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+#include "utils.h"
+#include "mem.h"
+
+void *frame_alloc(FrameMemory *self, size_t size)
+{
+    return arena_alloc(self->buffers[self->index], size);
+}
+
+size_t frame_usage(FrameMemory *self)
+{
+    ArenaMemory *arena = self->buffers[self->index];
+    return arena->usage - arena->padding - MEMORY_SPACE(sizeof(ArenaMemory));
+}
+
+void frame_swap(FrameMemory *self)
+{
+    self->last = frame_usage(self);
+    if (self->last > self->peak)
+        self->peak = self->last;
+    self->index ^= 1;
+    arena_reset(self->buffers[self->index]);
+}
+
+void frame_destroy(FrameMemory *self)
+{
+    arena_destroy(self->buffers[0]);
+    arena_destroy(self->buffers[1]);
+    xxfree(self, sizeof(FrameMemory));
+}
+
+FrameMemory *make_frame(size_t size)
+{
+    FrameMemory *self = (FrameMemory *)xxmalloc(sizeof(FrameMemory));
+    if (!self)
+    {
+        printf("frame: malloc failed %zu\n", size);
+        exit(1);
+        return NULL;
+    }
+    self->buffers[0] = make_arena(size);
+    self->buffers[1] = make_arena(size);
+    self->index = 0;
+    self->last = 0;
+    self->peak = 0;
+    return self;
+}
@@ -0,0 +1,26 @@
+#ifndef cgame_FRAME_H
+#define cgame_FRAME_H
+
+#include <stddef.h>
+#include "arena.h"
+
+// double buffered scratch memory, allocations from frame N stay valid while frame N+1 is built
+typedef struct
+{
+    ArenaMemory *buffers[2];
+    size_t index;
+    size_t last;
+    size_t peak;
+} FrameMemory;
+
+FrameMemory *make_frame(size_t size);
+
+void frame_destroy(FrameMemory *self);
+
+void *frame_alloc(FrameMemory *self, size_t size);
+
+void frame_swap(FrameMemory *self);
+
+size_t frame_usage(FrameMemory *self);
+
+#endif
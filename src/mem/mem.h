@@ -3,8 +3,59 @@
 
 #include <stddef.h>
 
+// subsystem an allocation is charged to when profiling, set per library with -DMEM_TAG
+enum
+{
+    MEM_TAG_OTHER,
+    MEM_TAG_MEM,
+    MEM_TAG_ADT,
+    MEM_TAG_BOX2D,
+    MEM_TAG_ENGINE,
+    MEM_TAG_SKEL,
+    MEM_TAG_GUI,
+    MEM_TAG_LEVELS,
+    MEM_TAG_COUNT,
+};
+
+#ifndef MEM_TAG
+# define MEM_TAG MEM_TAG_OTHER
+#endif
+
 extern void *xxmalloc(size_t size);
 
 extern void xxfree(void *ptr, size_t size);
 
-#endif
\ No newline at end of file
+// resize a block from size to newSize bytes, keeping the contents. large blocks grow in place when possible
+extern void *xxrealloc(void *ptr, size_t size, size_t newSize);
+
+// blocks on a power of two alignment larger than the default, counted in xxusage like the others.
+// they skip the thread cache and the profiler, whose header would break the alignment
+extern void *xxmalloc_aligned(size_t alignment, size_t size);
+
+extern void xxfree_aligned(void *ptr, size_t size);
+
+// live bytes across all threads, summed on demand
+extern size_t xxusage();
+
+// return the calling thread's cached blocks to the system allocator
+extern void xxtrim();
+
+extern void *xxmalloc_tagged(size_t size, int tag, const char *file, int line);
+
+extern void xxfree_tagged(void *ptr, size_t size);
+
+extern void *xxrealloc_tagged(void *ptr, size_t size, size_t newSize, int tag, const char *file, int line);
+
+// configure --enable-mem-profile routes every allocation through the profiler
+#ifdef MEM_PROFILE
+# define xxmalloc(size) xxmalloc_tagged(size, MEM_TAG, __FILE__, __LINE__)
+# define xxfree(ptr, size) xxfree_tagged(ptr, size)
+# define xxrealloc(ptr, size, newSize) xxrealloc_tagged(ptr, size, newSize, MEM_TAG, __FILE__, __LINE__)
+# define xxmalloc_tag(size, tag) xxmalloc_tagged(size, tag, __FILE__, __LINE__)
+# define xxrealloc_tag(ptr, size, newSize, tag) xxrealloc_tagged(ptr, size, newSize, tag, __FILE__, __LINE__)
+#else
+# define xxmalloc_tag(size, tag) xxmalloc(size)
+# define xxrealloc_tag(ptr, size, newSize, tag) xxrealloc(ptr, size, newSize)
+#endif
+
+#endif
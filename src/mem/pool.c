@@ -1,57 +1,53 @@
-
 #include "pool.h"
 
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
 
 #include "utils.h"
 #include "mem.h"
 
-typedef struct PoolMemoryNode
-{
-    size_t next; // 7bytes offset 1byte used
-} PoolMemoryNode;
+#define POOL_WORD_BITS (sizeof(size_t) * 8)
 
-void pool_enqueue(PoolMemory *self, PoolMemoryNode *node)
+static inline size_t pool_stride(size_t objectSize)
 {
-    node->next = BYTE71((size_t)self->head, 0);
-    self->head = node;
+    // free slots store the next pointer in place
+    if (objectSize < sizeof(void *))
+        objectSize = sizeof(void *);
+    return (objectSize + sizeof(void *) - 1) & ~(sizeof(void *) - 1);
 }
 
-PoolMemoryNode *pool_dequeue(PoolMemory *self)
+static inline size_t pool_words(size_t capacity)
 {
-    if (self->head == NULL)
-        return NULL;
-    PoolMemoryNode *node = self->head;
-    node->next = BYTE71_SET_1(node->next, 1);
-    self->head = (PoolMemoryNode *)(BYTE71_GET_7(node->next));
-    return node;
+    return (capacity + POOL_WORD_BITS - 1) / POOL_WORD_BITS;
 }
 
 void *pool_alloc(PoolMemory *self)
 {
-    PoolMemoryNode *node = pool_dequeue(self);
+    void *node = self->head;
     if (node == NULL)
     {
-        printf("pool: out of memory %zu\n");
+        printf("pool: out of memory %zu\n", self->object_size);
         return NULL;
     }
+    self->head = *(void **)node;
+    size_t index = ((size_t)node - self->begin) / self->object_size;
+    self->used[index / POOL_WORD_BITS] |= (size_t)1 << (index % POOL_WORD_BITS);
     self->usage -= self->object_size;
-    const size_t space = MEMORY_SPACE(sizeof(PoolMemoryNode));
-    return (void *)((size_t)node + space);
+    return node;
 }
 
 void pool_free(PoolMemory *self, void *ptr)
 {
     if (!ptr)
         return;
-    size_t address = (size_t)ptr;
-    const size_t space = MEMORY_SPACE(sizeof(PoolMemoryNode));
-    PoolMemoryNode *node = (PoolMemoryNode *)(address - space);
-    size_t used = BYTE71_GET_1(node->next);
-    if (!used)
+    size_t index = ((size_t)ptr - self->begin) / self->object_size;
+    size_t mask = (size_t)1 << (index % POOL_WORD_BITS);
+    if (!(self->used[index / POOL_WORD_BITS] & mask))
         return;
-    pool_enqueue(self, node);
+    self->used[index / POOL_WORD_BITS] &= ~mask;
+    *(void **)ptr = self->head;
+    self->head = ptr;
     self->usage += self->object_size;
 }
 
@@ -65,24 +61,32 @@ PoolMemory *pool_create(void *m, size_t size, size_t objectSize)
 {
     size_t start = (size_t)m;
     const size_t space = MEMORY_SPACE(sizeof(PoolMemory));
-    const size_t pool_space = MEMORY_SPACE(sizeof(PoolMemoryNode));
     const size_t padding = MEMORY_PADDING(start);
+    const size_t stride = pool_stride(objectSize);
     PoolMemory *self = (PoolMemory *)(start + padding);
     self->head = NULL;
     self->total = size;
     self->padding = padding;
-    self->object_size = objectSize;
+    self->object_size = stride;
     self->usage = 0;
-    size_t cursor = padding + space;
-    while (1)
+
+    size_t available = size > padding + space ? size - padding - space : 0;
+    size_t capacity = available / stride;
+    while (capacity > 0 && MEMORY_SPACE(pool_words(capacity) * sizeof(size_t)) + capacity * stride > available)
+        capacity--;
+
+    self->capacity = capacity;
+    self->used = (size_t *)(start + padding + space);
+    memset(self->used, 0, pool_words(capacity) * sizeof(size_t));
+    self->begin = (size_t)self->used + MEMORY_SPACE(pool_words(capacity) * sizeof(size_t));
+
+    // push in reverse so the first allocations come out in address order
+    for (size_t i = capacity; i > 0; i--)
     {
-        size_t address = start + cursor;
-        const size_t padding = MEMORY_ALIGNMENT(address, sizeof(PoolMemoryNode));
-        cursor += padding + objectSize;
-        if (cursor > size)
-            break;
-        pool_enqueue(self, (PoolMemoryNode *)(address + padding - pool_space));
-        self->usage += self->object_size;
+        void *node = (void *)(self->begin + (i - 1) * stride);
+        *(void **)node = self->head;
+        self->head = node;
+        self->usage += stride;
     }
     return self;
 }
@@ -92,7 +96,7 @@ PoolMemory *make_pool(size_t size, size_t objectSize)
     void *m = xxmalloc(size);
     if (!m)
     {
-        printf("pool: malloc failed %zu\n");
+        printf("pool: malloc failed %zu\n", size);
         exit(1);
         return NULL;
     }
@@ -102,7 +106,9 @@ PoolMemory *make_pool(size_t size, size_t objectSize)
 size_t pool_size(size_t size, size_t objectSize)
 {
     const size_t n = size / objectSize;
+    size = n * pool_stride(objectSize);
     size += MEMORY_SPACE(sizeof(PoolMemory));
-    size += n * sizeof(PoolMemoryNode);
+    size += MEMORY_SPACE(pool_words(n) * sizeof(size_t));
+    size += DEFAULT_MEMORY_ALIGNMENT;
     return size;
-}
\ No newline at end of file
+}
@@ -3,8 +3,13 @@
 
 #include <stddef.h>
 
+// fixed size objects with an intrusive free list and an out of band used bitmap,
+// objects carry no header. use SlabMemory for mixed sizes
 typedef struct  {
-    struct PoolMemoryNode *head;
+    void *head;
+    size_t *used;
+    size_t begin;
+    size_t capacity;
     size_t padding;
     size_t object_size;
     size_t total;
@@ -23,4 +28,4 @@ void *pool_alloc(PoolMemory *self);
 
 void pool_free(PoolMemory *self, void *ptr);
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,207 @@
+#include "profile.h"
+
+#include <stdio.h>
+#include <stdint.h>
+#include <pthread.h>
+#include "defs.h"
+
+#define PROFILE_HEADER DEFAULT_MEMORY_ALIGNMENT
+// must be a power of two
+#define PROFILE_MAX_SITES 4096
+
+typedef struct
+{
+    const char *file;
+    int line;
+    int tag;
+    size_t live;
+    size_t live_count;
+    size_t peak;
+    size_t allocations;
+} AllocationSite;
+
+typedef struct
+{
+    uint32_t site;
+    uint32_t tag;
+    size_t size;
+} ProfileHeader;
+
+static const char *profile_tags[MEM_TAG_COUNT] = {
+    "other", "mem", "adt", "box2d", "engine", "skel", "gui", "levels"};
+
+static pthread_mutex_t profile_mutex = PTHREAD_MUTEX_INITIALIZER;
+static AllocationSite profile_sites[PROFILE_MAX_SITES];
+static MemoryTagStats profile_tags_stats[MEM_TAG_COUNT];
+
+static uint32_t profile_site(const char *file, int line, int tag)
+{
+    size_t hash = ((size_t)file >> 3) * 31 + (size_t)line * 2654435761u;
+    for (size_t i = 0; i < PROFILE_MAX_SITES; i++)
+    {
+        size_t index = (hash + i) & (PROFILE_MAX_SITES - 1);
+        AllocationSite *site = &profile_sites[index];
+        if (site->file == file && site->line == line)
+            return (uint32_t)index;
+        if (site->file == NULL)
+        {
+            site->file = file;
+            site->line = line;
+            site->tag = tag;
+            return (uint32_t)index;
+        }
+    }
+    // table is full, charge the first slot
+    return 0;
+}
+
+static inline size_t profile_bucket(size_t size)
+{
+    if (size == 0)
+        return 0;
+    size_t bucket = 63 - (size_t)__builtin_clzll((unsigned long long)size);
+    return bucket < PROFILE_BUCKETS ? bucket : PROFILE_BUCKETS - 1;
+}
+
+void *xxmalloc_tagged(size_t size, int tag, const char *file, int line)
+{
+    ProfileHeader *header = (ProfileHeader *)(xxmalloc)(size + PROFILE_HEADER);
+    if (!header)
+        return NULL;
+
+    if (tag < 0 || tag >= MEM_TAG_COUNT)
+        tag = MEM_TAG_OTHER;
+
+    pthread_mutex_lock(&profile_mutex);
+    uint32_t index = profile_site(file, line, tag);
+    AllocationSite *site = &profile_sites[index];
+    site->live += size;
+    site->live_count++;
+    site->allocations++;
+    if (site->live > site->peak)
+        site->peak = site->live;
+
+    MemoryTagStats *stats = &profile_tags_stats[tag];
+    stats->live += size;
+    stats->allocations++;
+    stats->frame_allocations++;
+    stats->frame_bytes += size;
+    stats->histogram[profile_bucket(size)]++;
+    if (stats->live > stats->peak)
+        stats->peak = stats->live;
+    pthread_mutex_unlock(&profile_mutex);
+
+    header->site = index;
+    header->tag = (uint32_t)tag;
+    header->size = size;
+    return (void *)((size_t)header + PROFILE_HEADER);
+}
+
+void xxfree_tagged(void *ptr, size_t size)
+{
+    if (!ptr)
+        return;
+    ProfileHeader *header = (ProfileHeader *)((size_t)ptr - PROFILE_HEADER);
+    if (header->size != size)
+        printf("profile: free size mismatch %zu != %zu at %s:%d\n", size, header->size,
+               profile_sites[header->site].file, profile_sites[header->site].line);
+
+    pthread_mutex_lock(&profile_mutex);
+    AllocationSite *site = &profile_sites[header->site];
+    site->live -= header->size;
+    site->live_count--;
+    profile_tags_stats[header->tag].live -= header->size;
+    pthread_mutex_unlock(&profile_mutex);
+
+    (xxfree)(header, header->size + PROFILE_HEADER);
+}
+
+void *xxrealloc_tagged(void *ptr, size_t size, size_t newSize, int tag, const char *file, int line)
+{
+    if (!ptr)
+        return xxmalloc_tagged(newSize, tag, file, line);
+    ProfileHeader *header = (ProfileHeader *)((size_t)ptr - PROFILE_HEADER);
+    if (header->size != size)
+        printf("profile: realloc size mismatch %zu != %zu at %s:%d\n", size, header->size, file, line);
+
+    header = (ProfileHeader *)(xxrealloc)(header, header->size + PROFILE_HEADER, newSize + PROFILE_HEADER);
+    if (!header)
+        return NULL;
+
+    // the block stays charged to the site that first allocated it
+    pthread_mutex_lock(&profile_mutex);
+    AllocationSite *site = &profile_sites[header->site];
+    site->live += newSize - header->size;
+    if (site->live > site->peak)
+        site->peak = site->live;
+
+    MemoryTagStats *stats = &profile_tags_stats[header->tag];
+    stats->live += newSize - header->size;
+    if (newSize > header->size)
+        stats->frame_bytes += newSize - header->size;
+    stats->histogram[profile_bucket(newSize)]++;
+    if (stats->live > stats->peak)
+        stats->peak = stats->live;
+    pthread_mutex_unlock(&profile_mutex);
+
+    header->size = newSize;
+    return (void *)((size_t)header + PROFILE_HEADER);
+}
+
+const char *profile_tag_name(int tag)
+{
+    if (tag < 0 || tag >= MEM_TAG_COUNT)
+        return "unknown";
+    return profile_tags[tag];
+}
+
+MemoryTagStats profile_stats(int tag)
+{
+    pthread_mutex_lock(&profile_mutex);
+    MemoryTagStats stats = profile_tags_stats[tag];
+    pthread_mutex_unlock(&profile_mutex);
+    return stats;
+}
+
+void profile_frame()
+{
+    pthread_mutex_lock(&profile_mutex);
+    for (int i = 0; i < MEM_TAG_COUNT; i++)
+    {
+        MemoryTagStats *stats = &profile_tags_stats[i];
+        stats->rate_allocations = stats->frame_allocations;
+        stats->rate_bytes = stats->frame_bytes;
+        stats->frame_allocations = 0;
+        stats->frame_bytes = 0;
+    }
+    pthread_mutex_unlock(&profile_mutex);
+}
+
+void profile_report()
+{
+    pthread_mutex_lock(&profile_mutex);
+    printf("profile: %-8s %12s %12s %12s\n", "tag", "live", "peak", "allocs");
+    for (int i = 0; i < MEM_TAG_COUNT; i++)
+    {
+        MemoryTagStats *stats = &profile_tags_stats[i];
+        if (stats->allocations == 0)
+            continue;
+        printf("profile: %-8s %12zu %12zu %12zu\n", profile_tags[i], stats->live, stats->peak, stats->allocations);
+        for (int j = 0; j < PROFILE_BUCKETS; j++)
+            if (stats->histogram[j])
+                printf("profile:    [%zu, %zu) x %zu\n", (size_t)1 << j, (size_t)1 << (j + 1), stats->histogram[j]);
+    }
+
+    size_t leaked = 0;
+    for (size_t i = 0; i < PROFILE_MAX_SITES; i++)
+    {
+        AllocationSite *site = &profile_sites[i];
+        if (!site->file || site->live_count == 0)
+            continue;
+        printf("profile: leak %zu bytes in %zu blocks [%s] %s:%d\n", site->live, site->live_count,
+               profile_tags[site->tag], site->file, site->line);
+        leaked += site->live;
+    }
+    printf("profile: %zu bytes leaked\n", leaked);
+    pthread_mutex_unlock(&profile_mutex);
+}
@@ -0,0 +1,32 @@
+#ifndef cgame_PROFILE_H
+#define cgame_PROFILE_H
+
+#include <stddef.h>
+#include "mem.h"
+
+// power of two size buckets, bucket n holds sizes in [2^n, 2^(n+1))
+#define PROFILE_BUCKETS 32
+
+typedef struct
+{
+    size_t live;
+    size_t peak;
+    size_t allocations;
+    // allocations made since the last profile_frame()
+    size_t frame_allocations;
+    size_t frame_bytes;
+    // allocations made during the last completed frame
+    size_t rate_allocations;
+    size_t rate_bytes;
+    size_t histogram[PROFILE_BUCKETS];
+} MemoryTagStats;
+
+const char *profile_tag_name(int tag);
+
+MemoryTagStats profile_stats(int tag);
+
+void profile_frame();
+
+void profile_report();
+
+#endif
@@ -0,0 +1,215 @@
+#include "slab.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include "utils.h"
+#include "mem.h"
+
+#define SLAB_MIN_SIZE 16
+#define SLAB_BITMAP_WORDS (SLAB_PAGE_SIZE / SLAB_MIN_SIZE / 64)
+
+static const uint32_t slab_classes[SLAB_CLASS_COUNT] = {
+    16, 32, 48, 64, 96, 128, 192, 256, 384, 512, 768, 1024};
+
+typedef struct SlabPage
+{
+    struct SlabPage *prev;
+    struct SlabPage *next;
+    uint32_t object_size;
+    uint32_t capacity;
+    uint32_t used;
+    uint32_t class_index;
+    // 1 bit per slot, set while the slot is free
+    uint64_t free[SLAB_BITMAP_WORDS];
+} SlabPage;
+
+#define SLAB_PAGE_HEADER MEMORY_SPACE(sizeof(SlabPage))
+
+static inline size_t slab_class(size_t size)
+{
+    size_t i = 0;
+    while (slab_classes[i] < size)
+        i++;
+    return i;
+}
+
+static inline SlabPage *slab_page_of(void *ptr)
+{
+    return (SlabPage *)((size_t)ptr & ~((size_t)SLAB_PAGE_SIZE - 1));
+}
+
+static inline void *slab_slot(SlabPage *page, size_t index)
+{
+    return (void *)((size_t)page + SLAB_PAGE_HEADER + index * page->object_size);
+}
+
+static void slab_unlink(SlabPage **list, SlabPage *page)
+{
+    if (page->prev)
+        page->prev->next = page->next;
+    else
+        *list = page->next;
+    if (page->next)
+        page->next->prev = page->prev;
+    page->prev = NULL;
+    page->next = NULL;
+}
+
+static void slab_link(SlabPage **list, SlabPage *page)
+{
+    page->prev = NULL;
+    page->next = *list;
+    if (*list)
+        (*list)->prev = page;
+    *list = page;
+}
+
+static SlabPage *slab_page_create(SlabMemory *self, size_t index)
+{
+    SlabPage *page = (SlabPage *)xxmalloc_aligned(SLAB_PAGE_SIZE, SLAB_PAGE_SIZE);
+    if (!page)
+    {
+        printf("slab: page alloc failed %zu\n", (size_t)slab_classes[index]);
+        return NULL;
+    }
+    page->prev = NULL;
+    page->next = NULL;
+    page->object_size = slab_classes[index];
+    page->capacity = (uint32_t)((SLAB_PAGE_SIZE - SLAB_PAGE_HEADER) / page->object_size);
+    page->used = 0;
+    page->class_index = (uint32_t)index;
+    memset(page->free, 0, sizeof(page->free));
+    for (uint32_t i = 0; i < page->capacity; i++)
+        page->free[i >> 6] |= 1ULL << (i & 63);
+    self->total += SLAB_PAGE_SIZE;
+    return page;
+}
+
+void *slab_alloc(SlabMemory *self, size_t size)
+{
+    if (size > SLAB_MAX_SIZE)
+        return xxmalloc(size);
+
+    size_t index = slab_class(size);
+    SlabPage *page = self->partial[index];
+    if (!page)
+    {
+        page = slab_page_create(self, index);
+        if (!page)
+            return NULL;
+        slab_link(&self->partial[index], page);
+    }
+
+    size_t word = 0;
+    while (page->free[word] == 0)
+        word++;
+    size_t bit = (size_t)__builtin_ctzll(page->free[word]);
+    page->free[word] &= page->free[word] - 1;
+    page->used++;
+    self->usage += page->object_size;
+
+    if (page->used == page->capacity)
+    {
+        slab_unlink(&self->partial[index], page);
+        slab_link(&self->full[index], page);
+    }
+    return slab_slot(page, word * 64 + bit);
+}
+
+void slab_free(SlabMemory *self, void *ptr, size_t size)
+{
+    if (!ptr)
+        return;
+    if (size > SLAB_MAX_SIZE)
+    {
+        xxfree(ptr, size);
+        return;
+    }
+
+    SlabPage *page = slab_page_of(ptr);
+    size_t slot = ((size_t)ptr - (size_t)page - SLAB_PAGE_HEADER) / page->object_size;
+    uint64_t mask = 1ULL << (slot & 63);
+    if (page->free[slot >> 6] & mask)
+        return;
+    page->free[slot >> 6] |= mask;
+    self->usage -= page->object_size;
+
+    size_t index = page->class_index;
+    if (page->used-- == page->capacity)
+    {
+        slab_unlink(&self->full[index], page);
+        slab_link(&self->partial[index], page);
+    }
+
+    // keep one empty page per class around so alloc/free at a page boundary does not thrash
+    if (page->used == 0 && (page->prev || page->next))
+    {
+        slab_unlink(&self->partial[index], page);
+        self->total -= SLAB_PAGE_SIZE;
+        xxfree_aligned(page, SLAB_PAGE_SIZE);
+    }
+}
+
+static void slab_visit(SlabPage *page, SlabVisitor visitor, void *context)
+{
+    for (; page; page = page->next)
+    {
+        for (size_t word = 0; word * 64 < page->capacity; word++)
+        {
+            uint64_t live = ~page->free[word];
+            size_t remaining = page->capacity - word * 64;
+            if (remaining < 64)
+                live &= (1ULL << remaining) - 1;
+            while (live)
+            {
+                size_t bit = (size_t)__builtin_ctzll(live);
+                live &= live - 1;
+                visitor(slab_slot(page, word * 64 + bit), context);
+            }
+        }
+    }
+}
+
+void slab_each(SlabMemory *self, size_t size, SlabVisitor visitor, void *context)
+{
+    if (size > SLAB_MAX_SIZE)
+        return;
+    size_t index = slab_class(size);
+    slab_visit(self->full[index], visitor, context);
+    slab_visit(self->partial[index], visitor, context);
+}
+
+static void slab_release(SlabPage *page)
+{
+    while (page)
+    {
+        SlabPage *next = page->next;
+        xxfree_aligned(page, SLAB_PAGE_SIZE);
+        page = next;
+    }
+}
+
+void slab_destroy(SlabMemory *self)
+{
+    for (size_t i = 0; i < SLAB_CLASS_COUNT; i++)
+    {
+        slab_release(self->partial[i]);
+        slab_release(self->full[i]);
+    }
+    xxfree(self, sizeof(SlabMemory));
+}
+
+SlabMemory *make_slab()
+{
+    SlabMemory *self = (SlabMemory *)xxmalloc(sizeof(SlabMemory));
+    if (!self)
+    {
+        printf("slab: malloc failed %zu\n", sizeof(SlabMemory));
+        exit(1);
+        return NULL;
+    }
+    memset(self, 0, sizeof(SlabMemory));
+    return self;
+}
@@ -0,0 +1,34 @@
+#ifndef cgame_SLAB_H
+#define cgame_SLAB_H
+
+#include <stddef.h>
+
+// small objects are carved out of 16kb pages, one size class per page, with the
+// free bitmap kept in the page header instead of a header per object
+#define SLAB_PAGE_SIZE (16 * 1024)
+#define SLAB_MAX_SIZE 1024
+#define SLAB_CLASS_COUNT 12
+
+typedef struct
+{
+    struct SlabPage *partial[SLAB_CLASS_COUNT];
+    struct SlabPage *full[SLAB_CLASS_COUNT];
+    size_t total;
+    size_t usage;
+} SlabMemory;
+
+typedef void (*SlabVisitor)(void *ptr, void *context);
+
+SlabMemory *make_slab();
+
+void slab_destroy(SlabMemory *self);
+
+// objects up to SLAB_MAX_SIZE are 16 byte aligned, larger ones fall back to xxmalloc
+void *slab_alloc(SlabMemory *self, size_t size);
+
+void slab_free(SlabMemory *self, void *ptr, size_t size);
+
+// visits every live object of the size class that fits size, page by page in address order
+void slab_each(SlabMemory *self, size_t size, SlabVisitor visitor, void *context);
+
+#endif
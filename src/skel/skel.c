@@ -13,14 +13,14 @@ Skel *skeleton_cerate(Vec2 pos)
     skel->bones = fastvec_Bone_init(2);
     skel->constraints = fastvec_Constr_init(2);
     skel->buffer = make_arena(4 * KILOBYTES);
-    skel->map = fastmap_StrInt_init();
+    skel->map = fastmap_AtomId_init();
     return self;
 }
 
 void skeleton_destroy(Skel *self)
 {
     SkelPrv *skel = self->context;
-    fastmap_StrInt_destroy(skel->map);
+    fastmap_AtomId_destroy(skel->map);
     arena_destroy(skel->buffer);
     fastvec_Constr_destroy(skel->constraints);
     fastvec_Bone_destroy(skel->bones);
@@ -9,7 +9,7 @@
 
 make_fastvec_directives(Bone, Bone);
 make_fastvec_directives(Constr, Constr);
-make_fastmap_directives(StrInt, StrView, int, adt_compare_string, adt_hashof_string);
+make_fastmap_directives(AtomId, Atom, int, adt_compare_primitive, adt_hashof_atom);
 make_fastvec_directives(Stack, StrView);
 
 typedef struct
@@ -19,7 +19,7 @@ typedef struct
     Fastvec_Bone *bones;
     Fastvec_Constr *constraints;
 
-    Fastmap_StrInt *map;
+    Fastmap_AtomId *map;
     int dirty_local;
     int dirty_world;
 } SkelPrv;
@@ -24,6 +24,16 @@ const StrView IDENTIFIER_CONSTR_POLE = str("pole");
 
 const StrView IDENTIFIER_ANIM = str("adnim");
 
+// bone names of the open constraint, resolved together when it closes
+enum
+{
+   CONSTR_NAME_FROM,
+   CONSTR_NAME_TO,
+   CONSTR_NAME_TARGET,
+   CONSTR_NAME_POLE,
+   CONSTR_NAMES_N,
+};
+
 void skeleton_loadfile(Skel *self, const char *p)
 {
    SkelPrv *skel = self->context;
@@ -38,6 +48,7 @@ void skeleton_loadfile(Skel *self, const char *p)
    {
       Bone tmp_bone;
       Constr tmp_constr;
+      Atom constr_names[CONSTR_NAMES_N] = {ATOM_NONE};
       Fastvec_Stack *stack = fastvec_Stack_init(8);
 
 #define SAFE_RETURN()            \
@@ -47,7 +58,7 @@ void skeleton_loadfile(Skel *self, const char *p)
 
 #define CLEAR_BONES()                       \
    arena_reset(skel->buffer);               \
-   fastmap_StrInt_clear(skel->map);         \
+   fastmap_AtomId_clear(skel->map);         \
    fastvec_Constr_clear(skel->constraints); \
    fastvec_Bone_clear(skel->bones);
 
@@ -73,6 +84,8 @@ void skeleton_loadfile(Skel *self, const char *p)
                   tmp_constr.n = 0;
                   tmp_constr.pole = -1;
                   tmp_constr.awake = true;
+                  for (int i = 0; i < CONSTR_NAMES_N; i++)
+                     constr_names[i] = ATOM_NONE;
                   if (str_eq(splits[0], str("fabric")))
                      tmp_constr.solver = CONSTR_SOLVER_FABRIC;
                   else if (str_eq(splits[0], str("ccd")))
@@ -88,6 +101,59 @@ void skeleton_loadfile(Skel *self, const char *p)
             }
             else
             {
+               // names are interned rather than looked up so a missing bone can still be reported by name
+               FastmapNode_AtomId *nodes[CONSTR_NAMES_N];
+               fastmap_AtomId_get_batch(skel->map, constr_names, CONSTR_NAMES_N, nodes);
+               for (int i = 0; i < CONSTR_NAMES_N; i++)
+               {
+                  if (constr_names[i] != ATOM_NONE && nodes[i] == NULL)
+                  {
+                     SAFE_RETURN();
+                     CLEAR_BONES();
+                     printf("skelfile: bone not found: %s\n", atom_str(constr_names[i]).string);
+                     return;
+                  }
+               }
+               if (nodes[CONSTR_NAME_FROM] != NULL)
+                  tmp_constr.bones[0] = nodes[CONSTR_NAME_FROM]->value;
+               if (nodes[CONSTR_NAME_TARGET] != NULL)
+                  tmp_constr.target = nodes[CONSTR_NAME_TARGET]->value;
+               if (nodes[CONSTR_NAME_POLE] != NULL)
+                  tmp_constr.pole = nodes[CONSTR_NAME_POLE]->value;
+               if (nodes[CONSTR_NAME_TO] != NULL)
+               {
+                  int from = tmp_constr.bones[0];
+                  int to = nodes[CONSTR_NAME_TO]->value;
+                  int ptr = to;
+                  tmp_constr.n = 0;
+                  for (int i = 0; i < CONSTR_MAX_BONES; i++)
+                  {
+                     Bone *it = &skel->bones->vector[ptr];
+                     tmp_constr.bones[tmp_constr.n++] = ptr;
+                     if (it->index == from)
+                        break;
+
+                     if (it->parent == -1)
+                     {
+                        SAFE_RETURN();
+                        CLEAR_BONES();
+                        printf("skelfile: constraint can't reach source\n");
+                        return;
+                     }
+
+                     ptr = it->parent;
+                  }
+                  if (tmp_constr.bones[0] != to || tmp_constr.bones[tmp_constr.n - 1] != from)
+                  {
+
+                     SAFE_RETURN();
+                     CLEAR_BONES();
+                     printf("skelfile: this solver has maximum joint size of %d\n", CONSTR_MAX_BONES);
+                     return;
+                  }
+                  reverse(tmp_constr.bones, tmp_constr.n);
+               }
+
                fastvec_Constr_push(skel->constraints, tmp_constr);
                fastvec_Stack_pop(stack);
             }
@@ -99,17 +165,7 @@ void skeleton_loadfile(Skel *self, const char *p)
             if (n == 1)
             {
                str_truncate(splits, n);
-
-               FastmapNode_StrInt *node = fastmap_StrInt_get(skel->map, splits[0]);
-               if (node == NULL)
-               {
-                  SAFE_RETURN();
-                  CLEAR_BONES();
-                  printf("skelfile: bone not found: %s\n", cstr(splits[0]));
-                  return;
-               }
-
-               tmp_constr.bones[0] = node->value;
+               constr_names[CONSTR_NAME_FROM] = atom_intern(splits[0]);
             }
          }
          else if (str_eq(ft, IDENTIFIER_CONSTR_POLE) && str_eq(*fastvec_Stack_top(stack), IDENTIFIER_CONSTR))
@@ -119,16 +175,7 @@ void skeleton_loadfile(Skel *self, const char *p)
             if (n > 0)
             {
                str_truncate(splits, n);
-
-               FastmapNode_StrInt *node = fastmap_StrInt_get(skel->map, splits[0]);
-               if (node == NULL)
-               {
-                  SAFE_RETURN();
-                  CLEAR_BONES();
-                  printf("skelfile: bone not found: %s\n", cstr(splits[0]));
-                  return;
-               }
-               tmp_constr.pole = node->value;
+               constr_names[CONSTR_NAME_POLE] = atom_intern(splits[0]);
 
                if (n > 1)
                {
@@ -143,45 +190,7 @@ void skeleton_loadfile(Skel *self, const char *p)
             if (n == 1)
             {
                str_truncate(splits, n);
-
-               FastmapNode_StrInt *node = fastmap_StrInt_get(skel->map, splits[0]);
-               if (node == NULL)
-               {
-                  SAFE_RETURN();
-                  CLEAR_BONES();
-                  printf("skelfile: bone not found: %s\n", cstr(splits[0]));
-                  return;
-               }
-               int from = tmp_constr.bones[0];
-               int to = node->value;
-               int ptr = to;
-               tmp_constr.n = 0;
-               for (int i = 0; i < CONSTR_MAX_BONES; i++)
-               {
-                  Bone *it = &skel->bones->vector[ptr];
-                  tmp_constr.bones[tmp_constr.n++] = ptr;
-                  if (it->index == from)
-                     break;
-
-                  if (it->parent == -1)
-                  {
-                     SAFE_RETURN();
-                     CLEAR_BONES();
-                     printf("skelfile: constraint can't reach source\n");
-                     return;
-                  }
-
-                  ptr = it->parent;
-               }
-               if (tmp_constr.bones[0] != to || tmp_constr.bones[tmp_constr.n - 1] != from)
-               {
-
-                  SAFE_RETURN();
-                  CLEAR_BONES();
-                  printf("skelfile: this solver has maximum joint size of %d\n", CONSTR_MAX_BONES);
-                  return;
-               }
-               reverse(tmp_constr.bones, tmp_constr.n);
+               constr_names[CONSTR_NAME_TO] = atom_intern(splits[0]);
             }
          }
          else if (str_eq(ft, IDENTIFIER_CONSTR_TARGET) && str_eq(*fastvec_Stack_top(stack), IDENTIFIER_CONSTR))
@@ -191,17 +200,7 @@ void skeleton_loadfile(Skel *self, const char *p)
             if (n == 1)
             {
                str_truncate(splits, n);
-
-               FastmapNode_StrInt *node = fastmap_StrInt_get(skel->map, splits[0]);
-               if (node == NULL)
-               {
-                  SAFE_RETURN();
-                  CLEAR_BONES();
-                  printf("skelfile: bone not found: %s\n", cstr(splits[0]));
-                  return;
-               }
-
-               tmp_constr.target = node->value;
+               constr_names[CONSTR_NAME_TARGET] = atom_intern(splits[0]);
             }
          }
          else if (str_eq(ft, IDENTIFIER_BONE))
@@ -233,7 +232,7 @@ void skeleton_loadfile(Skel *self, const char *p)
 
                   if (n == 2)
                   {
-                     FastmapNode_StrInt *node = fastmap_StrInt_get(skel->map, splits[1]);
+                     FastmapNode_AtomId *node = fastmap_AtomId_get(skel->map, atom_find(splits[1]));
                      if (node == NULL)
                      {
                         printf("skelfile: parent not found: %s\n", cstr(splits[1]));
@@ -254,7 +253,7 @@ void skeleton_loadfile(Skel *self, const char *p)
             }
             else
             {
-               FastmapNode_StrInt *node = fastmap_StrInt_put(skel->map, tmp_bone.name);
+               FastmapNode_AtomId *node = fastmap_AtomId_put(skel->map, atom_intern(tmp_bone.name));
                int index = skel->bones->length;
 
                node->value = index;